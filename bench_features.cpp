@@ -0,0 +1,234 @@
+/**
+ *  @file bench_features.cpp
+ *
+ *  Benchmark of feature extractors.
+ *
+ *  Each configuration (extractor id plus its parameters) is trained on the
+ *  train set, its extraction time per image is measured on in-memory images
+ *  and the features are evaluated with a K-NN classifier on the validation
+ *  set. Speedups and accuracy deltas are reported against the first
+ *  configuration, and the accuracy per ms of extraction time to compare
+ *  cost effectiveness (e.g. LBP vs LPQ with --configs=11,12).
+ *  With --compare_fixed the extraction is also timed with the kernels
+ *  specialized for 64x64 inputs disabled (see fixed_size_features.hpp).
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <exception>
+#include <time.h>
+#include <stdlib.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/ml.hpp>
+
+#include "common_code.hpp"
+
+const char *keys =
+    "{help h usage ? |      | print this message   }"
+    "{rseed        |0     | Use this value as random seed. Default 0 means use time(0)}"
+    "{configs      |0     | Extractor configurations separated by ','. Format <f_id>[:<param>:<param>...].}"
+    "{n_train      |4000  | Num. of train samples used to fit the K-NN classifier. 0 means all.}"
+    "{n_valid      |1000  | Num. of validation samples to evaluate. 0 means all.}"
+    "{knn_K        |1     | Parameter K for K-NN class.}"
+    "{compare_fixed |      | Also time each configuration with the fixed 64x64 kernels disabled.}"
+    "{train_set    |train| Set from the dataset used to train.}"
+    "{valid_set    |valid| Set from the dataset used to validation.}"
+    "{@dataset     |<none>| Path to the dataset.}";
+
+struct BenchConfig
+{
+  FeaturesExtractor::FEATURE_IDS id;
+  std::vector<float> params;
+};
+
+std::vector<BenchConfig>
+parse_configs(const std::string &configs)
+{
+  std::vector<BenchConfig> ret_v;
+  std::istringstream list(configs);
+  std::string config;
+  while (std::getline(list, config, ','))
+  {
+    std::replace(config.begin(), config.end(), ':', ' ');
+    std::istringstream in(config);
+    int id;
+    if (!(in >> id))
+      throw std::runtime_error("Error: wrong configuration '" + config + "'.");
+    BenchConfig c;
+    c.id = FeaturesExtractor::FEATURE_IDS(id);
+    float v;
+    while (in >> v)
+      c.params.push_back(v);
+    ret_v.push_back(c);
+  }
+  return ret_v;
+}
+
+/**
+ * @brief Load a random subset of samples in memory.
+ */
+void load_samples(const Dataset &dt, size_t n, cv::RNG &rng,
+                  std::vector<cv::Mat> &imgs, cv::Mat &labels)
+{
+  std::vector<size_t> idx(dt.size());
+  for (size_t i = 0; i < idx.size(); ++i)
+    idx[i] = i;
+  if (n == 0 || n > dt.size())
+    n = dt.size();
+  for (size_t i = 0; i < n; ++i)
+    std::swap(idx[i], idx[i + rng.uniform(0, int(dt.size() - i))]);
+  imgs.resize(n);
+  labels.create(int(n), 1, CV_32SC1);
+  for (size_t i = 0; i < n; ++i)
+  {
+    imgs[i] = dt.get_sample(idx[i]);
+    labels.at<int>(int(i)) = dt.get_label(idx[i]);
+    if (imgs[i].empty())
+      throw std::runtime_error("Error: could not load " + dt.get_sample_filename(idx[i]));
+  }
+}
+
+/**
+ * @brief Extract features from in-memory images.
+ * @return the features, one row per image.
+ */
+cv::Mat extract(cv::Ptr<FeaturesExtractor> &extractor,
+                const std::vector<cv::Mat> &imgs, cv::TickMeter &timer)
+{
+  cv::Mat X;
+  for (size_t i = 0; i < imgs.size(); ++i)
+  {
+    timer.start();
+    cv::Mat f = extractor->extract_features(imgs[i]);
+    timer.stop();
+    if (X.empty())
+      X.create(int(imgs.size()), f.cols, CV_32FC1);
+    f.copyTo(X.row(int(i)));
+  }
+  return X;
+}
+
+int main(int argc, char *const *argv)
+{
+  int retCode = EXIT_SUCCESS;
+
+  try
+  {
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about("Benchmark feature extractors on the pollen dataset.");
+    if (parser.has("help"))
+    {
+      parser.printMessage();
+      return 0;
+    }
+    std::vector<BenchConfig> configs =
+        parse_configs(parser.get<std::string>("configs"));
+    size_t n_train = parser.get<size_t>("n_train");
+    size_t n_valid = parser.get<size_t>("n_valid");
+    int knn_K = parser.get<int>("knn_K");
+    bool compare_fixed = parser.has("compare_fixed");
+    std::string train_set = parser.get<std::string>("train_set");
+    std::string valid_set = parser.get<std::string>("valid_set");
+    std::string dataset_path = parser.get<std::string>("@dataset");
+    size_t seed = parser.get<size_t>("rseed");
+    if (!parser.check())
+    {
+      parser.printErrors();
+      return 0;
+    }
+
+    std::cout.setf(std::ios::unitbuf);
+
+    if (seed == 0)
+      seed = time(0);
+    std::cout << "Set the random seed to: " << seed << std::endl;
+    cv::theRNG().state = seed;
+
+    Dataset train_dataset, valid_dataset;
+    if (!train_dataset.load(dataset_path, train_set))
+      throw std::runtime_error("Error: could not load train set [" + train_set + "]");
+    if (!valid_dataset.load(dataset_path, valid_set))
+      throw std::runtime_error("Error: could not load validation set [" + valid_set + "]");
+
+    std::cout << "Loading images in memory ... ";
+    std::vector<cv::Mat> train_imgs, valid_imgs;
+    cv::Mat y_t, y_v;
+    load_samples(train_dataset, n_train, cv::theRNG(), train_imgs, y_t);
+    load_samples(valid_dataset, n_valid, cv::theRNG(), valid_imgs, y_v);
+    std::cout << train_imgs.size() << " train and " << valid_imgs.size()
+              << " validation samples." << std::endl
+              << std::endl;
+
+    std::vector<double> times, accs;
+    for (size_t c = 0; c < configs.size(); ++c)
+    {
+      // Each configuration starts from the same random state.
+      cv::theRNG().state = seed;
+      auto extractor = FeaturesExtractor::create(configs[c].id);
+      extractor->set_params(configs[c].params);
+      std::cout << "[" << c << "] " << extractor->get_extractor_name()
+                << " params: " << extractor->get_params() << std::endl;
+
+      cv::TickMeter train_timer;
+      train_timer.start();
+      extractor->train(train_dataset);
+      train_timer.stop();
+
+      cv::TickMeter extract_timer;
+      cv::Mat X_t = extract(extractor, train_imgs, extract_timer);
+      cv::Mat X_v = extract(extractor, valid_imgs, extract_timer);
+      const double us_per_img = extract_timer.getTimeMicro() /
+                                double(train_imgs.size() + valid_imgs.size());
+      double generic_us_per_img = 0.0;
+      if (compare_fixed)
+      {
+        // Time the generic code of the extractor on the same images.
+        cv::TickMeter generic_timer;
+        fsiv_set_fixed_size_kernels(false);
+        extract(extractor, train_imgs, generic_timer);
+        extract(extractor, valid_imgs, generic_timer);
+        fsiv_set_fixed_size_kernels(true);
+        generic_us_per_img = generic_timer.getTimeMicro() /
+                             double(train_imgs.size() + valid_imgs.size());
+      }
+
+      auto clsf = fsiv_create_knn_classifier(knn_K);
+      fsiv_train_classifier(clsf, X_t, y_t);
+      cv::Mat predicted = fsiv_predict_labels(clsf, X_v);
+      cv::Mat cmat = fsiv_compute_confusion_matrix(y_v, predicted, 15);
+      const float acc = fsiv_compute_accuracy(cmat);
+
+      times.push_back(us_per_img);
+      accs.push_back(acc);
+      std::cout << "    dims: " << X_t.cols
+                << "  train: " << train_timer.getTimeSec() << " s"
+                << "  extraction: " << us_per_img << " us/img"
+                << "  valid acc: " << acc << std::endl;
+      if (compare_fixed)
+        std::cout << "    generic code: " << generic_us_per_img
+                  << " us/img  fixed size speedup: "
+                  << generic_us_per_img / us_per_img << std::endl;
+    }
+
+    std::cout << std::endl
+              << std::setw(8) << "config" << std::setw(16) << "us/img"
+              << std::setw(12) << "speedup" << std::setw(12) << "acc"
+              << std::setw(12) << "acc delta" << std::setw(12) << "acc/ms" << std::endl;
+    for (size_t c = 0; c < configs.size(); ++c)
+      std::cout << std::setw(8) << c << std::setw(16) << times[c]
+                << std::setw(12) << times[0] / times[c]
+                << std::setw(12) << accs[c]
+                << std::setw(12) << accs[c] - accs[0]
+                << std::setw(12) << accs[c] * 1000.0 / times[c] << std::endl;
+  }
+  catch (std::exception &e)
+  {
+    std::cerr << "Exception caught: " << e.what() << std::endl;
+    retCode = EXIT_FAILURE;
+  }
+  return retCode;
+}
@@ -0,0 +1,487 @@
+/**
+ *  @file bovw_features.cpp
+ */
+#include <cmath>
+#include <limits>
+#include <opencv2/imgproc.hpp>
+#include "distances.hpp"
+#include "kmeans.hpp"
+#include "bovw_features.hpp"
+
+static std::string name_{"Bag of Visual Words Feature Extractor"};
+static std::string help_{
+    "  This extractor computes dense SIFT-like descriptors (4x4 cells x 8\n"
+    "  orientations) on a regular grid of patches and returns the\n"
+    "  normalized histogram of visual words. The vocabulary is learnt with\n"
+    "  mini-batch k-means on descriptors sampled from the train images.\n"
+    "  Parameters: K:P:S:N:D:B:L\n"
+    "    K: vocabulary size. Default 256.\n"
+    "    P: patch size in pixels (multiple of 4). Default 16.\n"
+    "    S: stride in pixels (multiple of P/4). Default 8.\n"
+    "    N: num. of train images sampled to learn the vocabulary (0 means\n"
+    "       all). Default 4000.\n"
+    "    D: num. of descriptors sampled per train image. Default 32.\n"
+    "    B: branching factor of a vocabulary tree. 0 means a flat\n"
+    "       vocabulary of K words. Default 0.\n"
+    "    L: depth of the vocabulary tree, which has B^L words (K is\n"
+    "       ignored). Default 3.\n"};
+
+// Mini-batch k-means settings used to learn the vocabulary.
+static const int KMEANS_BATCH_SIZE = 2048;
+static const int KMEANS_ITERATIONS = 100;
+
+static const int DESC_CELLS = 4;
+static const int DESC_BINS = 8;
+static const int DESC_DIM = DESC_CELLS * DESC_CELLS * DESC_BINS;
+
+/**
+ * @brief Quantize a matrix with components in [0, max] to 8 bits.
+ * @param[out] scale is the factor applied to map max to 255.
+ */
+static cv::Mat
+quantize(const cv::Mat &m, float &scale)
+{
+    double max_v = 0.0;
+    cv::minMaxLoc(m, nullptr, &max_v);
+    scale = max_v > 0.0 ? float(255.0 / max_v) : 1.0f;
+    cv::Mat q;
+    m.convertTo(q, CV_8U, scale);
+    return q;
+}
+
+/**
+ * @brief Replace a matrix by its 8-bit quantized values.
+ *
+ * The model file stores the vocabulary (or tree) with 8 bits, so the
+ * trained one is snapped to the same values to extract the same features after training
+ * as after loading the model.
+ */
+static void
+snap_to_8bits(cv::Mat &m)
+{
+    float scale;
+    quantize(m, scale).convertTo(m, CV_32F, 1.0 / scale);
+}
+
+const std::string &
+BOVWFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+BOVWFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+BOVWFeatures::BOVWFeatures()
+{
+    type_ = FSIV_BOVW;
+    params_ = {256.0f, 16.0f, 8.0f, 4000.0f, 32.0f, 0.0f, 3.0f};
+}
+
+BOVWFeatures::~BOVWFeatures() {}
+
+int BOVWFeatures::branching() const
+{
+    // models saved before the vocabulary tree was added have 5 params.
+    return params_.size() > 5 ? int(params_[5]) : 0;
+}
+
+int BOVWFeatures::depth() const
+{
+    return params_.size() > 6 ? int(params_[6]) : 0;
+}
+
+int BOVWFeatures::vocabulary_size() const
+{
+    if (branching() > 1)
+    {
+        int size = 1;
+        for (int l = 0; l < depth(); ++l)
+            size *= branching();
+        return size;
+    }
+    return vocabulary_.rows;
+}
+
+void fsiv_compute_dense_descriptors(const cv::Mat &img, int patch_size,
+                                    int stride, cv::Mat &descriptors)
+{
+    CV_Assert(!img.empty() && img.channels() == 1);
+    CV_Assert(patch_size >= DESC_CELLS && patch_size % DESC_CELLS == 0);
+    const int cell = patch_size / DESC_CELLS;
+    CV_Assert(stride > 0 && stride % cell == 0);
+
+    cv::Mat f;
+    img.convertTo(f, CV_32F, img.depth() == CV_8U ? 1.0 / 255.0 : 1.0);
+
+    // Orientation histogram of each cell of the image, with linear
+    // interpolation between the two nearest orientation bins.
+    const int gy = f.rows / cell;
+    const int gx = f.cols / cell;
+    std::vector<float> cells(size_t(gy) * gx * DESC_BINS, 0.0f);
+    const float bin_scale = float(DESC_BINS / (2.0 * CV_PI));
+    for (int y = 0; y < gy * cell; ++y)
+    {
+        const float *row = f.ptr<float>(y);
+        const float *up = f.ptr<float>(std::max(y - 1, 0));
+        const float *down = f.ptr<float>(std::min(y + 1, f.rows - 1));
+        float *cell_row = &cells[size_t(y / cell) * gx * DESC_BINS];
+        for (int x = 0; x < gx * cell; ++x)
+        {
+            const float dx = row[std::min(x + 1, f.cols - 1)] - row[std::max(x - 1, 0)];
+            const float dy = down[x] - up[x];
+            const float mag = std::sqrt(dx * dx + dy * dy);
+            float ang = std::atan2(dy, dx);
+            if (ang < 0.0f)
+                ang += float(2.0 * CV_PI);
+            const float bin = ang * bin_scale - 0.5f;
+            const int b0 = int(std::floor(bin));
+            const float w1 = bin - b0;
+            float *h = cell_row + (x / cell) * DESC_BINS;
+            h[(b0 + DESC_BINS) % DESC_BINS] += mag * (1.0f - w1);
+            h[(b0 + 1) % DESC_BINS] += mag * w1;
+        }
+    }
+
+    // Each descriptor concatenates the histograms of a 4x4 block of cells.
+    const int step = stride / cell;
+    const int ny = gy >= DESC_CELLS ? (gy - DESC_CELLS) / step + 1 : 0;
+    const int nx = gx >= DESC_CELLS ? (gx - DESC_CELLS) / step + 1 : 0;
+    descriptors.create(ny * nx, DESC_DIM, CV_32FC1);
+    for (int py = 0; py < ny; ++py)
+        for (int px = 0; px < nx; ++px)
+        {
+            float *d = descriptors.ptr<float>(py * nx + px);
+            for (int cy = 0; cy < DESC_CELLS; ++cy)
+                for (int cx = 0; cx < DESC_CELLS; ++cx)
+                {
+                    const float *h = &cells[(size_t(py * step + cy) * gx + px * step + cx) * DESC_BINS];
+                    std::copy(h, h + DESC_BINS, d + (cy * DESC_CELLS + cx) * DESC_BINS);
+                }
+
+            // SIFT normalization: normalize, clamp and renormalize.
+            float norm = 0.0f;
+            for (int k = 0; k < DESC_DIM; ++k)
+                norm += d[k] * d[k];
+            const float inv = 1.0f / (std::sqrt(norm) + 1e-7f);
+            norm = 0.0f;
+            for (int k = 0; k < DESC_DIM; ++k)
+            {
+                d[k] = std::min(d[k] * inv, 0.2f);
+                norm += d[k] * d[k];
+            }
+            const float inv2 = 1.0f / (std::sqrt(norm) + 1e-7f);
+            for (int k = 0; k < DESC_DIM; ++k)
+                d[k] *= inv2;
+        }
+}
+
+cv::Mat fsiv_sample_dense_descriptors(const Dataset &dt, int patch_size,
+                                      int stride, size_t n_images,
+                                      int per_image, cv::RNG &rng)
+{
+    CV_Assert(dt.size() > 0);
+    CV_Assert(per_image > 0);
+    n_images = n_images > 0 ? std::min(dt.size(), n_images) : dt.size();
+
+    // Sample the training images and a seed per image so the sampling of
+    // descriptors does not depend on the thread scheduling.
+    std::vector<size_t> images(dt.size());
+    for (size_t i = 0; i < images.size(); ++i)
+        images[i] = i;
+    for (size_t i = 0; i < n_images; ++i)
+        std::swap(images[i], images[i + rng.uniform(0, int(dt.size() - i))]);
+    std::vector<uint64> seeds(n_images);
+    for (auto &s : seeds)
+        s = rng.next();
+
+    std::vector<cv::Mat> sampled(n_images);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+    for (int i = 0; i < int(n_images); ++i)
+    {
+        cv::Mat img = dt.get_sample(images[i]);
+        if (img.empty())
+            continue;
+        cv::Mat descs;
+        fsiv_compute_dense_descriptors(img, patch_size, stride, descs);
+        if (descs.rows <= per_image)
+        {
+            sampled[i] = descs;
+            continue;
+        }
+        cv::RNG local_rng(seeds[i]);
+        cv::Mat s(per_image, descs.cols, CV_32FC1);
+        for (int j = 0; j < per_image; ++j)
+            descs.row(local_rng.uniform(0, descs.rows)).copyTo(s.row(j));
+        sampled[i] = s;
+    }
+
+    cv::Mat samples;
+    for (auto &s : sampled)
+        if (!s.empty())
+            samples.push_back(s);
+    return samples;
+}
+
+void BOVWFeatures::train(const Dataset &dt)
+{
+    CV_Assert(dt.size() > 0);
+    const int K = int(params_[0]);
+    const int patch_size = int(params_[1]);
+    const int stride = int(params_[2]);
+    const size_t n_images = size_t(std::max(params_[3], 0.0f));
+    const int per_image = int(params_[4]);
+    CV_Assert(K > 0 && per_image > 0);
+
+    cv::RNG &rng = cv::theRNG();
+    cv::Mat samples = fsiv_sample_dense_descriptors(dt, patch_size, stride,
+                                                    n_images, per_image, rng);
+    const int min_samples = branching() > 1 ? branching() : K;
+    if (samples.rows < min_samples)
+        throw std::runtime_error("Error: not enough descriptors (" +
+                                 std::to_string(samples.rows) +
+                                 ") to learn the vocabulary.");
+
+    if (branching() > 1)
+    {
+        CV_Assert(depth() > 0);
+        vocabulary_.release();
+        vocabulary_sq_norms_.release();
+        train_tree(samples, branching(), depth(), rng);
+        snap_to_8bits(tree_);
+    }
+    else
+    {
+        tree_.release();
+        vocabulary_ = fsiv_minibatch_kmeans(samples, K, KMEANS_BATCH_SIZE,
+                                            KMEANS_ITERATIONS, rng);
+        snap_to_8bits(vocabulary_);
+        vocabulary_sq_norms_ = fsiv_compute_sq_norms(vocabulary_);
+    }
+}
+
+void BOVWFeatures::train_tree(const cv::Mat &samples, int branching,
+                              int depth, cv::RNG &rng)
+{
+    CV_Assert(branching > 1 && depth > 0);
+    const int B = branching;
+    int n_nodes = 0;
+    int level_size = 1;
+    for (int l = 0; l < depth; ++l)
+    {
+        level_size *= B;
+        n_nodes += level_size;
+    }
+    tree_.create(n_nodes, samples.cols, CV_32FC1);
+
+    // Samples reaching each node of the current level (the root has all).
+    std::vector<std::vector<int>> members(1, std::vector<int>(samples.rows));
+    for (int i = 0; i < samples.rows; ++i)
+        members[0][i] = i;
+
+    int offset = 0; // first row in tree_ of the level being trained.
+    for (int l = 0; l < depth; ++l)
+    {
+        const int n_parents = int(members.size());
+        std::vector<std::vector<int>> next(size_t(n_parents) * B);
+        std::vector<uint64> seeds(n_parents);
+        for (auto &s : seeds)
+            s = rng.next();
+
+        // Nodes of a level are independent k-means problems.
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic) if (n_parents > 1)
+#endif
+        for (int p = 0; p < n_parents; ++p)
+        {
+            cv::Mat children = tree_.rowRange(offset + p * B, offset + (p + 1) * B);
+            const std::vector<int> &m = members[p];
+            if (m.empty())
+            {
+                // No samples reached the parent: children replicate it.
+                const cv::Mat parent = tree_.row(offset - n_parents + p);
+                for (int c = 0; c < B; ++c)
+                    parent.copyTo(children.row(c));
+                continue;
+            }
+            cv::Mat S(int(m.size()), samples.cols, CV_32FC1);
+            for (size_t i = 0; i < m.size(); ++i)
+                samples.row(m[i]).copyTo(S.row(int(i)));
+
+            if (S.rows < B)
+            {
+                for (int c = 0; c < B; ++c)
+                    S.row(c % S.rows).copyTo(children.row(c));
+            }
+            else
+            {
+                // Deep nodes have few samples: a few passes are enough.
+                cv::RNG local_rng(seeds[p]);
+                const int batch = std::min(KMEANS_BATCH_SIZE, S.rows);
+                const int iterations = std::max(10, std::min(KMEANS_ITERATIONS,
+                                                             3 * S.rows / batch));
+                fsiv_minibatch_kmeans(S, B, batch, iterations, local_rng)
+                    .copyTo(children);
+            }
+
+            if (l + 1 < depth)
+            {
+                std::vector<int> labels;
+                fsiv_find_nearest_centers(S, children,
+                                          fsiv_compute_sq_norms(children),
+                                          labels);
+                for (size_t i = 0; i < m.size(); ++i)
+                    next[size_t(p) * B + labels[i]].push_back(m[i]);
+            }
+        }
+        offset += n_parents * B;
+        members.swap(next);
+    }
+}
+
+void BOVWFeatures::assign_tree_words(const cv::Mat &descriptors,
+                                     std::vector<int> &words) const
+{
+    const int B = branching();
+    const int L = depth();
+    const int d = descriptors.cols;
+    words.resize(descriptors.rows);
+    for (int i = 0; i < descriptors.rows; ++i)
+    {
+        const float *x = descriptors.ptr<float>(i);
+        int node = 0;       // index of the node inside its level.
+        int offset = 0;     // first row in tree_ of the current level.
+        int level_size = B; // num. of nodes in the current level.
+        for (int l = 0; l < L; ++l)
+        {
+            const int first = offset + node * B;
+            int best = 0;
+            float best_d = std::numeric_limits<float>::max();
+            for (int c = 0; c < B; ++c)
+            {
+                const float *t = tree_.ptr<float>(first + c);
+                float dist = 0.0f;
+#ifdef USE_OPENMP
+#pragma omp simd reduction(+ : dist)
+#endif
+                for (int k = 0; k < d; ++k)
+                    dist += (x[k] - t[k]) * (x[k] - t[k]);
+                if (dist < best_d)
+                {
+                    best_d = dist;
+                    best = c;
+                }
+            }
+            node = node * B + best;
+            offset += level_size;
+            level_size *= B;
+        }
+        words[i] = node;
+    }
+}
+
+cv::Mat
+BOVWFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    CV_Assert(!vocabulary_.empty() || !tree_.empty());
+    cv::Mat features = cv::Mat::zeros(1, vocabulary_size(), CV_32FC1);
+
+    // Per thread scratch buffers, reused between calls.
+    thread_local cv::Mat descriptors;
+    thread_local std::vector<int> words;
+    fsiv_compute_dense_descriptors(img, int(params_[1]), int(params_[2]),
+                                   descriptors);
+    if (descriptors.rows > 0)
+    {
+        if (!tree_.empty())
+            assign_tree_words(descriptors, words);
+        else
+            fsiv_find_nearest_centers(descriptors, vocabulary_,
+                                      vocabulary_sq_norms_, words);
+        float *h = features.ptr<float>();
+        for (int w : words)
+            h[w] += 1.0f;
+        // Hellinger normalization: L1 normalize and take the square root,
+        // so the euclidean distance used by the classifiers fits histograms.
+        const float inv = 1.0f / float(words.size());
+        for (int k = 0; k < features.cols; ++k)
+            h[k] = std::sqrt(h[k] * inv);
+    }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+/**
+ * @brief Write a matrix with components in [0, max] quantized to 8 bits.
+ */
+static void
+write_quantized(cv::FileStorage &f, const std::string &label, const cv::Mat &m)
+{
+    float scale;
+    f << label << quantize(m, scale);
+    f << label + "_scale" << scale;
+}
+
+/**
+ * @brief Read a matrix written with write_quantized().
+ */
+static cv::Mat
+read_quantized(cv::FileStorage &f, const std::string &label)
+{
+    auto node = f[label];
+    if (node.empty())
+        throw std::runtime_error("Could not load the '" + label +
+                                 "' label from file.");
+    cv::Mat q, m;
+    node >> q;
+    float scale = 1.0f;
+    f[label + "_scale"] >> scale;
+    q.convertTo(m, CV_32F, 1.0 / scale);
+    return m;
+}
+
+bool BOVWFeatures::save_model(std::string const &fname) const
+{
+    if (!FeaturesExtractor::save_model(fname))
+        return false;
+    cv::FileStorage f(fname, cv::FileStorage::APPEND | cv::FileStorage::BASE64);
+    if (!f.isOpened())
+        return false;
+    // Descriptor components are in [0, 1], so the vocabulary is quantized
+    // to 8 bits and written in base64 to keep the model small.
+    if (!tree_.empty())
+        write_quantized(f, "fsiv_bovw_tree", tree_);
+    else
+        write_quantized(f, "fsiv_bovw_vocabulary", vocabulary_);
+    return true;
+}
+
+bool BOVWFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    cv::FileStorage f(fname, cv::FileStorage::READ);
+    if (branching() > 1)
+    {
+        vocabulary_.release();
+        vocabulary_sq_norms_.release();
+        tree_ = read_quantized(f, "fsiv_bovw_tree");
+    }
+    else
+    {
+        tree_.release();
+        vocabulary_ = read_quantized(f, "fsiv_bovw_vocabulary");
+        vocabulary_sq_norms_ = fsiv_compute_sq_norms(vocabulary_);
+    }
+    return true;
+}
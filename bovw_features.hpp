@@ -0,0 +1,111 @@
+/**
+ *  @file bovw_features.hpp
+ */
+#pragma once
+
+#include <vector>
+#include "features.hpp"
+
+/**
+ * @brief Bag of Visual Words extractor.
+ *
+ * Dense SIFT-like descriptors are computed on a regular grid of patches and
+ * each one is assigned to its nearest visual word. The feature vector is the
+ * normalized histogram of words. The vocabulary is learnt in train() with
+ * mini-batch k-means on descriptors sampled from the training images.
+ *
+ * Optionally the vocabulary is a hierarchical k-means tree (vocabulary
+ * tree) with branching factor B and depth L, whose B^L leaves are the
+ * words. A descriptor is then assigned descending the tree, which costs
+ * O(B·L) distances instead of O(B^L).
+ */
+class BOVWFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    BOVWFeatures();
+    ~BOVWFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual void train(const Dataset &dt) override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual bool save_model(std::string const &fname) const override;
+    virtual bool load_model(std::string const &fname) override;
+
+protected:
+    /**
+     * @brief Learn a vocabulary tree using hierarchical k-means.
+     * @param samples are the training descriptors.
+     * @param branching is the branching factor.
+     * @param depth is the number of levels.
+     * @param rng is the random generator.
+     */
+    void train_tree(const cv::Mat &samples, int branching, int depth,
+                    cv::RNG &rng);
+
+    /**
+     * @brief Assign each descriptor to a leaf of the vocabulary tree.
+     * @param descriptors are the descriptors, one per row.
+     * @param[out] words are the leaf index for each descriptor.
+     */
+    void assign_tree_words(const cv::Mat &descriptors,
+                           std::vector<int> &words) const;
+
+    /** @brief Branching factor of the tree (0 means flat vocabulary). */
+    int branching() const;
+    /** @brief Depth of the tree. */
+    int depth() const;
+    /** @brief Num. of visual words. */
+    int vocabulary_size() const;
+
+    cv::Mat vocabulary_;
+    cv::Mat vocabulary_sq_norms_;
+    // Vocabulary tree nodes ordered by level: level l (1..L) has B^l nodes
+    // and the children of node i of level l are nodes i*B..i*B+B-1 of
+    // level l+1.
+    cv::Mat tree_;
+};
+
+/**
+ * @brief Compute dense SIFT-like descriptors.
+ *
+ * Each patch is split into 4x4 cells and every cell accumulates a
+ * histogram of 8 gradient orientations weighted by the gradient magnitude,
+ * giving a 128-d descriptor. Descriptors are L2 normalized, clamped to 0.2
+ * and normalized again.
+ *
+ * @param img is the input grayscale image.
+ * @param patch_size is the side of the square patches in pixels.
+ * @param stride is the distance in pixels between consecutive patches.
+ * @param[out] descriptors are the computed descriptors, one per row.
+ * @pre !img.empty() && img.channels()==1
+ * @pre patch_size>=4 && patch_size%4==0
+ * @pre stride>0 && stride%(patch_size/4)==0
+ * @post descriptors.type()==CV_32FC1
+ * @post descriptors.cols==128
+ */
+void fsiv_compute_dense_descriptors(const cv::Mat &img, int patch_size,
+                                    int stride, cv::Mat &descriptors);
+
+/**
+ * @brief Sample dense descriptors from random images of a dataset.
+ *
+ * Images are processed in parallel. Each image uses its own seed drawn
+ * from rng, so the result does not depend on the thread scheduling.
+ *
+ * @param dt is the dataset.
+ * @param patch_size is the side of the square patches in pixels.
+ * @param stride is the distance in pixels between consecutive patches.
+ * @param n_images is the num. of images sampled (0 means all).
+ * @param per_image is the max. num. of descriptors sampled per image.
+ * @param rng is the random generator.
+ * @return the sampled descriptors, one per row.
+ * @pre dt.size()>0
+ * @pre per_image>0
+ */
+cv::Mat fsiv_sample_dense_descriptors(const Dataset &dt, int patch_size,
+                                      int stride, size_t n_images,
+                                      int per_image, cv::RNG &rng);
@@ -1,4 +1,10 @@
 #include "classifiers.hpp"
+#include "knn_classifier.hpp"
+#include "hnsw_classifier.hpp"
+#include "ivfpq_classifier.hpp"
+#include "hamming_classifier.hpp"
+#include "linear_svm_classifier.hpp"
+#include "smo_svm.hpp"
 
 cv::Ptr<cv::ml::StatModel>
 fsiv_create_knn_classifier(int K)
@@ -23,6 +29,51 @@ fsiv_create_knn_classifier(int K)
     return knn;
 }
 
+cv::Ptr<cv::ml::StatModel>
+fsiv_create_native_knn_classifier(int K, int algorithm)
+{
+    cv::Ptr<KNNClassifier> knn = KNNClassifier::create();
+    knn->set_K(K);
+    knn->set_algorithm(algorithm);
+    CV_Assert(knn != nullptr);
+    return knn;
+}
+
+cv::Ptr<cv::ml::StatModel>
+fsiv_create_hnsw_classifier(int K, int M, int ef_construction, int ef_search)
+{
+    cv::Ptr<HNSWClassifier> hnsw = HNSWClassifier::create();
+    hnsw->set_K(K);
+    hnsw->set_M(M);
+    hnsw->set_ef_construction(ef_construction);
+    hnsw->set_ef_search(ef_search);
+    CV_Assert(hnsw != nullptr);
+    return hnsw;
+}
+
+cv::Ptr<cv::ml::StatModel>
+fsiv_create_ivfpq_classifier(int K, int lists, int code_size, int probes)
+{
+    cv::Ptr<IVFPQClassifier> ivfpq = IVFPQClassifier::create();
+    ivfpq->set_K(K);
+    ivfpq->set_lists(lists);
+    ivfpq->set_code_size(code_size);
+    ivfpq->set_probes(probes);
+    CV_Assert(ivfpq != nullptr);
+    return ivfpq;
+}
+
+cv::Ptr<cv::ml::StatModel>
+fsiv_create_hamming_classifier(int K, int bits, int itq_iterations)
+{
+    cv::Ptr<HammingKNNClassifier> hamming = HammingKNNClassifier::create();
+    hamming->set_K(K);
+    hamming->set_bits(bits);
+    hamming->set_itq_iterations(itq_iterations);
+    CV_Assert(hamming != nullptr);
+    return hamming;
+}
+
 cv::Ptr<cv::ml::StatModel>
 fsiv_create_svm_classifier(int Kernel,
                            float C,
@@ -35,7 +86,20 @@ fsiv_create_svm_classifier(int Kernel,
     // Set it as a classifier (setIsClassifier)
     // Set hyperparameters: C, kernel, Gamma, Degree.
 
-    //
+    // create SVM classifier
+    svm = cv::ml::SVM::create();
+    // use C-support vector classification
+    svm->setType(cv::ml::SVM::C_SVC);
+    // set hyperparameters
+    svm->setKernel(Kernel);
+    svm->setC(C);
+    svm->setGamma(gamma);
+    svm->setDegree(degree);
+    // OpenCV's default criteria stop after 1000 iterations, far from
+    // converged with thousands of samples.
+    svm->setTermCriteria(cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+                                          10000000, 1e-3));
+
     CV_Assert(svm != nullptr);
     return svm;
 }
@@ -62,7 +126,11 @@ void fsiv_train_classifier(cv::Ptr<cv::ml::StatModel> &clf,
     // TODO: train the classifier.
 
     // train with samples X and labels y
-    clf->train(X, cv::ml::ROW_SAMPLE, y);
+    cv::ml::SVM *svm = dynamic_cast<cv::ml::SVM *>(clf.get());
+    if (svm && fsiv_smo_supports(*svm))
+        fsiv_train_smo_svm(*svm, X, y);
+    else
+        clf->train(X, cv::ml::ROW_SAMPLE, y);
 
     CV_Assert(clf->isTrained());
 }
@@ -90,14 +158,44 @@ fsiv_predict_labels(cv::Ptr<cv::ml::StatModel> &clf, cv::Mat const &X)
 void fsiv_save_classifier_model(cv::Ptr<cv::ml::StatModel> &clf,
                                 const std::string &model_fname)
 {
-    clf->save(model_fname);
+    cv::Ptr<cv::ml::StatModel> model = clf;
+    const cv::ml::SVM *svm = dynamic_cast<cv::ml::SVM *>(clf.get());
+    if (svm && svm->getType() == cv::ml::SVM::C_SVC &&
+        svm->getKernelType() == cv::ml::SVM::LINEAR)
+    {
+        // Save a weight vector per pair of classes instead of the
+        // support vectors.
+        cv::Ptr<LinearSVMClassifier> linear = LinearSVMClassifier::create();
+        linear->fold(*svm);
+        model = linear;
+    }
+    {
+        // The same layout as cv::Algorithm::save(), but base64 encoded.
+        cv::FileStorage f(model_fname, cv::FileStorage::WRITE | cv::FileStorage::BASE64);
+        if (!f.isOpened())
+            throw std::runtime_error("Error: could not write the classifier to " +
+                                     model_fname);
+        f << model->getDefaultName() << "{";
+        model->write(f);
+        f << "}";
+    }
     int id = -1;
-    if (dynamic_cast<cv::ml::KNearest *>(clf.get()))
+    if (dynamic_cast<cv::ml::KNearest *>(model.get()))
         id = 0;
-    else if (dynamic_cast<cv::ml::SVM *>(clf.get()))
+    else if (dynamic_cast<cv::ml::SVM *>(model.get()))
         id = 1;
-    else if (dynamic_cast<cv::ml::RTrees *>(clf.get()))
+    else if (dynamic_cast<cv::ml::RTrees *>(model.get()))
         id = 2;
+    else if (dynamic_cast<KNNClassifier *>(model.get()))
+        id = 3;
+    else if (dynamic_cast<HNSWClassifier *>(model.get()))
+        id = 4;
+    else if (dynamic_cast<IVFPQClassifier *>(model.get()))
+        id = 5;
+    else if (dynamic_cast<HammingKNNClassifier *>(model.get()))
+        id = 6;
+    else if (dynamic_cast<LinearSVMClassifier *>(model.get()))
+        id = 7;
     else
         throw std::runtime_error("Error: unknown classifier type.");
     cv::FileStorage f(model_fname, cv::FileStorage::APPEND);
@@ -122,6 +220,15 @@ fsiv_load_knn_classifier_model(const std::string &model_fname)
     return clsf;
 }
 
+cv::Ptr<cv::ml::StatModel>
+fsiv_load_native_knn_classifier_model(const std::string &model_fname)
+{
+    cv::Ptr<cv::ml::StatModel> clsf;
+    clsf = cv::Algorithm::load<KNNClassifier>(model_fname);
+    CV_Assert(clsf != nullptr);
+    return clsf;
+}
+
 cv::Ptr<cv::ml::StatModel>
 fsiv_load_svm_classifier_model(const std::string &model_fname)
 {
@@ -130,7 +237,17 @@ fsiv_load_svm_classifier_model(const std::string &model_fname)
     // TODO: load a SVM classifier.
     // Hint: use the generic interface cv::Algorithm::load< classifier_type >
 
-    //
+    // load SVM classifier from file
+    int id = -1;
+    {
+        cv::FileStorage f(model_fname, cv::FileStorage::READ);
+        if (f.isOpened() && !f["fsiv_classifier_type"].empty())
+            f["fsiv_classifier_type"] >> id;
+    }
+    if (id == 7)
+        clsf = fsiv_load_linear_svm_classifier_model(model_fname);
+    else
+        clsf = cv::Algorithm::load<cv::ml::SVM>(model_fname);
 
     CV_Assert(clsf != nullptr);
     return clsf;
@@ -150,6 +267,42 @@ fsiv_load_rtrees_classifier_model(const std::string &model_fname)
     return clsf;
 }
 
+cv::Ptr<cv::ml::StatModel>
+fsiv_load_hnsw_classifier_model(const std::string &model_fname)
+{
+    cv::Ptr<cv::ml::StatModel> clsf;
+    clsf = cv::Algorithm::load<HNSWClassifier>(model_fname);
+    CV_Assert(clsf != nullptr);
+    return clsf;
+}
+
+cv::Ptr<cv::ml::StatModel>
+fsiv_load_ivfpq_classifier_model(const std::string &model_fname)
+{
+    cv::Ptr<cv::ml::StatModel> clsf;
+    clsf = cv::Algorithm::load<IVFPQClassifier>(model_fname);
+    CV_Assert(clsf != nullptr);
+    return clsf;
+}
+
+cv::Ptr<cv::ml::StatModel>
+fsiv_load_hamming_classifier_model(const std::string &model_fname)
+{
+    cv::Ptr<cv::ml::StatModel> clsf;
+    clsf = cv::Algorithm::load<HammingKNNClassifier>(model_fname);
+    CV_Assert(clsf != nullptr);
+    return clsf;
+}
+
+cv::Ptr<cv::ml::StatModel>
+fsiv_load_linear_svm_classifier_model(const std::string &model_fname)
+{
+    cv::Ptr<cv::ml::StatModel> clsf;
+    clsf = cv::Algorithm::load<LinearSVMClassifier>(model_fname);
+    CV_Assert(clsf != nullptr);
+    return clsf;
+}
+
 cv::Ptr<cv::ml::StatModel>
 fsiv_load_classifier_model(const std::string &model_fname)
 {
@@ -183,6 +336,47 @@ fsiv_load_classifier_model(const std::string &model_fname)
         std::cout << "Loaded a RTrees classifier with " << clfs_->getRoots().size() << " trees." << std::endl;
         break;
     }
+    case 3:
+    {
+        clsf = fsiv_load_native_knn_classifier_model(model_fname);
+        KNNClassifier *clfs_ = dynamic_cast<KNNClassifier *>(clsf.get());
+        std::cout << "Loaded a native KNN classifier: K=" << clfs_->get_K()
+                  << " with " << clfs_->get_samples().rows << " references"
+                  << (clfs_->uses_kd_tree() ? " (KD-tree)." : ".") << std::endl;
+        break;
+    }
+    case 4:
+    {
+        clsf = fsiv_load_hnsw_classifier_model(model_fname);
+        HNSWClassifier *clfs_ = dynamic_cast<HNSWClassifier *>(clsf.get());
+        std::cout << "Loaded a HNSW classifier: K=" << clfs_->get_K() << " M=" << clfs_->get_M()
+                  << " efC=" << clfs_->get_ef_construction() << " efS=" << clfs_->get_ef_search() << std::endl;
+        break;
+    }
+    case 5:
+    {
+        clsf = fsiv_load_ivfpq_classifier_model(model_fname);
+        IVFPQClassifier *clfs_ = dynamic_cast<IVFPQClassifier *>(clsf.get());
+        std::cout << "Loaded an IVF-PQ classifier: K=" << clfs_->get_K() << " lists=" << clfs_->get_lists()
+                  << " code_size=" << clfs_->get_code_size() << " probes=" << clfs_->get_probes() << std::endl;
+        break;
+    }
+    case 6:
+    {
+        clsf = fsiv_load_hamming_classifier_model(model_fname);
+        HammingKNNClassifier *clfs_ = dynamic_cast<HammingKNNClassifier *>(clsf.get());
+        std::cout << "Loaded a Hamming KNN classifier: K=" << clfs_->get_K() << " bits=" << clfs_->get_bits()
+                  << " ITQ iterations=" << clfs_->get_itq_iterations() << std::endl;
+        break;
+    }
+    case 7:
+    {
+        clsf = fsiv_load_linear_svm_classifier_model(model_fname);
+        LinearSVMClassifier *clfs_ = dynamic_cast<LinearSVMClassifier *>(clsf.get());
+        std::cout << "Loaded a compact linear SVM classifier: C=" << clfs_->get_C()
+                  << " with " << clfs_->get_weights().rows << " weight vectors." << std::endl;
+        break;
+    }
     default:
     {
         throw std::runtime_error("Unknown classifier id: " + std::to_string(id));
@@ -11,6 +11,57 @@
  */
 cv::Ptr<cv::ml::StatModel> fsiv_create_knn_classifier(int K);
 
+/**
+ * @brief Create a native multithreaded KNN classifier.
+ *
+ * @param K specifies how many neighbors are used to class a new sample.
+ * @param algorithm is the search algorithm. @see KNNClassifier::Algorithms.
+ * @return the created classifier.
+ * @see KNNClassifier
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_create_native_knn_classifier(int K,
+                                                             int algorithm = 0);
+
+/**
+ * @brief Create an approximate KNN classifier on a HNSW graph index.
+ *
+ * @param K specifies how many neighbors are used to class a new sample.
+ * @param M is the num. of links per node of the graph.
+ * @param ef_construction is the beam width used to build the graph.
+ * @param ef_search is the beam width used to search.
+ * @return the created classifier.
+ * @see HNSWClassifier
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_create_hnsw_classifier(int K, int M,
+                                                       int ef_construction,
+                                                       int ef_search);
+
+/**
+ * @brief Create an approximate KNN classifier on a compressed IVF-PQ index.
+ *
+ * @param K specifies how many neighbors are used to class a new sample.
+ * @param lists is the number of inverted lists (coarse centers).
+ * @param code_size is the number of bytes used to encode each sample.
+ * @param probes is the number of lists scanned per sample.
+ * @return the created classifier.
+ * @see IVFPQClassifier
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_create_ivfpq_classifier(int K, int lists,
+                                                        int code_size,
+                                                        int probes);
+
+/**
+ * @brief Create a KNN classifier on learnt binary codes (Hamming distance).
+ *
+ * @param K specifies how many neighbors are used to class a new sample.
+ * @param bits is the number of bits per code.
+ * @param itq_iterations is the number of ITQ iterations (0: sign of PCA).
+ * @return the created classifier.
+ * @see HammingKNNClassifier
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_create_hamming_classifier(int K, int bits,
+                                                          int itq_iterations);
+
 /**
  * @brief Create a SVM classifier.
  *
@@ -18,7 +69,8 @@ cv::Ptr<cv::ml::StatModel> fsiv_create_knn_classifier(int K);
  * @param C set the tolerance parameter.
  * @param degree set the degree if a polynomial kernel is used.
  * @param gamma set the gamma parameter if RBF kernel is used.
- * @return the created classifier.
+ * @return the created classifier. Its term criteria are 1e7 iterations
+ *  and a tolerance of 1e-3.
  */
 cv::Ptr<cv::ml::StatModel> fsiv_create_svm_classifier(int Kernel,
                                                       float C,
@@ -39,6 +91,11 @@ cv::Ptr<cv::ml::StatModel> fsiv_create_rtrees_classifier(int V,
 /**
  * @brief Train a classifier.
  *
+ * C-SVC SVMs are trained with the native fsiv_train_smo_svm() when it
+ * supports their kernel. It honours the SVM term criteria as
+ * cv::ml::SVM::train() does (a warning is printed if a pair of classes
+ * reaches the iteration limit).
+ *
  * @param clf is the classifier to be trained.
  * @param X are the samples.
  * @param y are the labels.
@@ -62,6 +119,10 @@ cv::Mat fsiv_predict_labels(cv::Ptr<cv::ml::StatModel> &clf, cv::Mat const &X);
 /**
  * @brief Save the model of a trained classifier to file.
  *
+ * Matrices are saved base64 encoded, which is several times smaller than
+ * their text form. A linear C-SVC is saved as a LinearSVMClassifier, with
+ * its support vectors folded into a weight vector per pair of classes.
+ *
  * @param clf the classifier.
  * @param model_fname the filename where saving the model.
  */
@@ -78,9 +139,22 @@ void fsiv_save_classifier_model(cv::Ptr<cv::ml::StatModel> &clf,
 cv::Ptr<cv::ml::StatModel> fsiv_load_knn_classifier_model(
     const std::string &model_fname);
 
+/**
+ * @brief Load a native knn classifier's model from file.
+ *
+ * @param model_fname is the file name.
+ * @return an instance of the classifier.
+ * @post ret_v != nullptr
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_load_native_knn_classifier_model(
+    const std::string &model_fname);
+
 /**
  * @brief Load a svm classifier's model from file.
  *
+ * fsiv_save_classifier_model() saves linear C-SVCs as LinearSVMClassifier
+ * models: for those files the returned instance is a LinearSVMClassifier.
+ *
  * @param model_fname is the file name.
  * @return an instance of the classifier.
  * @post ret_v != nullptr
@@ -88,6 +162,17 @@ cv::Ptr<cv::ml::StatModel> fsiv_load_knn_classifier_model(
 cv::Ptr<cv::ml::StatModel> fsiv_load_svm_classifier_model(
     const std::string &model_fname);
 
+/**
+ * @brief Load a compact linear svm classifier's model from file.
+ *
+ * @param model_fname is the file name.
+ * @return an instance of the classifier.
+ * @post ret_v != nullptr
+ * @see LinearSVMClassifier
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_load_linear_svm_classifier_model(
+    const std::string &model_fname);
+
 /**
  * @brief Load a rtrees classifier's model from file.
  *
@@ -98,6 +183,36 @@ cv::Ptr<cv::ml::StatModel> fsiv_load_svm_classifier_model(
 cv::Ptr<cv::ml::StatModel> fsiv_load_rtrees_classifier_model(
     const std::string &model_fname);
 
+/**
+ * @brief Load a hnsw classifier's model from file.
+ *
+ * @param model_fname is the file name.
+ * @return an instance of the classifier.
+ * @post ret_v != nullptr
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_load_hnsw_classifier_model(
+    const std::string &model_fname);
+
+/**
+ * @brief Load an ivfpq classifier's model from file.
+ *
+ * @param model_fname is the file name.
+ * @return an instance of the classifier.
+ * @post ret_v != nullptr
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_load_ivfpq_classifier_model(
+    const std::string &model_fname);
+
+/**
+ * @brief Load a hamming classifier's model from file.
+ *
+ * @param model_fname is the file name.
+ * @return an instance of the classifier.
+ * @post ret_v != nullptr
+ */
+cv::Ptr<cv::ml::StatModel> fsiv_load_hamming_classifier_model(
+    const std::string &model_fname);
+
 /**
  * @brief Load a classifier model from file.
  *
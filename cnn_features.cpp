@@ -0,0 +1,507 @@
+/**
+ *  @file cnn_features.cpp
+ */
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include "convnet.hpp"
+#include "cnn_features.hpp"
+
+static std::string name_{"Pretrained CNN Feature Extractor"};
+static std::string help_{
+    "  This extractor returns the output of the last layer of a small\n"
+    "  pretrained convolutional network. The network is not trained here:\n"
+    "  use --f_load_model with a file storage having the labels\n"
+    "  'fsiv_feature_id' (7), 'fsiv_feature_params', optionally\n"
+    "  'fsiv_cnn_input_mean' and 'fsiv_cnn_input_std' (grey levels are\n"
+    "  scaled to [0, 1] before that), and 'fsiv_cnn_layers', a sequence of\n"
+    "  maps with a 'type' field:\n"
+    "    conv: 'weights' (F x C*k*k), 'bias' (F), 'ksize' k, 'pad' (def. k/2).\n"
+    "    bn: 'mean', 'var', 'gamma', 'beta' and 'eps' (def. 1e-5). It must\n"
+    "        follow a conv or dense layer.\n"
+    "    relu, maxpool (2x2 stride 2), gap (global average pooling).\n"
+    "    dense: 'weights' (outputs x inputs), 'bias' (outputs).\n"
+    "  Weights can be CV_8S with a 'scales' vector (one per output).\n"
+    "  Parameters: Q:T (missing values in the model take the defaults)\n"
+    "    Q: if 1 store the weights as int8 in the saved model. Inference\n"
+    "       is done in float with the int8 values. Default 1.\n"
+    "    T: if 1 print the time spent by each layer at exit. Default 0.\n"};
+
+// Q:T defaults, also used to complete models giving fewer parameters.
+static const std::vector<float> default_params_{1.0f, 0.0f};
+
+static const char *layer_names_[] = {"conv", "relu", "maxpool", "gap", "dense"};
+
+// Images processed by each GEMM. Chunks run in parallel.
+static const int CHUNK_SIZE = 8;
+
+const std::string &
+CNNFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+CNNFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+CNNFeatures::CNNFeatures()
+{
+    type_ = FSIV_CNN;
+    params_ = default_params_;
+}
+
+CNNFeatures::~CNNFeatures()
+{
+    if (params_[1] == 0.0f || n_images_ == 0 || layer_ticks_.empty())
+        return;
+    int64 total = 0;
+    for (auto t : layer_ticks_)
+        total += t;
+    const double ms = 1000.0 / cv::getTickFrequency();
+    std::clog << "CNN layer timing (" << n_images_ << " images, thread time):" << std::endl;
+    for (size_t l = 0; l < layers_.size(); ++l)
+        std::clog << "  " << std::setw(2) << l << ' ' << std::setw(8)
+                  << std::left << layer_names_[layers_[l].type] << std::right
+                  << (layers_[l].relu ? "+relu " : "      ")
+                  << std::setw(10) << std::fixed << std::setprecision(1)
+                  << layer_ticks_[l] * ms << " ms " << std::setw(8)
+                  << std::setprecision(2) << layer_ticks_[l] * ms * 1000.0 / n_images_
+                  << " us/img " << std::setw(5) << std::setprecision(1)
+                  << (total > 0 ? 100.0 * layer_ticks_[l] / total : 0.0) << " %"
+                  << std::endl;
+}
+
+std::vector<CNNFeatures::Shape>
+CNNFeatures::infer_shapes(const cv::Size &size) const
+{
+    std::vector<Shape> shapes{{1, size.height, size.width}};
+    for (size_t l = 0; l < layers_.size(); ++l)
+    {
+        const Layer &layer = layers_[l];
+        Shape s = shapes.back();
+        const std::string where = "CNN layer " + std::to_string(l) + " (" +
+                                  layer_names_[layer.type] + "): ";
+        switch (layer.type)
+        {
+        case CONV:
+            if (layer.weights.cols != s.c * layer.ksize * layer.ksize)
+                throw std::runtime_error(where + "weights do not match the input channels.");
+            s = {layer.weights.rows, s.h + 2 * layer.pad - layer.ksize + 1,
+                 s.w + 2 * layer.pad - layer.ksize + 1};
+            if (s.h <= 0 || s.w <= 0)
+                throw std::runtime_error(where + "input too small.");
+            break;
+        case MAXPOOL:
+            // Pooling runs on the images of a chunk stacked vertically.
+            if (s.h % 2 != 0 || s.w < 2)
+                throw std::runtime_error(where + "the input height must be even.");
+            s = {s.c, s.h / 2, s.w / 2};
+            break;
+        case GAP:
+            s = {s.c, 1, 1};
+            break;
+        case DENSE:
+            if (layer.weights.cols != s.c * s.h * s.w)
+                throw std::runtime_error(where + "weights do not match the input size.");
+            s = {layer.weights.rows, 1, 1};
+            break;
+        case RELU:
+            break;
+        }
+        shapes.push_back(s);
+    }
+    return shapes;
+}
+
+cv::Mat
+CNNFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    cv::Mat features = extract_features_batch(std::vector<cv::Mat>{img});
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+cv::Mat
+CNNFeatures::extract_features_batch(const std::vector<cv::Mat> &imgs)
+{
+    CV_Assert(imgs.size() > 0);
+    if (layers_.empty())
+        throw std::runtime_error("CNN extractor: no network loaded. Use a "
+                                 "pre-trained model (--f_load_model).");
+    const cv::Size size = imgs[0].size();
+    for (auto &img : imgs)
+    {
+        CV_Assert(img.channels() == 1);
+        if (img.size() != size)
+            return FeaturesExtractor::extract_features_batch(imgs);
+    }
+    const std::vector<Shape> shapes = infer_shapes(size);
+    const Shape &out = shapes.back();
+    const int out_hw = out.h * out.w;
+    const bool timing = params_[1] != 0.0f;
+    const int n_layers = int(layers_.size());
+    layer_ticks_.resize(n_layers, 0);
+
+    const int n = int(imgs.size());
+    cv::Mat features(n, out.c * out_hw, CV_32FC1);
+    const int n_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const double in_scale = (imgs[0].depth() == CV_8U ? 1.0 / 255.0 : 1.0) / input_std_;
+    const double in_shift = -input_mean_ / input_std_;
+
+#ifdef USE_OPENMP
+#pragma omp parallel if (n_chunks > 1)
+#endif
+    {
+        // Per thread buffers: activations (ping-pong) and im2col columns.
+        // Activations of a chunk are stored as one plane per channel with
+        // the images side by side: act[c*ld + b*h*w + p].
+        std::vector<float> act, next, cols;
+        std::vector<int64> ticks(timing ? n_layers : 0, 0);
+
+#ifdef USE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (int chunk = 0; chunk < n_chunks; ++chunk)
+        {
+            const int i0 = chunk * CHUNK_SIZE;
+            const int nb = std::min(CHUNK_SIZE, n - i0);
+            const int in_hw = size.area();
+
+            act.resize(size_t(nb) * in_hw);
+            for (int b = 0; b < nb; ++b)
+            {
+                cv::Mat dst(size, CV_32FC1, &act[size_t(b) * in_hw]);
+                imgs[i0 + b].convertTo(dst, CV_32F, in_scale, in_shift);
+            }
+
+            for (int l = 0; l < n_layers; ++l)
+            {
+                const int64 t0 = timing ? cv::getTickCount() : 0;
+                const Layer &layer = layers_[l];
+                const Shape &si = shapes[l];
+                const Shape &so = shapes[l + 1];
+                const int hw_i = si.h * si.w;
+                const int hw_o = so.h * so.w;
+                const size_t ld_i = size_t(nb) * hw_i;
+                const size_t ld_o = size_t(nb) * hw_o;
+                next.resize(size_t(so.c) * ld_o);
+                switch (layer.type)
+                {
+                case CONV:
+                {
+                    const int k = si.c * layer.ksize * layer.ksize;
+                    cols.resize(size_t(k) * ld_o);
+                    for (int b = 0; b < nb; ++b)
+                        fsiv_im2col(&act[size_t(b) * hw_i], ld_i, si.c, si.h, si.w,
+                                    layer.ksize, layer.pad, &cols[size_t(b) * hw_o], ld_o);
+                    fsiv_sgemm(so.c, int(ld_o), k, layer.weights.ptr<float>(), k,
+                               cols.data(), ld_o, next.data(), ld_o);
+                    fsiv_bias_relu(next.data(), ld_o, so.c, int(ld_o),
+                                   layer.bias.ptr<float>(), layer.relu);
+                    break;
+                }
+                case RELU:
+                    std::transform(act.begin(), act.end(), next.begin(),
+                                   [](float v) { return std::max(v, 0.0f); });
+                    break;
+                case MAXPOOL:
+                    fsiv_maxpool2(act.data(), ld_i, si.c, nb * si.h, si.w, next.data());
+                    break;
+                case GAP:
+                    for (int c = 0; c < si.c; ++c)
+                        for (int b = 0; b < nb; ++b)
+                        {
+                            const float *plane = &act[c * ld_i + size_t(b) * hw_i];
+                            float acc = 0.0f;
+                            for (int p = 0; p < hw_i; ++p)
+                                acc += plane[p];
+                            next[size_t(c) * nb + b] = acc / hw_i;
+                        }
+                    break;
+                case DENSE:
+                {
+                    // Inputs as a (C*h*w) x nb matrix, one column per image.
+                    const int k = si.c * hw_i;
+                    const float *x = act.data();
+                    if (hw_i > 1)
+                    {
+                        cols.resize(size_t(k) * nb);
+                        for (int c = 0; c < si.c; ++c)
+                            for (int b = 0; b < nb; ++b)
+                                for (int p = 0; p < hw_i; ++p)
+                                    cols[(size_t(c) * hw_i + p) * nb + b] =
+                                        act[c * ld_i + size_t(b) * hw_i + p];
+                        x = cols.data();
+                    }
+                    fsiv_sgemm(so.c, nb, k, layer.weights.ptr<float>(), k,
+                               x, nb, next.data(), nb);
+                    fsiv_bias_relu(next.data(), nb, so.c, nb,
+                                   layer.bias.ptr<float>(), layer.relu);
+                    break;
+                }
+                }
+                std::swap(act, next);
+                if (timing)
+                    ticks[l] += cv::getTickCount() - t0;
+            }
+
+            for (int b = 0; b < nb; ++b)
+            {
+                float *row = features.ptr<float>(i0 + b);
+                const size_t ld = size_t(nb) * out_hw;
+                for (int c = 0; c < out.c; ++c)
+                    std::copy(&act[c * ld + size_t(b) * out_hw],
+                              &act[c * ld + size_t(b) * out_hw] + out_hw,
+                              row + c * out_hw);
+            }
+        }
+
+        if (timing)
+            for (int l = 0; l < n_layers; ++l)
+            {
+#ifdef USE_OPENMP
+#pragma omp atomic
+#endif
+                layer_ticks_[l] += ticks[l];
+            }
+    }
+    n_images_ += n;
+
+    CV_Assert(features.rows == n);
+    CV_Assert(features.type() == CV_32FC1);
+    return features;
+}
+
+/**
+ * @brief Quantize the weights of a layer to int8 with a scale per output.
+ */
+static void
+quantize_weights(const cv::Mat &w, cv::Mat &q, cv::Mat &scales)
+{
+    q.create(w.rows, w.cols, CV_8SC1);
+    scales.create(w.rows, 1, CV_32FC1);
+    for (int r = 0; r < w.rows; ++r)
+    {
+        double min_v, max_v;
+        cv::minMaxLoc(w.row(r), &min_v, &max_v);
+        const double m = std::max(std::abs(min_v), std::abs(max_v));
+        scales.at<float>(r) = m > 0.0 ? float(m / 127.0) : 1.0f;
+        w.row(r).convertTo(q.row(r), CV_8S, 1.0 / scales.at<float>(r));
+    }
+}
+
+/**
+ * @brief Replace the weights of a layer by their int8 quantized values.
+ *
+ * Inference is done in float, but with Q=1 the model file stores int8
+ * weights: the weights in memory are snapped to the same values so the
+ * features are the same before and after saving the model.
+ */
+static void
+snap_to_int8(cv::Mat &w)
+{
+    cv::Mat q, scales;
+    quantize_weights(w, q, scales);
+    for (int r = 0; r < w.rows; ++r)
+        q.row(r).convertTo(w.row(r), CV_32F, scales.at<float>(r));
+}
+
+/**
+ * @brief Write the weights of a layer, quantized to int8 with a scale per
+ * output if required.
+ */
+static void
+write_weights(cv::FileStorage &f, const cv::Mat &w, bool quantize)
+{
+    if (!quantize)
+    {
+        f << "weights" << w;
+        return;
+    }
+    cv::Mat q, scales;
+    quantize_weights(w, q, scales);
+    f << "weights" << q;
+    f << "scales" << scales;
+}
+
+/**
+ * @brief Read the weights of a layer (float or int8 with scales).
+ */
+static cv::Mat
+read_weights(const cv::FileNode &node)
+{
+    cv::Mat w, wf;
+    node["weights"] >> w;
+    if (w.empty())
+        throw std::runtime_error("CNN layer without 'weights'.");
+    w.convertTo(wf, CV_32F);
+    if (w.depth() == CV_8S)
+    {
+        cv::Mat scales;
+        node["scales"] >> scales;
+        if (int(scales.total()) != w.rows)
+            throw std::runtime_error("CNN int8 weights need a 'scales' value per output.");
+        scales = scales.reshape(1, w.rows);
+        scales.convertTo(scales, CV_32F);
+        for (int r = 0; r < w.rows; ++r)
+        {
+            cv::Mat row = wf.row(r);
+            row *= scales.at<float>(r);
+        }
+    }
+    return wf;
+}
+
+/**
+ * @brief Read a per output vector as a column.
+ */
+static cv::Mat
+read_vector(const cv::FileNode &node, const std::string &label, int size,
+            float default_v)
+{
+    cv::Mat v;
+    node[label] >> v;
+    if (v.empty())
+        return cv::Mat(size, 1, CV_32FC1, cv::Scalar(default_v));
+    if (int(v.total()) != size)
+        throw std::runtime_error("CNN layer: wrong size for '" + label + "'.");
+    v = v.reshape(1, size);
+    v.convertTo(v, CV_32F);
+    return v;
+}
+
+bool CNNFeatures::save_model(std::string const &fname) const
+{
+    if (!FeaturesExtractor::save_model(fname))
+        return false;
+    cv::FileStorage f(fname, cv::FileStorage::APPEND | cv::FileStorage::BASE64);
+    if (!f.isOpened())
+        return false;
+    const bool quantize = params_[0] != 0.0f;
+    f << "fsiv_cnn_input_mean" << input_mean_;
+    f << "fsiv_cnn_input_std" << input_std_;
+    f << "fsiv_cnn_layers"
+      << "[";
+    for (auto &layer : layers_)
+    {
+        f << "{"
+          << "type" << layer_names_[layer.type];
+        if (layer.type == CONV)
+            f << "ksize" << layer.ksize << "pad" << layer.pad;
+        if (layer.type == CONV || layer.type == DENSE)
+        {
+            write_weights(f, layer.weights, quantize);
+            f << "bias" << layer.bias;
+        }
+        f << "}";
+        if (layer.relu)
+            f << "{"
+              << "type"
+              << "relu"
+              << "}";
+    }
+    f << "]";
+    return true;
+}
+
+bool CNNFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    if (params_.size() > default_params_.size())
+        throw std::runtime_error("CNN extractor: 'fsiv_feature_params' has more than two values (Q:T).");
+    for (size_t i = params_.size(); i < default_params_.size(); ++i)
+        params_.push_back(default_params_[i]);
+    cv::FileStorage f(fname, cv::FileStorage::READ);
+    auto node = f["fsiv_cnn_layers"];
+    if (node.empty() || !node.isSeq())
+        throw std::runtime_error("Could not load the 'fsiv_cnn_layers' "
+                                 "label from file.");
+    input_mean_ = 0.0f;
+    input_std_ = 1.0f;
+    if (!f["fsiv_cnn_input_mean"].empty())
+        f["fsiv_cnn_input_mean"] >> input_mean_;
+    if (!f["fsiv_cnn_input_std"].empty())
+        f["fsiv_cnn_input_std"] >> input_std_;
+    CV_Assert(input_std_ > 0.0f);
+
+    layers_.clear();
+    layer_ticks_.clear();
+    n_images_ = 0;
+    for (auto it = node.begin(); it != node.end(); ++it)
+    {
+        const cv::FileNode n = *it;
+        const std::string type = n["type"];
+        const bool after_linear = !layers_.empty() && !layers_.back().relu &&
+                                  (layers_.back().type == CONV || layers_.back().type == DENSE);
+        Layer layer;
+        if (type == "conv" || type == "dense")
+        {
+            layer.type = type == "conv" ? CONV : DENSE;
+            if (layer.type == CONV)
+            {
+                layer.ksize = int(n["ksize"]);
+                layer.pad = n["pad"].empty() ? layer.ksize / 2 : int(n["pad"]);
+                if (layer.ksize <= 0 || layer.pad < 0)
+                    throw std::runtime_error("CNN conv layer: wrong 'ksize' or 'pad'.");
+            }
+            layer.weights = read_weights(n);
+            layer.bias = read_vector(n, "bias", layer.weights.rows, 0.0f);
+        }
+        else if (type == "bn")
+        {
+            // y = gamma*(x-mean)/sqrt(var+eps) + beta folded into the
+            // weights and bias of the previous layer.
+            if (!after_linear)
+                throw std::runtime_error("CNN bn layer must follow a conv or dense layer.");
+            Layer &prev = layers_.back();
+            const int outs = prev.weights.rows;
+            const cv::Mat mean = read_vector(n, "mean", outs, 0.0f);
+            const cv::Mat var = read_vector(n, "var", outs, 1.0f);
+            const cv::Mat gamma = read_vector(n, "gamma", outs, 1.0f);
+            const cv::Mat beta = read_vector(n, "beta", outs, 0.0f);
+            const float eps = n["eps"].empty() ? 1e-5f : float(n["eps"]);
+            for (int r = 0; r < outs; ++r)
+            {
+                const float s = gamma.at<float>(r) / std::sqrt(var.at<float>(r) + eps);
+                cv::Mat row = prev.weights.row(r);
+                row *= s;
+                prev.bias.at<float>(r) = (prev.bias.at<float>(r) - mean.at<float>(r)) * s +
+                                         beta.at<float>(r);
+            }
+            continue;
+        }
+        else if (type == "relu")
+        {
+            // Fused with the bias of the previous layer when possible.
+            if (after_linear)
+            {
+                layers_.back().relu = true;
+                continue;
+            }
+            layer.type = RELU;
+        }
+        else if (type == "maxpool")
+            layer.type = MAXPOOL;
+        else if (type == "gap")
+            layer.type = GAP;
+        else
+            throw std::runtime_error("CNN: unknown layer type '" + type + "'.");
+        layers_.push_back(layer);
+    }
+    if (layers_.empty())
+        throw std::runtime_error("CNN: the network has no layers.");
+    if (params_[0] != 0.0f)
+        for (auto &layer : layers_)
+            if (layer.type == CONV || layer.type == DENSE)
+                snap_to_int8(layer.weights);
+    return true;
+}
@@ -0,0 +1,77 @@
+/**
+ *  @file cnn_features.hpp
+ */
+#pragma once
+
+#include <vector>
+#include "features.hpp"
+
+/**
+ * @brief Pretrained CNN embedding extractor.
+ *
+ * Runs the forward pass of a small frozen convolutional network on CPU
+ * with the convnet.hpp engine. The network is not trained here: its
+ * weights are loaded with load_model() from a file storage with the
+ * layers (see the help message for the format). Batch normalization is
+ * folded into the preceding layer when the network is loaded.
+ */
+class CNNFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    CNNFeatures();
+
+    /**
+     * @brief Print the per layer timing if it was enabled.
+     */
+    ~CNNFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual cv::Mat extract_features_batch(const std::vector<cv::Mat> &imgs) override;
+    virtual bool save_model(std::string const &fname) const override;
+    virtual bool load_model(std::string const &fname) override;
+
+protected:
+    typedef enum
+    {
+        CONV = 0,
+        RELU = 1,
+        MAXPOOL = 2,
+        GAP = 3,
+        DENSE = 4
+    } LAYER_TYPE;
+
+    struct Layer
+    {
+        LAYER_TYPE type;
+        int ksize = 0;
+        int pad = 0;
+        bool relu = false; // ReLU fused after the bias.
+        cv::Mat weights; // outputs x inputs, CV_32FC1.
+        cv::Mat bias;    // outputs x 1, CV_32FC1.
+    };
+
+    /**
+     * @brief Shape of the activations of a layer (channels x height x width).
+     */
+    struct Shape
+    {
+        int c, h, w;
+    };
+
+    /**
+     * @brief Compute the output shape of every layer for an input size.
+     * @throw std::runtime_error if the network does not fit the input.
+     */
+    std::vector<Shape> infer_shapes(const cv::Size &size) const;
+
+    std::vector<Layer> layers_;
+    float input_mean_ = 0.0f;
+    float input_std_ = 1.0f;
+    std::vector<int64> layer_ticks_;
+    int64 n_images_ = 0;
+};
@@ -5,9 +5,30 @@
 
 #pragma once
 #include "classifiers.hpp"
+#include "knn_classifier.hpp"
+#include "hnsw_classifier.hpp"
+#include "ivfpq_classifier.hpp"
+#include "hamming_classifier.hpp"
+#include "linear_svm_classifier.hpp"
+#include "smo_svm.hpp"
 #include "dataset.hpp"
 #include "features.hpp"
 #include "metrics.hpp"
 #include "gray_levels_features.hpp"
 
 // Added your feature extractor headers here.
+#include "bovw_features.hpp"
+#include "glcm_features.hpp"
+#include "gabor_features.hpp"
+#include "zernike_features.hpp"
+#include "polar_features.hpp"
+#include "random_conv_features.hpp"
+#include "cnn_features.hpp"
+#include "dct_features.hpp"
+#include "wavelet_features.hpp"
+#include "shape_features.hpp"
+#include "lbp_features.hpp"
+#include "lpq_features.hpp"
+#include "fisher_features.hpp"
+#include "fourier_features.hpp"
+#include "fixed_size_features.hpp"
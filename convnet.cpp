@@ -0,0 +1,182 @@
+/**
+ *  @file convnet.cpp
+ */
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "convnet.hpp"
+
+// GEMM blocking: a GEMM_KC x GEMM_NC panel of B (256 Kb) fits in L2 and
+// four rows of C (4 Kb) in L1.
+static const int GEMM_KC = 256;
+static const int GEMM_NC = 256;
+
+void fsiv_sgemm(int M, int N, int K,
+                const float *A, size_t lda,
+                const float *B, size_t ldb,
+                float *C, size_t ldc,
+                bool accumulate)
+{
+    if (!accumulate)
+        for (int i = 0; i < M; ++i)
+            std::fill(C + i * ldc, C + i * ldc + N, 0.0f);
+
+    for (int j0 = 0; j0 < N; j0 += GEMM_NC)
+    {
+        const int nc = std::min(GEMM_NC, N - j0);
+        for (int k0 = 0; k0 < K; k0 += GEMM_KC)
+        {
+            const int k1 = std::min(K, k0 + GEMM_KC);
+            int i = 0;
+            for (; i + 4 <= M; i += 4)
+            {
+                float *c0 = C + i * ldc + j0;
+                float *c1 = c0 + ldc;
+                float *c2 = c1 + ldc;
+                float *c3 = c2 + ldc;
+                const float *a0 = A + i * lda;
+                const float *a1 = a0 + lda;
+                const float *a2 = a1 + lda;
+                const float *a3 = a2 + lda;
+                for (int k = k0; k < k1; ++k)
+                {
+                    const float *b = B + k * ldb + j0;
+                    const float v0 = a0[k], v1 = a1[k], v2 = a2[k], v3 = a3[k];
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+                    for (int j = 0; j < nc; ++j)
+                    {
+                        c0[j] += v0 * b[j];
+                        c1[j] += v1 * b[j];
+                        c2[j] += v2 * b[j];
+                        c3[j] += v3 * b[j];
+                    }
+                }
+            }
+            for (; i < M; ++i)
+            {
+                float *c = C + i * ldc + j0;
+                const float *a = A + i * lda;
+                for (int k = k0; k < k1; ++k)
+                {
+                    const float *b = B + k * ldb + j0;
+                    const float v = a[k];
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+                    for (int j = 0; j < nc; ++j)
+                        c[j] += v * b[j];
+                }
+            }
+        }
+    }
+}
+
+void fsiv_im2col(const float *src, size_t channel_stride,
+                 int channels, int height, int width,
+                 int ksize, int pad, float *cols, size_t ld)
+{
+    const int h_out = height + 2 * pad - ksize + 1;
+    const int w_out = width + 2 * pad - ksize + 1;
+    for (int c = 0; c < channels; ++c)
+    {
+        const float *plane = src + c * channel_stride;
+        for (int ky = 0; ky < ksize; ++ky)
+            for (int kx = 0; kx < ksize; ++kx)
+            {
+                float *row = cols + ((c * ksize + ky) * ksize + kx) * ld;
+                // Valid output columns for this tap: 0 <= ox - pad + kx < width.
+                const int x_begin = std::min(w_out, std::max(0, pad - kx));
+                const int x_end = std::max(x_begin, std::min(w_out, width + pad - kx));
+                for (int oy = 0; oy < h_out; ++oy)
+                {
+                    float *dst = row + oy * w_out;
+                    const int iy = oy - pad + ky;
+                    if (iy < 0 || iy >= height)
+                    {
+                        std::fill(dst, dst + w_out, 0.0f);
+                        continue;
+                    }
+                    std::fill(dst, dst + x_begin, 0.0f);
+                    if (x_end > x_begin)
+                        std::memcpy(dst + x_begin, plane + iy * width + x_begin - pad + kx,
+                                    (x_end - x_begin) * sizeof(float));
+                    std::fill(dst + x_end, dst + w_out, 0.0f);
+                }
+            }
+    }
+}
+
+void fsiv_bias_relu(float *maps, size_t channel_stride, int channels,
+                    int size, const float *bias, bool relu)
+{
+    for (int c = 0; c < channels; ++c)
+    {
+        float *m = maps + c * channel_stride;
+        const float b = bias ? bias[c] : 0.0f;
+        if (relu)
+        {
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int i = 0; i < size; ++i)
+                m[i] = std::max(m[i] + b, 0.0f);
+        }
+        else if (b != 0.0f)
+        {
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int i = 0; i < size; ++i)
+                m[i] += b;
+        }
+    }
+}
+
+void fsiv_maxpool2(const float *src, size_t src_channel_stride, int channels,
+                   int height, int width, float *dst)
+{
+    const int h_out = height / 2;
+    const int w_out = width / 2;
+    for (int c = 0; c < channels; ++c)
+    {
+        const float *plane = src + c * src_channel_stride;
+        float *out = dst + size_t(c) * h_out * w_out;
+        for (int y = 0; y < h_out; ++y)
+        {
+            const float *r0 = plane + (2 * y) * width;
+            const float *r1 = r0 + width;
+            for (int x = 0; x < w_out; ++x)
+                out[y * w_out + x] = std::max(std::max(r0[2 * x], r0[2 * x + 1]),
+                                              std::max(r1[2 * x], r1[2 * x + 1]));
+        }
+    }
+}
+
+void fsiv_grid_avgpool(const float *src, size_t src_channel_stride,
+                       int channels, int height, int width, int grid,
+                       float *dst)
+{
+    for (int c = 0; c < channels; ++c)
+    {
+        const float *plane = src + c * src_channel_stride;
+        float *out = dst + c * grid * grid;
+        for (int gy = 0; gy < grid; ++gy)
+        {
+            const int y0 = gy * height / grid;
+            const int y1 = (gy + 1) * height / grid;
+            for (int gx = 0; gx < grid; ++gx)
+            {
+                const int x0 = gx * width / grid;
+                const int x1 = (gx + 1) * width / grid;
+                float acc = 0.0f;
+                for (int y = y0; y < y1; ++y)
+                    for (int x = x0; x < x1; ++x)
+                        acc += plane[y * width + x];
+                const int n = (y1 - y0) * (x1 - x0);
+                out[gy * grid + gx] = n > 0 ? acc / n : 0.0f;
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+/**
+ *  @file convnet.hpp
+ *
+ *  Small CPU engine to run convolutional layers on batches of single
+ *  precision images. Feature maps are stored as planes (one per channel)
+ *  and convolutions are lowered to a matrix product with im2col.
+ */
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Single precision matrix product C = A * B (+ C).
+ *
+ * Row major operands. The product is blocked so a KCxNC panel of B stays
+ * in L2 and four rows of C are updated per pass to reuse every loaded row
+ * of B. The inner loops are written to be vectorized by the compiler.
+ * It is single threaded: parallelize over independent products.
+ *
+ * @param M is the num. of rows of A and C.
+ * @param N is the num. of columns of B and C.
+ * @param K is the num. of columns of A and rows of B.
+ * @param A is the MxK left operand.
+ * @param lda is the row stride of A (in floats).
+ * @param B is the KxN right operand.
+ * @param ldb is the row stride of B (in floats).
+ * @param C is the MxN result.
+ * @param ldc is the row stride of C (in floats).
+ * @param accumulate if true C += A*B else C = A*B.
+ */
+void fsiv_sgemm(int M, int N, int K,
+                const float *A, size_t lda,
+                const float *B, size_t ldb,
+                float *C, size_t ldc,
+                bool accumulate = false);
+
+/**
+ * @brief Unfold the patches of a multichannel image as columns.
+ *
+ * Row (c*k + ky)*k + kx of the output holds, for every output pixel, the
+ * input value under kernel tap (ky, kx) of channel c (zero padded), so a
+ * convolution with F filters is a (F x C*k*k) by (C*k*k x H_out*W_out)
+ * product. Stride 1 is assumed.
+ *
+ * @param src is the first plane of the input.
+ * @param channel_stride is the distance (in floats) between input planes.
+ * @param channels is the num. of input channels.
+ * @param height is the input height.
+ * @param width is the input width.
+ * @param ksize is the kernel size.
+ * @param pad is the zero padding on each border.
+ * @param cols is the output, with (channels*ksize*ksize) rows.
+ * @param ld is the row stride of cols (in floats), at least H_out*W_out
+ *        with H_out = height + 2*pad - ksize + 1 (same for W_out).
+ */
+void fsiv_im2col(const float *src, size_t channel_stride,
+                 int channels, int height, int width,
+                 int ksize, int pad, float *cols, size_t ld);
+
+/**
+ * @brief Add a per channel bias and apply ReLU in place.
+ *
+ * @param maps is the first plane.
+ * @param channel_stride is the distance (in floats) between planes.
+ * @param channels is the num. of planes.
+ * @param size is the num. of values per plane.
+ * @param bias is the bias per channel (can be nullptr).
+ * @param relu if false only the bias is added.
+ */
+void fsiv_bias_relu(float *maps, size_t channel_stride, int channels,
+                    int size, const float *bias, bool relu = true);
+
+/**
+ * @brief 2x2 max pooling with stride 2.
+ *
+ * @param src is the first input plane.
+ * @param src_channel_stride is the distance (in floats) between input planes.
+ * @param channels is the num. of planes.
+ * @param height is the input height.
+ * @param width is the input width.
+ * @param dst is the output, planes of (height/2)x(width/2) stored contiguously.
+ */
+void fsiv_maxpool2(const float *src, size_t src_channel_stride, int channels,
+                   int height, int width, float *dst);
+
+/**
+ * @brief Average pooling of each plane over a GxG grid of cells.
+ *
+ * @param src is the first input plane.
+ * @param src_channel_stride is the distance (in floats) between input planes.
+ * @param channels is the num. of planes.
+ * @param height is the input height.
+ * @param width is the input width.
+ * @param grid is the num. of cells per side.
+ * @param dst is the output, channels*grid*grid values.
+ */
+void fsiv_grid_avgpool(const float *src, size_t src_channel_stride,
+                       int channels, int height, int width, int grid,
+                       float *dst);
@@ -90,10 +90,10 @@ cv::Mat Dataset::get_sample(size_t index) const
     CV_Assert(index < size());
     cv::Mat img = cv::imread(sample_images_[index], cv::IMREAD_GRAYSCALE);
     // resize to 64x64 to reduce memory usage (was 128x128)
-    if (!img.empty() && (img.rows != 64 || img.cols != 64))
+    if (!img.empty() && (img.rows != FSIV_SAMPLE_SIZE || img.cols != FSIV_SAMPLE_SIZE))
     {
         cv::Mat resized;
-        cv::resize(img, resized, cv::Size(64, 64));
+        cv::resize(img, resized, cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE));
         return resized;
     }
     return img;
@@ -7,6 +7,14 @@
 #include <opencv2/core.hpp>
 #include <opencv2/ml.hpp>
 
+/**
+ * @brief Width and height of the images returned by Dataset::get_sample().
+ *
+ * Extractors precompute their per size tables (filters, bases, bins) for
+ * this size and recompute them only for images of other sizes.
+ */
+constexpr int FSIV_SAMPLE_SIZE = 64;
+
 /** @brief Class to manage a dataset of images and their labels */
 class Dataset
 {
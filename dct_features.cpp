@@ -0,0 +1,90 @@
+/**
+ *  @file dct_features.cpp
+ */
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include "dct_features.hpp"
+
+static std::string name_{"DCT Feature Extractor"};
+static std::string help_{
+    "  This extractor computes the DCT of the image and returns the first K\n"
+    "  coefficients in zig-zag order (the lowest frequencies). With block\n"
+    "  size B>0 the DCT is computed on each BxB block and K coefficients are\n"
+    "  kept per block.\n"
+    "  Parameters: K:B\n"
+    "    K: num. of coefficients kept (per block). Larger values are clamped\n"
+    "       to B*B (64*64 with B=0). Default 256.\n"
+    "    B: block size: 0 (whole image resized to 64x64), 8 or 16. Default 0.\n"};
+
+// Scan orders are built at compile time.
+static constexpr auto ZIGZAG_8 = fsiv_make_zigzag<8>();
+static constexpr auto ZIGZAG_16 = fsiv_make_zigzag<16>();
+static constexpr auto ZIGZAG_64 = fsiv_make_zigzag<64>();
+static_assert(ZIGZAG_8[1] == 1 && ZIGZAG_8[2] == 8 && ZIGZAG_8[3] == 16 &&
+                  ZIGZAG_8[4] == 9 && ZIGZAG_8[63] == 63,
+              "Wrong zig-zag order.");
+
+static const int GLOBAL_SIZE = 64;
+
+const std::string &
+DCTFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+DCTFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+DCTFeatures::DCTFeatures()
+{
+    type_ = FSIV_DCT;
+    params_ = {256.0f, 0.0f};
+}
+
+DCTFeatures::~DCTFeatures() {}
+
+cv::Mat
+DCTFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    const int B = int(params_[1]);
+    CV_Assert(B == 0 || B == 8 || B == 16);
+    const int N = B > 0 ? B : GLOBAL_SIZE;
+    const int K = std::min(int(params_[0]), N * N);
+    CV_Assert(K > 0);
+    const int *zigzag = B == 8 ? ZIGZAG_8.data() : (B == 16 ? ZIGZAG_16.data() : ZIGZAG_64.data());
+
+    // Per thread scratch, so several threads can share the extractor.
+    thread_local cv::Mat src, coeffs;
+    const double scale = img.depth() == CV_8U ? 1.0 / 255.0 : 1.0;
+    if (B == 0 && img.size() != cv::Size(GLOBAL_SIZE, GLOBAL_SIZE))
+    {
+        cv::resize(img, src, cv::Size(GLOBAL_SIZE, GLOBAL_SIZE), 0.0, 0.0, cv::INTER_AREA);
+        src.convertTo(src, CV_32F, scale);
+    }
+    else
+        img.convertTo(src, CV_32F, scale);
+
+    const int blocks_y = src.rows / N;
+    const int blocks_x = src.cols / N;
+    CV_Assert(blocks_y > 0 && blocks_x > 0);
+    cv::Mat features(1, blocks_y * blocks_x * K, CV_32FC1);
+    float *f = features.ptr<float>();
+    for (int by = 0; by < blocks_y; ++by)
+        for (int bx = 0; bx < blocks_x; ++bx, f += K)
+        {
+            cv::dct(src(cv::Rect(bx * N, by * N, N, N)), coeffs);
+            const float *c = coeffs.ptr<float>();
+            for (int i = 0; i < K; ++i)
+                f[i] = c[zigzag[i]];
+        }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
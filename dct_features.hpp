@@ -0,0 +1,54 @@
+/**
+ *  @file dct_features.hpp
+ */
+#pragma once
+
+#include <array>
+#include "features.hpp"
+
+/**
+ * @brief Build the zig-zag scan order (JPEG) of a NxN block.
+ *
+ * Entry i is the row major index of the i-th coefficient visited going
+ * through the anti-diagonals from the DC term, so lower frequencies come
+ * first.
+ */
+template <int N>
+constexpr std::array<int, N * N>
+fsiv_make_zigzag()
+{
+    std::array<int, N * N> table{};
+    int i = 0;
+    for (int s = 0; s < 2 * N - 1; ++s)
+    {
+        const int lo = s < N ? 0 : s - N + 1;
+        const int hi = s < N ? s : N - 1;
+        for (int k = lo; k <= hi; ++k)
+        {
+            // Odd diagonals go down (row increases), even ones go up.
+            const int row = (s % 2 == 1) ? k : lo + hi - k;
+            table[i++] = row * N + (s - row);
+        }
+    }
+    return table;
+}
+
+/**
+ * @brief Low frequency DCT features extractor.
+ *
+ * Computes the DCT of the whole image (or of each BxB block) and keeps
+ * the first K coefficients in zig-zag order.
+ */
+class DCTFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    DCTFeatures();
+    ~DCTFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+};
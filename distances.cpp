@@ -0,0 +1,444 @@
+/**
+ *  @file distances.cpp
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include "distances.hpp"
+
+// Tile sizes: a 64x256 float tile (64 Kb) plus the operand rows fit in L2.
+static const int SAMPLES_BLOCK = 64;
+static const int CENTERS_BLOCK = 256;
+// Square tiles of the symmetric leave-one-out distance matrix.
+static const int SYMMETRIC_BLOCK = 256;
+// Hamming distances are computed for this many references at a time.
+static const int CODES_BLOCK = 1024;
+
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define FSIV_POPCOUNT_CLONES \
+    __attribute__((target_clones("arch=icelake-server", "popcnt", "default")))
+#else
+#define FSIV_POPCOUNT_CLONES
+#endif
+
+cv::Mat
+fsiv_compute_sq_norms(const cv::Mat &X)
+{
+    CV_Assert(X.type() == CV_32FC1);
+    cv::Mat norms(X.rows, 1, CV_32FC1);
+    for (int i = 0; i < X.rows; ++i)
+    {
+        const float *x = X.ptr<float>(i);
+        float acc = 0.0f;
+#ifdef USE_OPENMP
+#pragma omp simd reduction(+ : acc)
+#endif
+        for (int k = 0; k < X.cols; ++k)
+            acc += x[k] * x[k];
+        norms.at<float>(i) = acc;
+    }
+    return norms;
+}
+
+void fsiv_find_nearest_centers(const cv::Mat &X, const cv::Mat &C,
+                               const cv::Mat &C_sq_norms,
+                               std::vector<int> &idx,
+                               std::vector<float> *dists)
+{
+    CV_Assert(X.type() == CV_32FC1 && C.type() == CV_32FC1);
+    CV_Assert(X.cols == C.cols && C.rows > 0);
+    CV_Assert(C_sq_norms.rows == C.rows && C_sq_norms.type() == CV_32FC1);
+
+    idx.resize(X.rows);
+    if (dists)
+        dists->resize(X.rows);
+    const int n_blocks = (X.rows + SAMPLES_BLOCK - 1) / SAMPLES_BLOCK;
+    const float *cn = C_sq_norms.ptr<float>();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static) if (n_blocks > 1)
+#endif
+    for (int b = 0; b < n_blocks; ++b)
+    {
+        const int i0 = b * SAMPLES_BLOCK;
+        const int i1 = std::min(X.rows, i0 + SAMPLES_BLOCK);
+        const cv::Mat Xb = X.rowRange(i0, i1);
+        std::vector<float> best(i1 - i0, std::numeric_limits<float>::max());
+        std::vector<int> best_idx(i1 - i0, 0);
+        cv::Mat tile;
+
+        for (int j0 = 0; j0 < C.rows; j0 += CENTERS_BLOCK)
+        {
+            const int j1 = std::min(C.rows, j0 + CENTERS_BLOCK);
+            // tile = -2 * Xb * Cb^T
+            cv::gemm(Xb, C.rowRange(j0, j1), -2.0, cv::noArray(), 0.0, tile,
+                     cv::GEMM_2_T);
+            for (int r = 0; r < tile.rows; ++r)
+            {
+                const float *t = tile.ptr<float>(r);
+                float b_d = best[r];
+                int b_i = best_idx[r];
+                for (int c = 0; c < tile.cols; ++c)
+                {
+                    const float d = t[c] + cn[j0 + c];
+                    if (d < b_d)
+                    {
+                        b_d = d;
+                        b_i = j0 + c;
+                    }
+                }
+                best[r] = b_d;
+                best_idx[r] = b_i;
+            }
+        }
+
+        for (int r = 0; r < i1 - i0; ++r)
+        {
+            idx[i0 + r] = best_idx[r];
+            if (dists)
+            {
+                // add the sample norm, it does not change the argmin.
+                const float *x = X.ptr<float>(i0 + r);
+                float xn = 0.0f;
+                for (int k = 0; k < X.cols; ++k)
+                    xn += x[k] * x[k];
+                (*dists)[i0 + r] = std::max(0.0f, best[r] + xn);
+            }
+        }
+    }
+}
+
+void fsiv_knn_search(const cv::Mat &Q, const cv::Mat &R,
+                     const cv::Mat &R_sq_norms, int K,
+                     cv::Mat &idx, cv::Mat &dists)
+{
+    CV_Assert(Q.type() == CV_32FC1 && R.type() == CV_32FC1);
+    CV_Assert(Q.cols == R.cols && R.rows > 0 && K > 0);
+    CV_Assert(R_sq_norms.rows == R.rows && R_sq_norms.type() == CV_32FC1);
+
+    K = std::min(K, R.rows);
+    idx.create(Q.rows, K, CV_32SC1);
+    dists.create(Q.rows, K, CV_32FC1);
+    const int n_blocks = (Q.rows + SAMPLES_BLOCK - 1) / SAMPLES_BLOCK;
+    const float *rn = R_sq_norms.ptr<float>();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic) if (n_blocks > 1)
+#endif
+    for (int b = 0; b < n_blocks; ++b)
+    {
+        typedef std::pair<float, int> Candidate;
+        const int i0 = b * SAMPLES_BLOCK;
+        const int i1 = std::min(Q.rows, i0 + SAMPLES_BLOCK);
+        const cv::Mat Qb = Q.rowRange(i0, i1);
+        // A max-heap of K candidates per query, the worst one on top.
+        std::vector<Candidate> heaps(size_t(i1 - i0) * K);
+        std::vector<int> sizes(i1 - i0, 0);
+        cv::Mat tile;
+
+        for (int j0 = 0; j0 < R.rows; j0 += CENTERS_BLOCK)
+        {
+            const int j1 = std::min(R.rows, j0 + CENTERS_BLOCK);
+            // tile = -2 * Qb * Rb^T
+            cv::gemm(Qb, R.rowRange(j0, j1), -2.0, cv::noArray(), 0.0, tile,
+                     cv::GEMM_2_T);
+            for (int r = 0; r < tile.rows; ++r)
+            {
+                const float *t = tile.ptr<float>(r);
+                Candidate *heap = heaps.data() + size_t(r) * K;
+                int n = sizes[r];
+                float worst = n == K ? heap[0].first
+                                     : std::numeric_limits<float>::max();
+                for (int c = 0; c < tile.cols; ++c)
+                {
+                    const float d = t[c] + rn[j0 + c];
+                    if (n < K)
+                    {
+                        heap[n++] = Candidate(d, j0 + c);
+                        std::push_heap(heap, heap + n);
+                        if (n == K)
+                            worst = heap[0].first;
+                    }
+                    else if (d < worst)
+                    {
+                        std::pop_heap(heap, heap + K);
+                        heap[K - 1] = Candidate(d, j0 + c);
+                        std::push_heap(heap, heap + K);
+                        worst = heap[0].first;
+                    }
+                }
+                sizes[r] = n;
+            }
+        }
+
+        for (int r = 0; r < i1 - i0; ++r)
+        {
+            Candidate *heap = heaps.data() + size_t(r) * K;
+            std::sort_heap(heap, heap + K);
+            // add the query norm, it does not change the order.
+            const float *q = Q.ptr<float>(i0 + r);
+            float qn = 0.0f;
+            for (int k = 0; k < Q.cols; ++k)
+                qn += q[k] * q[k];
+            int *ix = idx.ptr<int>(i0 + r);
+            float *dx = dists.ptr<float>(i0 + r);
+            for (int k = 0; k < K; ++k)
+            {
+                ix[k] = heap[k].second;
+                dx[k] = std::max(0.0f, heap[k].first + qn);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Offer a candidate to a bounded max-heap of K candidates.
+ * @param n is the current heap size, updated.
+ */
+static inline void
+push_candidate(std::pair<float, int> *heap, int &n, int K,
+               const std::pair<float, int> &c)
+{
+    if (n < K)
+    {
+        heap[n++] = c;
+        std::push_heap(heap, heap + n);
+    }
+    else if (c < heap[0])
+    {
+        std::pop_heap(heap, heap + K);
+        heap[K - 1] = c;
+        std::push_heap(heap, heap + K);
+    }
+}
+
+void fsiv_loo_knn_search(const cv::Mat &X, const cv::Mat &X_sq_norms, int K,
+                         cv::Mat &idx, cv::Mat &dists)
+{
+    CV_Assert(X.type() == CV_32FC1 && X.rows > 1 && K > 0);
+    CV_Assert(X_sq_norms.rows == X.rows && X_sq_norms.type() == CV_32FC1);
+
+    typedef std::pair<float, int> Candidate;
+    const int N = X.rows;
+    K = std::min(K, N - 1);
+    const int n_blocks = (N + SYMMETRIC_BLOCK - 1) / SYMMETRIC_BLOCK;
+    const float *xn = X_sq_norms.ptr<float>();
+    // A max-heap of K candidates per sample, the worst one on top.
+    std::vector<Candidate> heaps(size_t(N) * K);
+    std::vector<int> sizes(N, 0);
+    std::vector<std::mutex> locks(n_blocks);
+
+    // The tiles (bi, bj) with bi <= bj, in row major order.
+    std::vector<std::pair<int, int>> tiles;
+    tiles.reserve(size_t(n_blocks) * (n_blocks + 1) / 2);
+    for (int bi = 0; bi < n_blocks; ++bi)
+        for (int bj = bi; bj < n_blocks; ++bj)
+            tiles.push_back(std::make_pair(bi, bj));
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic) if (tiles.size() > 1)
+#endif
+    for (int t = 0; t < int(tiles.size()); ++t)
+    {
+        const int i0 = tiles[t].first * SYMMETRIC_BLOCK;
+        const int i1 = std::min(N, i0 + SYMMETRIC_BLOCK);
+        const int j0 = tiles[t].second * SYMMETRIC_BLOCK;
+        const int j1 = std::min(N, j0 + SYMMETRIC_BLOCK);
+        // tile = ||xi||^2 + ||xj||^2 - 2 * Xi * Xj^T
+        cv::Mat tile;
+        cv::gemm(X.rowRange(i0, i1), X.rowRange(j0, j1), -2.0, cv::noArray(),
+                 0.0, tile, cv::GEMM_2_T);
+        for (int r = 0; r < tile.rows; ++r)
+        {
+            float *d = tile.ptr<float>(r);
+            for (int c = 0; c < tile.cols; ++c)
+                d[c] = std::max(0.0f, d[c] + xn[i0 + r] + xn[j0 + c]);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(locks[tiles[t].first]);
+            for (int r = 0; r < tile.rows; ++r)
+            {
+                const float *d = tile.ptr<float>(r);
+                Candidate *heap = heaps.data() + size_t(i0 + r) * K;
+                int &n = sizes[i0 + r];
+                for (int c = 0; c < tile.cols; ++c)
+                    if (i0 + r != j0 + c)
+                        push_candidate(heap, n, K, Candidate(d[c], j0 + c));
+            }
+        }
+        // A diagonal tile already offered both directions.
+        if (i0 == j0)
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(locks[tiles[t].second]);
+            for (int c = 0; c < tile.cols; ++c)
+            {
+                Candidate *heap = heaps.data() + size_t(j0 + c) * K;
+                int &n = sizes[j0 + c];
+                for (int r = 0; r < tile.rows; ++r)
+                    push_candidate(heap, n, K,
+                                   Candidate(tile.at<float>(r, c), i0 + r));
+            }
+        }
+    }
+
+    idx.create(N, K, CV_32SC1);
+    dists.create(N, K, CV_32FC1);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < N; ++i)
+    {
+        Candidate *heap = heaps.data() + size_t(i) * K;
+        std::sort_heap(heap, heap + K);
+        int *ix = idx.ptr<int>(i);
+        float *dx = dists.ptr<float>(i);
+        for (int k = 0; k < K; ++k)
+        {
+            ix[k] = heap[k].second;
+            dx[k] = heap[k].first;
+        }
+    }
+}
+
+/**
+ * @brief Load a 64 bit word of a code from a byte buffer.
+ */
+static inline uint64_t
+load_word(const uchar *p)
+{
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+/**
+ * @brief Hamming distances from a query to n references of WORDS words.
+ *
+ * With the number of words known at compile time the inner loop is fully
+ * unrolled, so the loop over the references is vectorized (VPOPCNTQ in
+ * the AVX-512 clone).
+ */
+template <int WORDS>
+FSIV_POPCOUNT_CLONES static void
+hamming_distances_fixed(const uint64_t *q, const uchar *refs, int n, int *out)
+{
+    uint64_t qw[WORDS];
+    for (int w = 0; w < WORDS; ++w)
+        qw[w] = q[w];
+    for (int r = 0; r < n; ++r)
+    {
+        const uchar *x = refs + size_t(r) * WORDS * sizeof(uint64_t);
+        int d = 0;
+        for (int w = 0; w < WORDS; ++w)
+            d += __builtin_popcountll(qw[w] ^ load_word(x + w * sizeof(uint64_t)));
+        out[r] = d;
+    }
+}
+
+/**
+ * @brief Hamming distances from a query to n references of @a words words.
+ */
+FSIV_POPCOUNT_CLONES
+static void
+hamming_distances_any(const uint64_t *q, const uchar *refs, int n, int words,
+                      int *out)
+{
+    for (int r = 0; r < n; ++r)
+    {
+        const uchar *x = refs + size_t(r) * words * sizeof(uint64_t);
+        int d = 0;
+        for (int w = 0; w < words; ++w)
+            d += __builtin_popcountll(q[w] ^ load_word(x + w * sizeof(uint64_t)));
+        out[r] = d;
+    }
+}
+
+/**
+ * @brief Dispatch the Hamming distances kernel for the code size.
+ */
+static void
+hamming_distances(const uint64_t *q, const uchar *refs, int n, int words,
+                  int *out)
+{
+    switch (words)
+    {
+    case 1:
+        hamming_distances_fixed<1>(q, refs, n, out);
+        break;
+    case 2:
+        hamming_distances_fixed<2>(q, refs, n, out);
+        break;
+    case 4:
+        hamming_distances_fixed<4>(q, refs, n, out);
+        break;
+    default:
+        hamming_distances_any(q, refs, n, words, out);
+        break;
+    }
+}
+
+void fsiv_hamming_knn_search(const cv::Mat &Q, const cv::Mat &R, int K,
+                             cv::Mat &idx, cv::Mat &dists)
+{
+    CV_Assert(Q.type() == CV_8UC1 && R.type() == CV_8UC1);
+    CV_Assert(Q.cols == R.cols && Q.cols % 8 == 0 && R.isContinuous());
+    CV_Assert(R.rows > 0 && K > 0);
+
+    K = std::min(K, R.rows);
+    idx.create(Q.rows, K, CV_32SC1);
+    dists.create(Q.rows, K, CV_32SC1);
+    const int words = Q.cols / 8;
+    const uchar *refs = R.ptr();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16) if (Q.rows > 1)
+#endif
+    for (int i = 0; i < Q.rows; ++i)
+    {
+        typedef std::pair<int, int> Candidate;
+        std::vector<uint64_t> q(words);
+        std::memcpy(q.data(), Q.ptr(i), Q.cols);
+        std::vector<int> d(std::min(CODES_BLOCK, R.rows));
+        // A max-heap of K candidates, the worst one on top.
+        std::vector<Candidate> heap;
+        heap.reserve(K);
+        int worst = std::numeric_limits<int>::max();
+        for (int j0 = 0; j0 < R.rows; j0 += CODES_BLOCK)
+        {
+            const int n = std::min(CODES_BLOCK, R.rows - j0);
+            hamming_distances(q.data(), refs + size_t(j0) * R.cols, n, words,
+                              d.data());
+            for (int j = 0; j < n; ++j)
+            {
+                if (int(heap.size()) < K)
+                {
+                    heap.push_back(Candidate(d[j], j0 + j));
+                    std::push_heap(heap.begin(), heap.end());
+                    if (int(heap.size()) == K)
+                        worst = heap[0].first;
+                }
+                else if (d[j] < worst)
+                {
+                    std::pop_heap(heap.begin(), heap.end());
+                    heap.back() = Candidate(d[j], j0 + j);
+                    std::push_heap(heap.begin(), heap.end());
+                    worst = heap[0].first;
+                }
+            }
+        }
+
+        std::sort_heap(heap.begin(), heap.end());
+        int *ix = idx.ptr<int>(i);
+        int *dx = dists.ptr<int>(i);
+        for (int k = 0; k < K; ++k)
+        {
+            ix[k] = heap[k].second;
+            dx[k] = heap[k].first;
+        }
+    }
+}
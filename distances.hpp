@@ -0,0 +1,110 @@
+/**
+ *  @file distances.hpp
+ */
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Compute the squared L2 norm of each row of a matrix.
+ *
+ * @param X is the input matrix (one sample per row).
+ * @return a column vector with the squared norms.
+ * @pre X.type()==CV_32FC1
+ * @post ret_v.rows==X.rows
+ * @post ret_v.type()==CV_32FC1
+ */
+cv::Mat fsiv_compute_sq_norms(const cv::Mat &X);
+
+/**
+ * @brief Find the nearest center (squared L2 distance) of each sample.
+ *
+ * Distances are computed as ||x||^2 + ||c||^2 - 2x·c by tiles of samples
+ * and centers, so each tile is a small GEMM that fits in cache and the
+ * full samples x centers distance matrix is never allocated. Tiles of
+ * samples are processed in parallel.
+ *
+ * @param X are the samples (one per row).
+ * @param C are the centers (one per row).
+ * @param C_sq_norms are the squared norms of the centers.
+ * @param[out] idx is the index of the nearest center for each sample.
+ * @param[out] dists if not null, the squared distance to the nearest center.
+ * @pre X.type()==CV_32FC1 && C.type()==CV_32FC1
+ * @pre X.cols==C.cols && C.rows>0
+ * @pre C_sq_norms.rows==C.rows
+ * @post idx.size()==X.rows
+ */
+void fsiv_find_nearest_centers(const cv::Mat &X, const cv::Mat &C,
+                               const cv::Mat &C_sq_norms,
+                               std::vector<int> &idx,
+                               std::vector<float> *dists = nullptr);
+
+/**
+ * @brief Find the K nearest references (squared L2 distance) of each query.
+ *
+ * Uses the same tiled ||q||^2 + ||r||^2 - 2q·r scheme as
+ * fsiv_find_nearest_centers(), keeping the K best candidates of each query
+ * in a bounded max-heap. Tiles of queries are processed in parallel.
+ *
+ * @param Q are the queries (one per row).
+ * @param R are the references (one per row).
+ * @param R_sq_norms are the squared norms of the references.
+ * @param K is the number of neighbours (clipped to R.rows).
+ * @param[out] idx is a Q.rows x K CV_32SC1 matrix with the indices of the
+ * neighbours sorted by increasing distance (ties by increasing index).
+ * @param[out] dists is a Q.rows x K CV_32FC1 matrix with their squared
+ * distances.
+ * @pre Q.type()==CV_32FC1 && R.type()==CV_32FC1
+ * @pre Q.cols==R.cols && R.rows>0 && K>0
+ * @pre R_sq_norms.rows==R.rows
+ */
+void fsiv_knn_search(const cv::Mat &Q, const cv::Mat &R,
+                     const cv::Mat &R_sq_norms, int K,
+                     cv::Mat &idx, cv::Mat &dists);
+
+/**
+ * @brief Find the K nearest other samples (squared L2 distance) of each
+ * sample of a set, i.e. the leave-one-out neighbours.
+ *
+ * The distance matrix is symmetric, so only the tiles on and above the
+ * diagonal are computed (half the GEMM work of fsiv_knn_search(X, X, ...))
+ * and each distance is offered to the heaps of both samples. Self matches
+ * are skipped. Tiles are processed in parallel; the heaps of a block of
+ * samples are updated under a per block lock.
+ *
+ * @param X are the samples (one per row).
+ * @param X_sq_norms are the squared norms of the samples.
+ * @param K is the number of neighbours (clipped to X.rows-1).
+ * @param[out] idx is a X.rows x K CV_32SC1 matrix with the indices of the
+ * neighbours sorted by increasing distance (ties by increasing index).
+ * @param[out] dists is a X.rows x K CV_32FC1 matrix with their squared
+ * distances.
+ * @pre X.type()==CV_32FC1 && X.rows>1 && K>0
+ * @pre X_sq_norms.rows==X.rows
+ */
+void fsiv_loo_knn_search(const cv::Mat &X, const cv::Mat &X_sq_norms, int K,
+                         cv::Mat &idx, cv::Mat &dists);
+
+/**
+ * @brief Find the K nearest references (Hamming distance) of each query.
+ *
+ * Codes are packed bit vectors, one per row, compared by 64 bit words with
+ * XOR + popcount. The kernel is compiled for several instruction sets
+ * (AVX-512 VPOPCNTQ, POPCNT and generic x86-64) and the best one for the
+ * running CPU is selected at load time. Codes of 64, 128 and 256 bits have
+ * specialized kernels that are vectorized across references; other sizes
+ * use a scalar loop. Blocks of queries are processed in parallel.
+ *
+ * @param Q are the query codes (one per row).
+ * @param R are the reference codes (one per row).
+ * @param K is the number of neighbours (clipped to R.rows).
+ * @param[out] idx is a Q.rows x K CV_32SC1 matrix with the indices of the
+ * neighbours sorted by increasing distance (ties by increasing index).
+ * @param[out] dists is a Q.rows x K CV_32SC1 matrix with their distances.
+ * @pre Q.type()==CV_8UC1 && R.type()==CV_8UC1
+ * @pre Q.cols==R.cols && Q.cols%8==0 && R.isContinuous()
+ * @pre R.rows>0 && K>0
+ */
+void fsiv_hamming_knn_search(const cv::Mat &Q, const cv::Mat &R, int K,
+                             cv::Mat &idx, cv::Mat &dists);
@@ -13,6 +13,20 @@
 // Hint: use gray_levels_features.hpp and gray_levels_features.cpp as model to
 //   make yours.
 #include "gray_levels_features.hpp"
+#include "bovw_features.hpp"
+#include "glcm_features.hpp"
+#include "gabor_features.hpp"
+#include "zernike_features.hpp"
+#include "polar_features.hpp"
+#include "random_conv_features.hpp"
+#include "cnn_features.hpp"
+#include "dct_features.hpp"
+#include "wavelet_features.hpp"
+#include "shape_features.hpp"
+#include "lbp_features.hpp"
+#include "lpq_features.hpp"
+#include "fisher_features.hpp"
+#include "fourier_features.hpp"
 // #include "xxxxxx.hpp"
 
 // Remember: update CMakeLists.txt with the new files.
@@ -34,6 +48,76 @@ cv::Ptr<FeaturesExtractor> FeaturesExtractor::create(FEATURE_IDS id)
         extractor = cv::makePtr<GrayLevelsFeatures>();
         break;
     }
+    case FSIV_BOVW:
+    {
+        extractor = cv::makePtr<BOVWFeatures>();
+        break;
+    }
+    case FSIV_GLCM:
+    {
+        extractor = cv::makePtr<GLCMFeatures>();
+        break;
+    }
+    case FSIV_GABOR:
+    {
+        extractor = cv::makePtr<GaborFeatures>();
+        break;
+    }
+    case FSIV_ZERNIKE:
+    {
+        extractor = cv::makePtr<ZernikeFeatures>();
+        break;
+    }
+    case FSIV_POLAR_PROFILE:
+    {
+        extractor = cv::makePtr<PolarFeatures>();
+        break;
+    }
+    case FSIV_RANDOM_CONV:
+    {
+        extractor = cv::makePtr<RandomConvFeatures>();
+        break;
+    }
+    case FSIV_CNN:
+    {
+        extractor = cv::makePtr<CNNFeatures>();
+        break;
+    }
+    case FSIV_DCT:
+    {
+        extractor = cv::makePtr<DCTFeatures>();
+        break;
+    }
+    case FSIV_WAVELET:
+    {
+        extractor = cv::makePtr<WaveletFeatures>();
+        break;
+    }
+    case FSIV_SHAPE:
+    {
+        extractor = cv::makePtr<ShapeFeatures>();
+        break;
+    }
+    case FSIV_LBP:
+    {
+        extractor = cv::makePtr<LBPFeatures>();
+        break;
+    }
+    case FSIV_LPQ:
+    {
+        extractor = cv::makePtr<LPQFeatures>();
+        break;
+    }
+    case FSIV_FISHER:
+    {
+        extractor = cv::makePtr<FisherFeatures>();
+        break;
+    }
+    case FSIV_FOURIER:
+    {
+        extractor = cv::makePtr<FourierFeatures>();
+        break;
+    }
 
         // TODO: add here 'cases' for your features.
         // case FSIV_XXXXX: {
@@ -53,6 +137,9 @@ cv::Ptr<FeaturesExtractor> FeaturesExtractor::create(FEATURE_IDS id)
     return extractor;
 }
 
+// Num. of images passed at once to FeaturesExtractor::extract_features_batch().
+static const size_t EXTRACTION_BATCH_SIZE = 256;
+
 std::tuple<cv::Mat, cv::Mat>
 fsiv_extract_features(const Dataset &dt,
                       cv::Ptr<FeaturesExtractor> &extractor)
@@ -73,40 +160,49 @@ fsiv_extract_features(const Dataset &dt,
     feature.copyTo(X.row(0));
     y.at<int>(0, 0) = dt.get_label(0);
 
-    // Process the rest of dt.
-    // Note: OpenMP disabled to avoid recursive termination on errors
-    // #ifdef USE_OPENMP
-    // #pragma omp parallel for
-    // #endif
-    for (size_t i = 1; i < dt.size(); ++i)
-    {
-        cv::Mat sample;
-        int label;
-        std::tie(sample, label) = dt[i];
-        if (sample.empty())
+    // Process the rest of dt by batches.
+    std::vector<cv::Mat> batch;
+    std::vector<size_t> batch_idx;
+    for (size_t b = 1; b < dt.size(); b += EXTRACTION_BATCH_SIZE)
+    {
+        const size_t b_end = std::min(dt.size(), b + EXTRACTION_BATCH_SIZE);
+        batch.clear();
+        batch_idx.clear();
+        for (size_t i = b; i < b_end; ++i)
         {
-            std::cerr << "Warning: sample " << i << " is empty (file not found or corrupted). File: " << dt.get_sample_filename(i) << std::endl;
-            std::cerr << "Skipping this sample and using zeros for features." << std::endl;
-            // use zeros for missing images (same size as first feature)
-            cv::Mat zero_features = cv::Mat::zeros(1, feature.cols, CV_32FC1);
-            zero_features.copyTo(X.row(i));
+            cv::Mat sample;
+            int label;
+            std::tie(sample, label) = dt[i];
             y.at<int>(int(i), 0) = label;
-            continue;
+            if (sample.empty())
+            {
+                std::cerr << "Warning: sample " << i << " is empty (file not found or corrupted). File: " << dt.get_sample_filename(i) << std::endl;
+                std::cerr << "Skipping this sample and using zeros for features." << std::endl;
+                // use zeros for missing images (same size as first feature)
+                X.row(int(i)).setTo(0.0f);
+                continue;
+            }
+            batch.push_back(sample);
+            batch_idx.push_back(i);
         }
+        if (batch.empty())
+            continue;
         try
         {
-            extractor->extract_features(sample).copyTo(X.row(i));
-            y.at<int>(int(i), 0) = label;
+            cv::Mat F = extractor->extract_features_batch(batch);
+            for (size_t k = 0; k < batch_idx.size(); ++k)
+                F.row(int(k)).copyTo(X.row(int(batch_idx[k])));
         }
         catch (cv::Exception &e)
         {
-            std::cerr << "OpenCV error processing sample " << i << ": " << dt.get_sample_filename(i) << std::endl;
+            std::cerr << "OpenCV error processing samples " << b << " to " << b_end - 1
+                      << ", first file: " << dt.get_sample_filename(b) << std::endl;
             std::cerr << "Error: " << e.what() << std::endl;
             throw;
         }
-        if (i % 1000 == 0)
+        if (b_end / 1000 != b / 1000)
         {
-            std::cout << "Processed " << i << " / " << dt.size() << " samples..." << std::endl;
+            std::cout << "Processed " << (b_end / 1000) * 1000 << " / " << dt.size() << " samples..." << std::endl;
         }
     }
     return std::make_tuple(X, y);
@@ -114,8 +210,14 @@ fsiv_extract_features(const Dataset &dt,
 
 void FeaturesExtractor::set_params(const std::vector<float> &new_p)
 {
-    if (new_p.size() != 0)
-        params_ = new_p;
+    // Trailing parameters not given keep their current (default) values.
+    for (size_t i = 0; i < new_p.size(); ++i)
+    {
+        if (i < params_.size())
+            params_[i] = new_p[i];
+        else
+            params_.push_back(new_p[i]);
+    }
 }
 
 const std::vector<float> &
@@ -124,6 +226,22 @@ FeaturesExtractor::get_params() const
     return params_;
 }
 
+cv::Mat
+FeaturesExtractor::extract_features_batch(const std::vector<cv::Mat> &imgs)
+{
+    CV_Assert(imgs.size() > 0);
+    cv::Mat features;
+    for (size_t i = 0; i < imgs.size(); ++i)
+    {
+        cv::Mat f = extract_features(imgs[i]);
+        if (features.empty())
+            features.create(int(imgs.size()), f.cols, CV_32FC1);
+        f.copyTo(features.row(int(i)));
+    }
+    CV_Assert(features.rows == int(imgs.size()));
+    return features;
+}
+
 void FeaturesExtractor::train(const Dataset &dt)
 {
     // do nothing.
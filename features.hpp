@@ -21,13 +21,25 @@ public:
     typedef enum
     {
         FSIV_01_GREY_LEVELS = 0,
+        FSIV_BOVW = 1,
+        FSIV_GLCM = 2,
+        FSIV_GABOR = 3,
+        FSIV_ZERNIKE = 4,
+        FSIV_POLAR_PROFILE = 5,
+        FSIV_RANDOM_CONV = 6,
+        FSIV_CNN = 7,
+        FSIV_DCT = 8,
+        FSIV_WAVELET = 9,
+        FSIV_SHAPE = 10,
+        FSIV_LBP = 11,
+        FSIV_LPQ = 12,
+        FSIV_FISHER = 13,
+        FSIV_FOURIER = 14,
         // TODO: Add new features to extract.
-        // FSIV_MEAN_STDDEV_GREY_LEVELS = 1,
-        // FSIV_LBP_HISTOGRAM = 2,
-        // FSIV_HOG = 3,
-        // FSIV_BOVW = 4,
+        // FSIV_MEAN_STDDEV_GREY_LEVELS,
+        // FSIV_HOG,
         //....
-        FSIV_NEXT_FEATURE_ID = 1 // Update this value when a new feature is added.
+        FSIV_NEXT_FEATURE_ID = 15 // Update this value when a new feature is added.
     } FEATURE_IDS;
 
     /**
@@ -66,9 +78,11 @@ public:
 
     /**
      * @brief Set extractor parameters.
+     * Trailing parameters not given keep their current (default) values.
+     * Override it if your extractor precomputes data from the parameters.
      * @param params are the parameters.
      */
-    void set_params(const std::vector<float> &params);
+    virtual void set_params(const std::vector<float> &params);
 
     /**
      * @brief Get extactor parameters.
@@ -93,6 +107,18 @@ public:
      */
     virtual cv::Mat extract_features(const cv::Mat &img) = 0;
 
+    /**
+     * @brief Extract features from a batch of images.
+     * By default extract_features() is called for each image. Override it
+     * if your extractor can process several images at once more efficiently.
+     * @param imgs are the input images.
+     * @return the extracted features, one row per image.
+     * @pre imgs.size()>0
+     * @post ret_v.type()==CV_32FC1
+     * @post ret_v.rows==imgs.size()
+     */
+    virtual cv::Mat extract_features_batch(const std::vector<cv::Mat> &imgs);
+
     /**
      * @brief Save the trained data for the feature extractor.
      *
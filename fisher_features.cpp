@@ -0,0 +1,334 @@
+/**
+ *  @file fisher_features.cpp
+ */
+#include <cmath>
+#include <vector>
+#include "bovw_features.hpp"
+#include "kmeans.hpp"
+#include "fisher_features.hpp"
+
+static std::string name_{"Fisher Vector Feature Extractor"};
+static std::string help_{
+    "  This extractor computes dense SIFT-like descriptors (as BoVW),\n"
+    "  reduces them with PCA and encodes them as a Fisher Vector of a\n"
+    "  diagonal GMM learnt with EM (2*K*R features, power and L2\n"
+    "  normalized).\n"
+    "  Parameters: K:P:S:N:D:R:I\n"
+    "    K: num. of GMM components. Default 16.\n"
+    "    P: patch size in pixels (multiple of 4). Default 16.\n"
+    "    S: stride in pixels (multiple of P/4). Default 8.\n"
+    "    N: num. of train images sampled to learn the GMM (0 means all).\n"
+    "       Default 2000.\n"
+    "    D: num. of descriptors sampled per train image. Default 32.\n"
+    "    R: PCA dimensions (0 means no PCA). Default 32.\n"
+    "    I: max. num. of EM iterations. Default 30.\n"};
+
+// Descriptors processed by each EM work item.
+static const int EM_BLOCK_SIZE = 1024;
+// Relative log-likelihood improvement to stop EM.
+static const double EM_TOLERANCE = 1e-5;
+// Variance floor relative to the global variance of each dimension.
+static const double VARIANCE_FLOOR = 1e-3;
+
+const std::string &
+FisherFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+FisherFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+FisherFeatures::FisherFeatures()
+{
+    type_ = FSIV_FISHER;
+    params_ = {16.0f, 16.0f, 8.0f, 2000.0f, 32.0f, 32.0f, 30.0f};
+}
+
+FisherFeatures::~FisherFeatures() {}
+
+cv::Mat
+FisherFeatures::project(const cv::Mat &descs) const
+{
+    if (pca_vectors_.empty())
+        return descs;
+    cv::Mat centered, projected;
+    cv::subtract(descs, cv::repeat(pca_mean_, descs.rows, 1), centered);
+    cv::gemm(centered, pca_vectors_, 1.0, cv::noArray(), 0.0, projected, cv::GEMM_2_T);
+    return projected;
+}
+
+void FisherFeatures::update_gmm_cache()
+{
+    const int K = means_.rows;
+    cv::divide(1.0, variances_, inv_var_);
+    mean_inv_var_ = means_.mul(inv_var_);
+    log_const_.create(1, K, CV_32FC1);
+    for (int k = 0; k < K; ++k)
+    {
+        const float *m = means_.ptr<float>(k);
+        const float *v = variances_.ptr<float>(k);
+        double c = std::log(double(weights_.at<float>(k)));
+        for (int d = 0; d < means_.cols; ++d)
+            c -= 0.5 * (std::log(2.0 * CV_PI * v[d]) + double(m[d]) * m[d] / v[d]);
+        log_const_.at<float>(k) = float(c);
+    }
+}
+
+double
+FisherFeatures::posteriors(const cv::Mat &X, cv::Mat &gamma) const
+{
+    // log N(x|k) = -0.5*x^2/var + x*mean/var + const_k, so all the log
+    // densities of a block are two matrix products.
+    cv::Mat linear, L;
+    cv::gemm(X, mean_inv_var_, 1.0, cv::noArray(), 0.0, linear, cv::GEMM_2_T);
+    cv::gemm(X.mul(X), inv_var_, -0.5, linear, 1.0, L, cv::GEMM_2_T);
+
+    const int K = L.cols;
+    const float *c = log_const_.ptr<float>();
+    std::vector<float> max_l(L.rows);
+    for (int i = 0; i < L.rows; ++i)
+    {
+        float *l = L.ptr<float>(i);
+        float m = l[0] + c[0];
+        for (int k = 0; k < K; ++k)
+        {
+            l[k] += c[k];
+            m = std::max(m, l[k]);
+        }
+        for (int k = 0; k < K; ++k)
+            l[k] -= m;
+        max_l[i] = m;
+    }
+    // Log-sum-exp: exponentiate the shifted block at once.
+    cv::exp(L, gamma);
+    double log_likelihood = 0.0;
+    for (int i = 0; i < gamma.rows; ++i)
+    {
+        float *g = gamma.ptr<float>(i);
+        float s = 0.0f;
+        for (int k = 0; k < K; ++k)
+            s += g[k];
+        const float inv = 1.0f / s;
+        for (int k = 0; k < K; ++k)
+            g[k] *= inv;
+        log_likelihood += max_l[i] + std::log(s);
+    }
+    return log_likelihood;
+}
+
+void FisherFeatures::train(const Dataset &dt)
+{
+    CV_Assert(dt.size() > 0);
+    const int K = int(params_[0]);
+    const int patch_size = int(params_[1]);
+    const int stride = int(params_[2]);
+    const size_t n_images = size_t(std::max(params_[3], 0.0f));
+    const int per_image = int(params_[4]);
+    const int R = int(params_[5]);
+    const int iterations = int(params_[6]);
+    CV_Assert(K > 0 && per_image > 0 && R >= 0 && iterations >= 0);
+
+    cv::RNG &rng = cv::theRNG();
+    cv::Mat samples = fsiv_sample_dense_descriptors(dt, patch_size, stride,
+                                                    n_images, per_image, rng);
+    if (samples.rows < K)
+        throw std::runtime_error("Error: not enough descriptors (" +
+                                 std::to_string(samples.rows) +
+                                 ") to learn the GMM.");
+
+    pca_mean_.release();
+    pca_vectors_.release();
+    if (R > 0 && R < samples.cols)
+    {
+        cv::PCA pca(samples, cv::noArray(), cv::PCA::DATA_AS_ROW, R);
+        pca.mean.convertTo(pca_mean_, CV_32F);
+        pca.eigenvectors.convertTo(pca_vectors_, CV_32F);
+    }
+    const cv::Mat X = project(samples);
+    const int N = X.rows;
+    const int dims = X.cols;
+
+    // Initialization: k-means centers, global variances, uniform weights.
+    cv::Mat global_mean, global_sq;
+    cv::reduce(X, global_mean, 0, cv::REDUCE_AVG, CV_64F);
+    cv::reduce(X.mul(X), global_sq, 0, cv::REDUCE_AVG, CV_64F);
+    cv::Mat global_var = global_sq - global_mean.mul(global_mean);
+    cv::Mat var_floor;
+    global_var.convertTo(var_floor, CV_32F, VARIANCE_FLOOR);
+    var_floor += 1e-8;
+    means_ = fsiv_minibatch_kmeans(X, K, 2048, 100, rng);
+    global_var.convertTo(global_var, CV_32F);
+    cv::max(cv::repeat(global_var, K, 1), cv::repeat(var_floor, K, 1), variances_);
+    weights_ = cv::Mat(1, K, CV_32FC1, cv::Scalar(1.0 / K));
+
+    const int n_blocks = (N + EM_BLOCK_SIZE - 1) / EM_BLOCK_SIZE;
+    double prev_ll = 0.0;
+    for (int it = 0; it < iterations; ++it)
+    {
+        update_gmm_cache();
+
+        // E step over blocks in parallel, each thread accumulating its own
+        // sufficient statistics.
+        cv::Mat S0 = cv::Mat::zeros(1, K, CV_64FC1);
+        cv::Mat S1 = cv::Mat::zeros(K, dims, CV_64FC1);
+        cv::Mat S2 = cv::Mat::zeros(K, dims, CV_64FC1);
+        double ll = 0.0;
+#ifdef USE_OPENMP
+#pragma omp parallel
+#endif
+        {
+            cv::Mat s0 = cv::Mat::zeros(1, K, CV_64FC1);
+            cv::Mat s1 = cv::Mat::zeros(K, dims, CV_64FC1);
+            cv::Mat s2 = cv::Mat::zeros(K, dims, CV_64FC1);
+            double local_ll = 0.0;
+            cv::Mat gamma, t;
+#ifdef USE_OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (int b = 0; b < n_blocks; ++b)
+            {
+                const cv::Mat Xb = X.rowRange(b * EM_BLOCK_SIZE, std::min(N, (b + 1) * EM_BLOCK_SIZE));
+                local_ll += posteriors(Xb, gamma);
+                cv::reduce(gamma, t, 0, cv::REDUCE_SUM, CV_64F);
+                s0 += t;
+                cv::gemm(gamma, Xb, 1.0, cv::noArray(), 0.0, t, cv::GEMM_1_T);
+                t.convertTo(t, CV_64F);
+                s1 += t;
+                cv::gemm(gamma, Xb.mul(Xb), 1.0, cv::noArray(), 0.0, t, cv::GEMM_1_T);
+                t.convertTo(t, CV_64F);
+                s2 += t;
+            }
+#ifdef USE_OPENMP
+#pragma omp critical
+#endif
+            {
+                S0 += s0;
+                S1 += s1;
+                S2 += s2;
+                ll += local_ll;
+            }
+        }
+
+        // M step. Components without support keep their parameters.
+        for (int k = 0; k < K; ++k)
+        {
+            const double nk = S0.at<double>(k);
+            if (nk < 1e-3)
+                continue;
+            float *m = means_.ptr<float>(k);
+            float *v = variances_.ptr<float>(k);
+            const float *f = var_floor.ptr<float>();
+            for (int d = 0; d < dims; ++d)
+            {
+                const double mean = S1.at<double>(k, d) / nk;
+                m[d] = float(mean);
+                v[d] = std::max(float(S2.at<double>(k, d) / nk - mean * mean), f[d]);
+            }
+            weights_.at<float>(k) = float(std::max(nk / N, 1e-6));
+        }
+        weights_ /= cv::sum(weights_)[0];
+
+        if (it > 0 && ll - prev_ll < EM_TOLERANCE * std::abs(prev_ll))
+            break;
+        prev_ll = ll;
+    }
+    update_gmm_cache();
+}
+
+cv::Mat
+FisherFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    CV_Assert(!means_.empty());
+    const int K = means_.rows;
+    const int dims = means_.cols;
+    cv::Mat features = cv::Mat::zeros(1, 2 * K * dims, CV_32FC1);
+
+    cv::Mat descs;
+    fsiv_compute_dense_descriptors(img, int(params_[1]), int(params_[2]), descs);
+    if (descs.rows > 0)
+    {
+        const cv::Mat X = project(descs);
+        cv::Mat gamma, s0, A, B;
+        posteriors(X, gamma);
+        cv::reduce(gamma, s0, 0, cv::REDUCE_SUM);
+        cv::gemm(gamma, X, 1.0, cv::noArray(), 0.0, A, cv::GEMM_1_T);
+        cv::gemm(gamma, X.mul(X), 1.0, cv::noArray(), 0.0, B, cv::GEMM_1_T);
+
+        const float n = float(X.rows);
+        float *g_mean = features.ptr<float>();
+        float *g_var = g_mean + K * dims;
+        for (int k = 0; k < K; ++k)
+        {
+            const float w = weights_.at<float>(k);
+            const float nk = s0.at<float>(k);
+            const float norm_m = 1.0f / (n * std::sqrt(w));
+            const float norm_v = 1.0f / (n * std::sqrt(2.0f * w));
+            const float *m = means_.ptr<float>(k);
+            const float *iv = inv_var_.ptr<float>(k);
+            const float *a = A.ptr<float>(k);
+            const float *b = B.ptr<float>(k);
+            for (int d = 0; d < dims; ++d)
+            {
+                // sum_i g_ik (x_id - m) / sigma and
+                // sum_i g_ik ((x_id - m)^2 / var - 1).
+                const float diff = a[d] - nk * m[d];
+                g_mean[k * dims + d] = diff * std::sqrt(iv[d]) * norm_m;
+                g_var[k * dims + d] = ((b[d] - 2.0f * m[d] * a[d] + nk * m[d] * m[d]) * iv[d] - nk) * norm_v;
+            }
+        }
+
+        // Power (signed square root) and L2 normalization.
+        float *fv = features.ptr<float>();
+        for (int i = 0; i < features.cols; ++i)
+            fv[i] = std::copysign(std::sqrt(std::abs(fv[i])), fv[i]);
+        const double norm = cv::norm(features);
+        if (norm > 0.0)
+            features /= norm;
+    }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+bool FisherFeatures::save_model(std::string const &fname) const
+{
+    if (!FeaturesExtractor::save_model(fname))
+        return false;
+    cv::FileStorage f(fname, cv::FileStorage::APPEND | cv::FileStorage::BASE64);
+    if (!f.isOpened())
+        return false;
+    if (!pca_vectors_.empty())
+    {
+        f << "fsiv_fisher_pca_mean" << pca_mean_;
+        f << "fsiv_fisher_pca_vectors" << pca_vectors_;
+    }
+    f << "fsiv_fisher_weights" << weights_;
+    f << "fsiv_fisher_means" << means_;
+    f << "fsiv_fisher_variances" << variances_;
+    return true;
+}
+
+bool FisherFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    cv::FileStorage f(fname, cv::FileStorage::READ);
+    f["fsiv_fisher_pca_mean"] >> pca_mean_;
+    f["fsiv_fisher_pca_vectors"] >> pca_vectors_;
+    f["fsiv_fisher_weights"] >> weights_;
+    f["fsiv_fisher_means"] >> means_;
+    f["fsiv_fisher_variances"] >> variances_;
+    if (weights_.empty() || means_.empty() || variances_.empty())
+        throw std::runtime_error("Could not load the 'fsiv_fisher_*' GMM "
+                                 "labels from file.");
+    update_gmm_cache();
+    return true;
+}
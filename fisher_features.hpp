@@ -0,0 +1,59 @@
+/**
+ *  @file fisher_features.hpp
+ */
+#pragma once
+
+#include "features.hpp"
+
+/**
+ * @brief Fisher Vector extractor.
+ *
+ * Dense SIFT-like descriptors (see bovw_features.hpp), optionally reduced
+ * with PCA, are soft assigned to the components of a diagonal covariance
+ * GMM and encoded with the gradients of the log-likelihood with respect to
+ * the means and the variances. The encoding is power and L2 normalized.
+ * The PCA and the GMM (EM run in parallel) are learnt in train().
+ */
+class FisherFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    FisherFeatures();
+    ~FisherFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual void train(const Dataset &dt) override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual bool save_model(std::string const &fname) const override;
+    virtual bool load_model(std::string const &fname) override;
+
+protected:
+    /**
+     * @brief Reduce descriptors with the learnt PCA (if any).
+     */
+    cv::Mat project(const cv::Mat &descs) const;
+
+    /**
+     * @brief Compute the posteriors of the GMM components.
+     * @param X are the (projected) descriptors, one per row.
+     * @param[out] gamma are the posteriors, X.rows x K.
+     * @return the sum of the log-likelihoods of the samples.
+     */
+    double posteriors(const cv::Mat &X, cv::Mat &gamma) const;
+
+    /**
+     * @brief Precompute the GMM terms used by posteriors().
+     */
+    void update_gmm_cache();
+
+    cv::Mat pca_mean_;    // 1 x 128
+    cv::Mat pca_vectors_; // R x 128
+    cv::Mat weights_;     // 1 x K
+    cv::Mat means_;       // K x R
+    cv::Mat variances_;   // K x R
+    // Cache: 1/var, mean/var and the constant term of each log density.
+    cv::Mat inv_var_, mean_inv_var_, log_const_;
+};
@@ -0,0 +1,17 @@
+/**
+ *  @file fixed_size_features.cpp
+ */
+#include <atomic>
+#include "fixed_size_features.hpp"
+
+static std::atomic<bool> fixed_size_kernels_{true};
+
+void fsiv_set_fixed_size_kernels(bool enabled)
+{
+    fixed_size_kernels_ = enabled;
+}
+
+bool fsiv_fixed_size_kernels()
+{
+    return fixed_size_kernels_;
+}
@@ -0,0 +1,147 @@
+/**
+ *  @file fixed_size_features.hpp
+ *
+ *  Feature extraction kernels specialized at compile time for a fixed
+ *  input size. Extractors dispatch to them when the input matches and
+ *  fall back to their generic code otherwise.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include "lbp_features.hpp"
+
+/**
+ * @brief Enable or disable the fixed size kernels (enabled by default).
+ * Useful to measure their speedup against the generic code.
+ */
+void fsiv_set_fixed_size_kernels(bool enabled);
+
+/**
+ * @brief Are the fixed size kernels enabled?
+ */
+bool fsiv_fixed_size_kernels();
+
+/**
+ * @brief Kernels for WxH CV_8UC1 images.
+ *
+ * Loop bounds, strides and cell grids are compile time constants, so the
+ * compiler can fully unroll and vectorize the loops. The results are the
+ * same as the ones of the generic code of each extractor.
+ */
+template <int W, int H>
+class FixedSizeExtractor
+{
+public:
+    static constexpr int width = W;
+    static constexpr int height = H;
+    static constexpr int pixels = W * H;
+
+    /**
+     * @brief Can the kernels process this image?
+     */
+    static bool accepts(const cv::Mat &img)
+    {
+        return fsiv_fixed_size_kernels() && img.cols == W && img.rows == H &&
+               img.type() == CV_8UC1 && img.isContinuous();
+    }
+
+    /**
+     * @brief Gray levels normalized to [0, 1] as cv::normalize NORM_MINMAX.
+     * Only the range search is specialized; the scaling is the same
+     * conversion cv::normalize does, so the result is identical.
+     * @param features is the output, a 1x(W*H) row.
+     */
+    static void gray_levels(const cv::Mat &img, cv::Mat &features)
+    {
+        const uint8_t *src = img.ptr<uint8_t>();
+        uint8_t min_v = 255, max_v = 0;
+        for (int i = 0; i < pixels; ++i)
+        {
+            min_v = std::min(min_v, src[i]);
+            max_v = std::max(max_v, src[i]);
+        }
+        const double scale = max_v > min_v ? 1.0 / (max_v - min_v) : 0.0;
+        img.reshape(1, 1).convertTo(features, CV_32F, scale, 0.0 - min_v * scale);
+    }
+
+    /**
+     * @brief LBP histograms (see LBPFeatures) for a GxG grid.
+     * @param hist is the output (G*G*59 floats if U else G*G*256).
+     */
+    template <int G, bool U>
+    static void lbp(const cv::Mat &img, float *hist)
+    {
+        constexpr int IW = W - 2;
+        constexpr int IH = H - 2;
+        constexpr int bins = U ? 59 : 256;
+        static_assert(IW >= G && IH >= G, "Grid too large for the image.");
+        static constexpr auto uniform_map = fsiv_make_uniform_lbp_map();
+
+        int counts[G * G * bins] = {};
+        uint8_t code[IW];
+        const uint8_t *src = img.ptr<uint8_t>();
+        // Cell gy has the rows [gy*IH/G, (gy+1)*IH/G), as the columns.
+        int gy = 0;
+        for (int y = 0; y < IH; ++y)
+        {
+            const uint8_t *r0 = src + y * W;
+            const uint8_t *r1 = r0 + W;
+            const uint8_t *r2 = r1 + W;
+            for (int x = 0; x < IW; ++x)
+            {
+                const uint8_t c = r1[x + 1];
+                code[x] = uint8_t((r0[x] >= c) | ((r0[x + 1] >= c) << 1) |
+                                  ((r0[x + 2] >= c) << 2) | ((r1[x + 2] >= c) << 3) |
+                                  ((r2[x + 2] >= c) << 4) | ((r2[x + 1] >= c) << 5) |
+                                  ((r2[x] >= c) << 6) | ((r1[x] >= c) << 7));
+            }
+            while ((gy + 1) * IH / G <= y)
+                ++gy;
+            int *row_counts = counts + gy * G * bins;
+            for (int gx = 0; gx < G; ++gx)
+            {
+                int *h = row_counts + gx * bins;
+                for (int x = gx * IW / G; x < (gx + 1) * IW / G; ++x)
+                    ++h[U ? uniform_map[code[x]] : code[x]];
+            }
+        }
+        for (int gy = 0; gy < G; ++gy)
+            for (int gx = 0; gx < G; ++gx)
+            {
+                const float n = float(((gy + 1) * IH / G - gy * IH / G) *
+                                      ((gx + 1) * IW / G - gx * IW / G));
+                const int *c = counts + (gy * G + gx) * bins;
+                float *h = hist + (gy * G + gx) * bins;
+                for (int b = 0; b < bins; ++b)
+                    h[b] = float(c[b]) / n;
+            }
+    }
+
+    /**
+     * @brief Dispatch the LBP kernel for the runtime parameters.
+     * @return false if there is no specialization for them.
+     */
+    static bool lbp(const cv::Mat &img, bool uniform, int G, float *hist)
+    {
+        switch (G)
+        {
+        case 1:
+            uniform ? lbp<1, true>(img, hist) : lbp<1, false>(img, hist);
+            return true;
+        case 2:
+            uniform ? lbp<2, true>(img, hist) : lbp<2, false>(img, hist);
+            return true;
+        case 4:
+            uniform ? lbp<4, true>(img, hist) : lbp<4, false>(img, hist);
+            return true;
+        default:
+            return false;
+        }
+    }
+};
+
+/**
+ * @brief Specialization for the samples of the dataset.
+ */
+typedef FixedSizeExtractor<FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE> FixedSampleExtractor;
@@ -0,0 +1,150 @@
+/**
+ *  @file fourier_features.cpp
+ */
+#include <cmath>
+#include "fourier_features.hpp"
+
+static std::string name_{"Fourier Ring/Wedge Feature Extractor"};
+static std::string help_{
+    "  This extractor computes the power spectrum of the image and returns\n"
+    "  the fraction of the (non DC) energy in each of R concentric rings\n"
+    "  and W angular wedges (over 180 degrees), plus the log of the total\n"
+    "  energy (R+W+1 features). Ring energies are rotation invariant.\n"
+    "  Parameters: R:W\n"
+    "    R: num. of rings. Default 16.\n"
+    "    W: num. of wedges. Default 16.\n"};
+
+const std::string &
+FourierFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+FourierFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+FourierFeatures::FourierFeatures()
+{
+    type_ = FSIV_FOURIER;
+    params_ = {16.0f, 16.0f};
+    build_bins(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE), ring_, wedge_);
+}
+
+FourierFeatures::~FourierFeatures() {}
+
+void FourierFeatures::build_bins(const cv::Size &size, std::vector<short> &ring,
+                                 std::vector<short> &wedge) const
+{
+    const int R = int(params_[0]);
+    const int W = int(params_[1]);
+    CV_Assert(R > 0 && W > 0 && R < 32768 && W < 32768);
+    CV_Assert(size.width > 1 && size.height > 1);
+
+    ring.resize(size_t(size.area()));
+    wedge.resize(size_t(size.area()));
+    // Frequencies normalized so the Nyquist frequency of each axis is 1;
+    // the corners beyond radius 1 are not used by rings.
+    for (int v = 0; v < size.height; ++v)
+    {
+        const double fv = (v <= size.height / 2 ? v : v - size.height) / (size.height / 2.0);
+        for (int u = 0; u < size.width; ++u)
+        {
+            const double fu = (u <= size.width / 2 ? u : u - size.width) / (size.width / 2.0);
+            const size_t i = size_t(v) * size.width + u;
+            if (u == 0 && v == 0)
+            {
+                ring[i] = wedge[i] = -1;
+                continue;
+            }
+            const double r = std::sqrt(fu * fu + fv * fv);
+            ring[i] = short(r < 1.0 ? int(r * R) : -1);
+            // The spectrum of a real image is symmetric: wedges cover [0, pi).
+            double angle = std::atan2(fv, fu);
+            if (angle < 0.0)
+                angle += CV_PI;
+            wedge[i] = short(std::min(int(angle / CV_PI * W), W - 1));
+        }
+    }
+}
+
+cv::Mat
+FourierFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    const int R = int(params_[0]);
+    const int W = int(params_[1]);
+    const std::vector<short> *ring_map = &ring_;
+    const std::vector<short> *wedge_map = &wedge_;
+    if (img.size() != cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE))
+    {
+        thread_local std::vector<short> other_ring, other_wedge;
+        thread_local cv::Size other_size;
+        thread_local std::vector<float> other_params;
+        if (img.size() != other_size || params_ != other_params)
+        {
+            build_bins(img.size(), other_ring, other_wedge);
+            other_size = img.size();
+            other_params = params_;
+        }
+        ring_map = &other_ring;
+        wedge_map = &other_wedge;
+    }
+
+    // Per thread scratch, so several threads can share the extractor.
+    thread_local cv::Mat src, spectrum;
+    img.convertTo(src, CV_32F, img.depth() == CV_8U ? 1.0 / 255.0 : 1.0);
+    cv::dft(src, spectrum, cv::DFT_COMPLEX_OUTPUT);
+
+    cv::Mat features = cv::Mat::zeros(1, R + W + 1, CV_32FC1);
+    float *rings = features.ptr<float>();
+    float *wedges = rings + R;
+    const short *ring = ring_map->data();
+    const short *wedge = wedge_map->data();
+    double total = 0.0;
+    for (int v = 0; v < spectrum.rows; ++v)
+    {
+        const float *c = spectrum.ptr<float>(v);
+        const size_t row = size_t(v) * spectrum.cols;
+        for (int u = 0; u < spectrum.cols; ++u)
+        {
+            const size_t i = row + u;
+            if (wedge[i] < 0)
+                continue;
+            const float power = c[2 * u] * c[2 * u] + c[2 * u + 1] * c[2 * u + 1];
+            total += power;
+            wedges[wedge[i]] += power;
+            if (ring[i] >= 0)
+                rings[ring[i]] += power;
+        }
+    }
+    if (total > 0.0)
+    {
+        const float inv = float(1.0 / total);
+        for (int i = 0; i < R + W; ++i)
+            rings[i] *= inv;
+    }
+    features.at<float>(R + W) = float(std::log1p(total / img.total()));
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+bool FourierFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    build_bins(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE), ring_, wedge_);
+    return true;
+}
+
+void FourierFeatures::set_params(const std::vector<float> &params)
+{
+    FeaturesExtractor::set_params(params);
+    build_bins(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE), ring_, wedge_);
+}
@@ -0,0 +1,45 @@
+/**
+ *  @file fourier_features.hpp
+ */
+#pragma once
+
+#include <vector>
+#include "features.hpp"
+
+/**
+ * @brief Fourier ring/wedge spectral signature extractor.
+ *
+ * Integrates the power spectrum of the image over R concentric rings
+ * (rotation invariant) and W angular wedges. The ring and wedge of every
+ * frequency are precomputed for the sample size when the parameters are
+ * set or the model is loaded (other sizes use maps built per thread), so
+ * binning is a single scatter-add pass over the spectrum.
+ */
+class FourierFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    FourierFeatures();
+    ~FourierFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual bool load_model(std::string const &fname) override;
+    virtual void set_params(const std::vector<float> &params) override;
+
+protected:
+    /**
+     * @brief Build the bin index maps for an image size.
+     * @param size is the image size.
+     * @param ring is the output ring of each frequency.
+     * @param wedge is the output wedge of each frequency.
+     */
+    void build_bins(const cv::Size &size, std::vector<short> &ring,
+                    std::vector<short> &wedge) const;
+
+    std::vector<short> ring_;  // Ring of each frequency (-1 if none).
+    std::vector<short> wedge_; // Wedge of each frequency (-1 if none).
+};
@@ -0,0 +1,171 @@
+/**
+ *  @file gabor_features.cpp
+ */
+#include <cmath>
+#include "gabor_features.hpp"
+
+static std::string name_{"Gabor Filter Bank Feature Extractor"};
+static std::string help_{
+    "  This extractor filters the image with a bank of Gabor filters (S\n"
+    "  scales x O orientations) in the frequency domain and returns the mean\n"
+    "  and the standard deviation of the response magnitude of each filter\n"
+    "  (2*S*O features). The filter spectra are precomputed.\n"
+    "  Parameters: S:O:F\n"
+    "    S: num. of scales. Default 4.\n"
+    "    O: num. of orientations. Default 6.\n"
+    "    F: central frequency of the finest scale in cycles/pixel (scales\n"
+    "       are one octave apart). Default 0.25.\n"};
+
+const std::string &
+GaborFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+GaborFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+GaborFeatures::GaborFeatures()
+{
+    type_ = FSIV_GABOR;
+    params_ = {4.0f, 6.0f, 0.25f};
+    bank_size_ = cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE);
+    spectra_ = build_bank(bank_size_);
+}
+
+GaborFeatures::~GaborFeatures() {}
+
+std::vector<cv::Mat>
+GaborFeatures::build_bank(const cv::Size &size) const
+{
+    const int S = int(params_[0]);
+    const int O = int(params_[1]);
+    const float f_max = params_[2];
+    CV_Assert(S > 0 && O > 0 && f_max > 0.0f && f_max <= 0.5f);
+
+    std::vector<cv::Mat> spectra(size_t(S) * O);
+    for (int s = 0; s < S; ++s)
+    {
+        // One octave between scales; the radial bandwidth is proportional
+        // to the central frequency and the angular one covers pi/O.
+        const double f0 = f_max / std::pow(2.0, s);
+        const double sigma_u = 0.4 * f0;
+        const double sigma_v = f0 * std::tan(CV_PI / (2.0 * O));
+        for (int o = 0; o < O; ++o)
+        {
+            const double theta = CV_PI * o / O;
+            const double c = std::cos(theta);
+            const double sn = std::sin(theta);
+            cv::Mat G(size, CV_32FC1);
+            for (int y = 0; y < size.height; ++y)
+            {
+                // Frequencies in the DFT layout (DC at (0,0)).
+                const double v = double(y <= size.height / 2 ? y : y - size.height) / size.height;
+                float *g = G.ptr<float>(y);
+                for (int x = 0; x < size.width; ++x)
+                {
+                    const double u = double(x <= size.width / 2 ? x : x - size.width) / size.width;
+                    const double ur = u * c + v * sn;
+                    const double vr = -u * sn + v * c;
+                    // Single lobe, so the response is analytic and its
+                    // magnitude is the local energy.
+                    g[x] = float(std::exp(-0.5 * ((ur - f0) * (ur - f0) / (sigma_u * sigma_u) +
+                                                  vr * vr / (sigma_v * sigma_v))));
+                }
+            }
+            spectra[s * O + o] = G;
+        }
+    }
+    return spectra;
+}
+
+cv::Mat
+GaborFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    const std::vector<cv::Mat> *bank = &spectra_;
+    if (img.size() != bank_size_)
+    {
+        thread_local std::vector<cv::Mat> other_bank;
+        thread_local cv::Size other_size;
+        thread_local std::vector<float> other_params;
+        if (img.size() != other_size || params_ != other_params)
+        {
+            other_bank = build_bank(img.size());
+            other_size = img.size();
+            other_params = params_;
+        }
+        bank = &other_bank;
+    }
+
+    // Per thread scratch, so several threads can share the extractor.
+    thread_local cv::Mat spectrum, product, response;
+    cv::Mat f;
+    img.convertTo(f, CV_32F, 1.0 / 255.0);
+    f -= cv::mean(f);
+    cv::dft(f, spectrum, cv::DFT_COMPLEX_OUTPUT);
+
+    const int n_filters = int(bank->size());
+    cv::Mat features(1, 2 * n_filters, CV_32FC1);
+    float *out = features.ptr<float>();
+    const double n_pixels = double(f.total());
+    product.create(spectrum.size(), CV_32FC2);
+    for (int k = 0; k < n_filters; ++k)
+    {
+        const cv::Mat &G = (*bank)[k];
+        for (int y = 0; y < spectrum.rows; ++y)
+        {
+            const float *in = spectrum.ptr<float>(y);
+            const float *g = G.ptr<float>(y);
+            float *p = product.ptr<float>(y);
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int x = 0; x < spectrum.cols; ++x)
+            {
+                p[2 * x] = in[2 * x] * g[x];
+                p[2 * x + 1] = in[2 * x + 1] * g[x];
+            }
+        }
+        cv::idft(product, response, cv::DFT_SCALE);
+
+        // Pool the response magnitude straight into the output row.
+        double sum = 0.0, sum2 = 0.0;
+        for (int y = 0; y < response.rows; ++y)
+        {
+            const float *r = response.ptr<float>(y);
+            for (int x = 0; x < response.cols; ++x)
+            {
+                const double e = double(r[2 * x]) * r[2 * x] + double(r[2 * x + 1]) * r[2 * x + 1];
+                sum += std::sqrt(e);
+                sum2 += e;
+            }
+        }
+        const double mean = sum / n_pixels;
+        out[2 * k] = float(mean);
+        out[2 * k + 1] = float(std::sqrt(std::max(0.0, sum2 / n_pixels - mean * mean)));
+    }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+bool GaborFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    spectra_ = build_bank(bank_size_);
+    return true;
+}
+
+void GaborFeatures::set_params(const std::vector<float> &params)
+{
+    FeaturesExtractor::set_params(params);
+    spectra_ = build_bank(bank_size_);
+}
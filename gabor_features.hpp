@@ -0,0 +1,44 @@
+/**
+ *  @file gabor_features.hpp
+ */
+#pragma once
+
+#include <vector>
+#include "features.hpp"
+
+/**
+ * @brief Gabor filter bank texture extractor.
+ *
+ * The bank has S scales x O orientations. The filters are defined in the
+ * frequency domain and their spectra are computed for the sample size when
+ * the parameters are set or the model is loaded, so each image costs one
+ * forward DFT plus, per filter, an elementwise product and an inverse DFT.
+ * Images of other sizes use a bank built per thread. The mean and the standard deviation of the
+ * response magnitude of each filter are returned.
+ */
+class GaborFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    GaborFeatures();
+    ~GaborFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual bool load_model(std::string const &fname) override;
+    virtual void set_params(const std::vector<float> &params) override;
+
+protected:
+    /**
+     * @brief Compute the filter spectra for an image size.
+     * @param size is the image size.
+     * @return the spectra, one CV_32FC1 matrix per filter.
+     */
+    std::vector<cv::Mat> build_bank(const cv::Size &size) const;
+
+    cv::Size bank_size_;
+    std::vector<cv::Mat> spectra_;
+};
@@ -0,0 +1,190 @@
+/**
+ *  @file glcm_features.cpp
+ */
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "glcm_features.hpp"
+
+static std::string name_{"GLCM Haralick Texture Feature Extractor"};
+static std::string help_{
+    "  This extractor quantizes the image to Q gray levels and computes the\n"
+    "  gray level co-occurrence matrices for distances 1..D and angles\n"
+    "  0, 45, 90 and 135 degrees in a single pass. For each matrix it returns\n"
+    "  the Haralick contrast, energy, homogeneity, entropy and correlation.\n"
+    "  Parameters: Q:D:R\n"
+    "    Q: num. of gray levels (2..256). Default 16.\n"
+    "    D: max. distance. Default 2.\n"
+    "    R: 1 means average the statistics over the four angles to get\n"
+    "       rotation invariant features (5*D features), 0 means keep\n"
+    "       them (20*D features). Default 0.\n"};
+
+static const int N_ANGLES = 4;
+static const int N_STATS = 5;
+// (dy, dx) unit steps for 0, 45, 90 and 135 degrees.
+static const int ANGLE_STEPS[N_ANGLES][2] = {{0, 1}, {-1, 1}, {-1, 0}, {-1, -1}};
+
+const std::string &
+GLCMFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+GLCMFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+GLCMFeatures::GLCMFeatures()
+{
+    type_ = FSIV_GLCM;
+    params_ = {16.0f, 2.0f, 0.0f};
+}
+
+GLCMFeatures::~GLCMFeatures() {}
+
+/**
+ * @brief Per thread tables and buffers reused between images.
+ */
+struct GLCMBuffers
+{
+    int levels = 0;
+    // Per cell (i,j) of a QxQ matrix: i, j, (i-j)^2 and 1/(1+(i-j)^2).
+    std::vector<float> w_i, w_j, w_contrast, w_homogeneity;
+    std::vector<uint32_t> counts;
+    std::vector<float> probs;
+};
+
+/**
+ * @brief Rebuild the per-cell weight tables if Q changed.
+ * @param b are the buffers to update.
+ * @param levels is the number of gray levels.
+ */
+static void update_tables(GLCMBuffers &b, int levels)
+{
+    if (levels == b.levels)
+        return;
+    b.levels = levels;
+    const size_t n = size_t(levels) * levels;
+    b.w_i.resize(n);
+    b.w_j.resize(n);
+    b.w_contrast.resize(n);
+    b.w_homogeneity.resize(n);
+    b.probs.resize(n);
+    for (int i = 0; i < levels; ++i)
+        for (int j = 0; j < levels; ++j)
+        {
+            const size_t c = size_t(i) * levels + j;
+            const float d2 = float((i - j) * (i - j));
+            b.w_i[c] = float(i);
+            b.w_j[c] = float(j);
+            b.w_contrast[c] = d2;
+            b.w_homogeneity[c] = 1.0f / (1.0f + d2);
+        }
+}
+
+cv::Mat
+GLCMFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    const int Q = int(params_[0]);
+    const int D = int(params_[1]);
+    const bool rotation_invariant = params_[2] != 0.0f;
+    CV_Assert(Q >= 2 && Q <= 256 && D >= 1);
+    thread_local GLCMBuffers b;
+    update_tables(b, Q);
+
+    // Quantize to Q levels after stretching to the full range, so the
+    // matrices do not depend on the illumination of the slide.
+    cv::Mat q;
+    cv::normalize(img, q, 0.0, Q - 1, cv::NORM_MINMAX, CV_8U);
+
+    const int n_offsets = D * N_ANGLES;
+    std::vector<int> dy(n_offsets), dx(n_offsets);
+    for (int d = 0; d < D; ++d)
+        for (int a = 0; a < N_ANGLES; ++a)
+        {
+            dy[d * N_ANGLES + a] = (d + 1) * ANGLE_STEPS[a][0];
+            dx[d * N_ANGLES + a] = (d + 1) * ANGLE_STEPS[a][1];
+        }
+
+    // Single pass: every pixel updates the histograms of all the offsets.
+    const size_t cells = size_t(Q) * Q;
+    b.counts.assign(cells * n_offsets, 0);
+    std::vector<uint32_t> totals(n_offsets, 0);
+    for (int y = 0; y < q.rows; ++y)
+    {
+        const uchar *row = q.ptr<uchar>(y);
+        for (int x = 0; x < q.cols; ++x)
+        {
+            const size_t base = size_t(row[x]) * Q;
+            for (int o = 0; o < n_offsets; ++o)
+            {
+                const int ny = y + dy[o];
+                const int nx = x + dx[o];
+                if (unsigned(ny) < unsigned(q.rows) && unsigned(nx) < unsigned(q.cols))
+                {
+                    ++b.counts[o * cells + base + q.ptr<uchar>(ny)[nx]];
+                    ++totals[o];
+                }
+            }
+        }
+    }
+
+    const int n_features = rotation_invariant ? D * N_STATS : n_offsets * N_STATS;
+    cv::Mat features = cv::Mat::zeros(1, n_features, CV_32FC1);
+    float *out = features.ptr<float>();
+    float *p = b.probs.data();
+    const float *w_i = b.w_i.data();
+    const float *w_j = b.w_j.data();
+    const float *w_contrast = b.w_contrast.data();
+    const float *w_homogeneity = b.w_homogeneity.data();
+    for (int o = 0; o < n_offsets; ++o)
+    {
+        const uint32_t *h = &b.counts[o * cells];
+        if (totals[o] == 0)
+            continue;
+
+        // Symmetric normalized matrix p = (H + H^T) / (2N).
+        const float inv = 0.5f / float(totals[o]);
+        for (int i = 0; i < Q; ++i)
+            for (int j = 0; j < Q; ++j)
+                p[i * Q + j] = float(h[i * Q + j] + h[j * Q + i]) * inv;
+
+        // Statistics as dot products with the precomputed tables.
+        float contrast = 0.0f, energy = 0.0f, homogeneity = 0.0f;
+        float mean = 0.0f, sum_ij = 0.0f, sum_ii = 0.0f;
+#ifdef USE_OPENMP
+#pragma omp simd reduction(+ : contrast, energy, homogeneity, mean, sum_ij, sum_ii)
+#endif
+        for (size_t c = 0; c < cells; ++c)
+        {
+            contrast += p[c] * w_contrast[c];
+            energy += p[c] * p[c];
+            homogeneity += p[c] * w_homogeneity[c];
+            mean += p[c] * w_i[c];
+            sum_ij += p[c] * w_i[c] * w_j[c];
+            sum_ii += p[c] * w_i[c] * w_i[c];
+        }
+        float entropy = 0.0f;
+        for (size_t c = 0; c < cells; ++c)
+            if (p[c] > 0.0f)
+                entropy -= p[c] * std::log(p[c]);
+        // p is symmetric so both marginals have the same mean and variance.
+        const float var = sum_ii - mean * mean;
+        const float correlation = var > 1e-6f ? (sum_ij - mean * mean) / var : 1.0f;
+
+        const float stats[N_STATS] = {contrast, energy, homogeneity, entropy, correlation};
+        float *dst = rotation_invariant ? out + (o / N_ANGLES) * N_STATS : out + o * N_STATS;
+        const float w = rotation_invariant ? 1.0f / N_ANGLES : 1.0f;
+        for (int s = 0; s < N_STATS; ++s)
+            dst[s] += w * stats[s];
+    }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
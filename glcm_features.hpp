@@ -0,0 +1,34 @@
+/**
+ *  @file glcm_features.hpp
+ */
+#pragma once
+
+#include "features.hpp"
+
+/**
+ * @brief Gray Level Co-occurrence Matrix (Haralick) texture extractor.
+ *
+ * The image is quantized to Q gray levels and the co-occurrence matrices
+ * for distances 1..D and angles 0, 45, 90 and 135 degrees are accumulated
+ * in a single pass over the image. For each matrix the Haralick contrast,
+ * energy, homogeneity, entropy and correlation are computed.
+ */
+class GLCMFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    GLCMFeatures();
+    ~GLCMFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+
+    // This extractor does not need override these methods:
+    // virtual void train(const cv::Mat& samples) override;
+    // virtual bool save_model(std::string const& fname) const;
+    // virtual bool load_model(std::string const& fname);
+
+};
@@ -3,6 +3,7 @@
  *  (C) 2022- FJMC fjmadrid@uco.es
  */
 #include <opencv2/imgproc.hpp>
+#include "fixed_size_features.hpp"
 #include "gray_levels_features.hpp"
 
 static std::string name_{"Gray Levels Feature Extractor"};
@@ -42,11 +43,16 @@ GrayLevelsFeatures::extract_features(const cv::Mat &img)
     // Remember: the output type must be CV_32F.
     // Hint: use cv::Mat::reshape() method to pass from WxH to 1xW*H row vector.
 
-    // normalize image to range 0-1, convert to float
-    cv::normalize(img, features, 0.0, 1.0, cv::NORM_MINMAX, CV_32F);
-    
-    // reshape to row vector (1 row, all pixels in one row)
-    features = features.reshape(1, 1);
+    if (FixedSampleExtractor::accepts(img))
+        FixedSampleExtractor::gray_levels(img, features);
+    else
+    {
+        // normalize image to range 0-1, convert to float
+        cv::normalize(img, features, 0.0, 1.0, cv::NORM_MINMAX, CV_32F);
+
+        // reshape to row vector (1 row, all pixels in one row)
+        features = features.reshape(1, 1);
+    }
 
     //
     CV_Assert(features.rows == 1);
@@ -0,0 +1,261 @@
+/**
+ *  @file hamming_classifier.cpp
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "distances.hpp"
+#include "knn_classifier.hpp"
+#include "hamming_classifier.hpp"
+
+// PCA and ITQ are learnt on at most this many training samples.
+static const int MAX_TRAIN_SAMPLES = 20000;
+
+HammingKNNClassifier::HammingKNNClassifier()
+    : K_(1), bits_(256), itq_iterations_(50)
+{
+}
+
+HammingKNNClassifier::~HammingKNNClassifier() {}
+
+cv::Ptr<HammingKNNClassifier>
+HammingKNNClassifier::create()
+{
+    return cv::makePtr<HammingKNNClassifier>();
+}
+
+int HammingKNNClassifier::get_K() const
+{
+    return K_;
+}
+
+void HammingKNNClassifier::set_K(int K)
+{
+    CV_Assert(K > 0);
+    K_ = K;
+}
+
+int HammingKNNClassifier::get_bits() const
+{
+    return bits_;
+}
+
+void HammingKNNClassifier::set_bits(int bits)
+{
+    CV_Assert(bits > 0);
+    if (bits != bits_)
+        clear();
+    bits_ = bits;
+}
+
+int HammingKNNClassifier::get_itq_iterations() const
+{
+    return itq_iterations_;
+}
+
+void HammingKNNClassifier::set_itq_iterations(int iterations)
+{
+    CV_Assert(iterations >= 0);
+    itq_iterations_ = iterations;
+}
+
+void HammingKNNClassifier::encode(const cv::Mat &X, cv::Mat &codes) const
+{
+    CV_Assert(!projection_.empty());
+    CV_Assert(X.cols == projection_.rows && X.channels() == 1);
+    cv::Mat Xf = X;
+    if (X.type() != CV_32FC1)
+        X.convertTo(Xf, CV_32F);
+
+    cv::Mat V;
+    cv::gemm(Xf, projection_, 1.0, cv::noArray(), 0.0, V);
+    const int B = V.cols;
+    const int words = (B + 63) / 64;
+    codes = cv::Mat::zeros(X.rows, words * 8, CV_8UC1);
+    const float *off = offset_.ptr<float>();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < V.rows; ++i)
+    {
+        const float *v = V.ptr<float>(i);
+        uchar *c = codes.ptr(i);
+        for (int w = 0; w < words; ++w)
+        {
+            uint64_t word = 0;
+            for (int b = w * 64; b < std::min(B, (w + 1) * 64); ++b)
+                if (v[b] > off[b])
+                    word |= uint64_t(1) << (b & 63);
+            std::memcpy(c + w * sizeof(uint64_t), &word, sizeof(word));
+        }
+    }
+}
+
+void HammingKNNClassifier::find_nearest(const cv::Mat &X, int K,
+                                        cv::Mat &idx, cv::Mat &dists) const
+{
+    CV_Assert(isTrained());
+    cv::Mat codes;
+    encode(X, codes);
+    fsiv_hamming_knn_search(codes, codes_, K, idx, dists);
+}
+
+int HammingKNNClassifier::getVarCount() const
+{
+    return projection_.rows;
+}
+
+bool HammingKNNClassifier::isTrained() const
+{
+    return !codes_.empty();
+}
+
+bool HammingKNNClassifier::isClassifier() const
+{
+    return true;
+}
+
+bool HammingKNNClassifier::train(const cv::Ptr<cv::ml::TrainData> &data,
+                                 int)
+{
+    CV_Assert(data != nullptr);
+    return train(data->getTrainSamples(cv::ml::ROW_SAMPLE),
+                 cv::ml::ROW_SAMPLE, data->getTrainResponses());
+}
+
+bool HammingKNNClassifier::train(cv::InputArray samples, int layout,
+                                 cv::InputArray responses)
+{
+    CV_Assert(layout == cv::ml::ROW_SAMPLE);
+    const cv::Mat X = samples.getMat();
+    const cv::Mat y = responses.getMat();
+    CV_Assert(X.rows > 1 && X.cols > 0 && X.channels() == 1);
+    CV_Assert(y.total() == size_t(X.rows) && y.channels() == 1);
+
+    clear();
+    cv::Mat Xf;
+    X.convertTo(Xf, CV_32F);
+    cv::RNG &rng = cv::theRNG();
+
+    // Learn the embedding on a random subset of the samples.
+    cv::Mat S = Xf;
+    if (Xf.rows > MAX_TRAIN_SAMPLES)
+    {
+        std::vector<int> rows(Xf.rows);
+        for (int i = 0; i < Xf.rows; ++i)
+            rows[i] = i;
+        for (int i = 0; i < MAX_TRAIN_SAMPLES; ++i)
+            std::swap(rows[i], rows[i + rng.uniform(0, Xf.rows - i)]);
+        S.create(MAX_TRAIN_SAMPLES, Xf.cols, CV_32FC1);
+        for (int i = 0; i < MAX_TRAIN_SAMPLES; ++i)
+            Xf.row(rows[i]).copyTo(S.row(i));
+    }
+    cv::PCA pca(S, cv::noArray(), cv::PCA::DATA_AS_ROW,
+                std::min(bits_, std::min(S.cols, S.rows)));
+    const cv::Mat V = pca.project(S);
+    const int B = V.cols;
+
+    // ITQ: alternate B = sign(VR) and the orthogonal Procrustes solution
+    // R = argmin ||B - VR||, starting from a random rotation.
+    cv::Mat G(B, B, CV_32FC1), w, u, vt;
+    for (int i = 0; i < B; ++i)
+        for (int j = 0; j < B; ++j)
+            G.at<float>(i, j) = float(rng.gaussian(1.0));
+    cv::SVD::compute(G, w, u, vt);
+    cv::Mat R = u;
+    cv::Mat VR, C;
+    cv::Mat signs(V.rows, B, CV_32FC1);
+    for (int it = 0; it < itq_iterations_; ++it)
+    {
+        cv::gemm(V, R, 1.0, cv::noArray(), 0.0, VR);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < VR.rows; ++i)
+        {
+            const float *vr = VR.ptr<float>(i);
+            float *s = signs.ptr<float>(i);
+            for (int j = 0; j < B; ++j)
+                s[j] = vr[j] >= 0.0f ? 1.0f : -1.0f;
+        }
+        // signs^T V = u w vt  ->  R = vt^T u^T
+        cv::gemm(signs, V, 1.0, cv::noArray(), 0.0, C, cv::GEMM_1_T);
+        cv::SVD::compute(C, w, u, vt);
+        cv::gemm(vt, u, 1.0, cv::noArray(), 0.0, R,
+                 cv::GEMM_1_T | cv::GEMM_2_T);
+    }
+
+    // Fold the centering, the PCA basis and the rotation into one
+    // projection and a threshold per bit.
+    cv::Mat basis;
+    pca.eigenvectors.convertTo(basis, CV_32F);
+    cv::gemm(basis, R, 1.0, cv::noArray(), 0.0, projection_, cv::GEMM_1_T);
+    cv::Mat mean;
+    pca.mean.convertTo(mean, CV_32F);
+    cv::gemm(mean, projection_, 1.0, cv::noArray(), 0.0, offset_);
+
+    encode(Xf, codes_);
+    y.reshape(1, X.rows).convertTo(labels_, CV_32S);
+    return true;
+}
+
+float HammingKNNClassifier::predict(cv::InputArray samples,
+                                    cv::OutputArray results, int) const
+{
+    CV_Assert(isTrained());
+    const cv::Mat X = samples.getMat();
+    cv::Mat idx, dists;
+    find_nearest(X, K_, idx, dists);
+
+    cv::Mat predictions(X.rows, 1, CV_32FC1);
+    for (int i = 0; i < X.rows; ++i)
+        predictions.at<float>(i) =
+            float(fsiv_knn_vote(labels_.ptr<int>(), idx.ptr<int>(i), idx.cols));
+    if (results.needed())
+        predictions.copyTo(results);
+    return X.rows > 0 ? predictions.at<float>(0) : 0.0f;
+}
+
+void HammingKNNClassifier::clear()
+{
+    projection_.release();
+    offset_.release();
+    codes_.release();
+    labels_.release();
+}
+
+void HammingKNNClassifier::write(cv::FileStorage &fs) const
+{
+    writeFormat(fs);
+    fs << "K" << K_;
+    fs << "bits" << bits_;
+    fs << "itq_iterations" << itq_iterations_;
+    fs << "projection" << projection_;
+    fs << "offset" << offset_;
+    fs << "codes" << codes_;
+    fs << "labels" << labels_;
+}
+
+void HammingKNNClassifier::read(const cv::FileNode &fn)
+{
+    clear();
+    fn["K"] >> K_;
+    fn["bits"] >> bits_;
+    fn["itq_iterations"] >> itq_iterations_;
+    fn["projection"] >> projection_;
+    fn["offset"] >> offset_;
+    fn["codes"] >> codes_;
+    fn["labels"] >> labels_;
+    CV_Assert(K_ > 0 && bits_ > 0);
+    CV_Assert(projection_.type() == CV_32FC1 && offset_.type() == CV_32FC1);
+    CV_Assert(offset_.cols == projection_.cols);
+    CV_Assert(codes_.type() == CV_8UC1 &&
+              codes_.cols == (projection_.cols + 63) / 64 * 8);
+    CV_Assert(labels_.rows == codes_.rows);
+}
+
+cv::String HammingKNNClassifier::getDefaultName() const
+{
+    return "fsiv_ml_hamming_knn";
+}
@@ -0,0 +1,104 @@
+/**
+ *  @file hamming_classifier.hpp
+ */
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+
+/**
+ * @brief K-NN classifier on learnt binary codes.
+ *
+ * The features are projected on their first B principal components,
+ * rotated with Iterative Quantization (Gong & Lazebnik, 2011) to minimize
+ * the binarization error, and binarized by sign. Each reference is stored
+ * as a packed B bit code and the neighbours are found by Hamming distance
+ * with fsiv_hamming_knn_search().
+ */
+class HammingKNNClassifier : public cv::ml::StatModel
+{
+public:
+    HammingKNNClassifier();
+    virtual ~HammingKNNClassifier();
+
+    /**
+     * @brief Create a classifier with K=1, 256 bits and 50 ITQ iterations.
+     */
+    static cv::Ptr<HammingKNNClassifier> create();
+
+    /**
+     * @brief Get the number of neighbours used to predict.
+     */
+    int get_K() const;
+
+    /**
+     * @brief Set the number of neighbours used to predict.
+     * @pre K>0
+     */
+    void set_K(int K);
+
+    /**
+     * @brief Get the number of bits per code.
+     */
+    int get_bits() const;
+
+    /**
+     * @brief Set the number of bits per code (clipped to the feature
+     * dimension while training). Changing it clears the model.
+     * @pre bits>0
+     */
+    void set_bits(int bits);
+
+    /**
+     * @brief Get the number of ITQ iterations.
+     */
+    int get_itq_iterations() const;
+
+    /**
+     * @brief Set the number of ITQ iterations (0 means sign of PCA).
+     * @pre iterations>=0
+     */
+    void set_itq_iterations(int iterations);
+
+    /**
+     * @brief Binarize samples.
+     * @param X are the samples (one per row).
+     * @param[out] codes are the packed codes (CV_8UC1, a multiple of 8
+     * bytes per row).
+     */
+    void encode(const cv::Mat &X, cv::Mat &codes) const;
+
+    /**
+     * @brief Find the K nearest references of each sample.
+     * @param X are the samples (one per row).
+     * @param K is the number of neighbours.
+     * @param[out] idx are the indices of the neighbours sorted by distance.
+     * @param[out] dists are their Hamming distances (CV_32SC1).
+     */
+    void find_nearest(const cv::Mat &X, int K, cv::Mat &idx,
+                      cv::Mat &dists) const;
+
+    virtual int getVarCount() const override;
+    virtual bool isTrained() const override;
+    virtual bool isClassifier() const override;
+    virtual bool train(const cv::Ptr<cv::ml::TrainData> &data,
+                       int flags = 0) override;
+    virtual bool train(cv::InputArray samples, int layout,
+                       cv::InputArray responses) override;
+    virtual float predict(cv::InputArray samples,
+                          cv::OutputArray results = cv::noArray(),
+                          int flags = 0) const override;
+    virtual void clear() override;
+    virtual void write(cv::FileStorage &fs) const override;
+    virtual void read(const cv::FileNode &fn) override;
+    virtual cv::String getDefaultName() const override;
+
+protected:
+    int K_;
+    int bits_;
+    int itq_iterations_;
+    cv::Mat projection_; // D x B, PCA basis times the ITQ rotation.
+    cv::Mat offset_;     // 1 x B, the projected mean (binarization threshold).
+    cv::Mat codes_;      // N x (8*words) CV_8UC1.
+    cv::Mat labels_;     // N x 1 CV_32SC1.
+};
@@ -0,0 +1,506 @@
+/**
+ *  @file hnsw_classifier.cpp
+ */
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include "hnsw_classifier.hpp"
+#include "knn_classifier.hpp"
+
+// Levels are drawn as floor(-ln(U) / ln(M)); this caps pathological draws.
+static const int MAX_LEVEL = 16;
+
+HNSWClassifier::VisitedList::VisitedList(size_t n) : marks(n, 0), epoch(0) {}
+
+void HNSWClassifier::VisitedList::reset()
+{
+    if (++epoch == 0)
+    {
+        std::fill(marks.begin(), marks.end(), 0);
+        epoch = 1;
+    }
+}
+
+HNSWClassifier::HNSWClassifier()
+    : K_(1), M_(16), ef_construction_(200), ef_search_(64),
+      entry_point_(-1), max_level_(-1)
+{
+}
+
+HNSWClassifier::~HNSWClassifier() {}
+
+cv::Ptr<HNSWClassifier>
+HNSWClassifier::create()
+{
+    return cv::makePtr<HNSWClassifier>();
+}
+
+int HNSWClassifier::get_K() const
+{
+    return K_;
+}
+
+void HNSWClassifier::set_K(int K)
+{
+    CV_Assert(K > 0);
+    K_ = K;
+}
+
+int HNSWClassifier::get_M() const
+{
+    return M_;
+}
+
+void HNSWClassifier::set_M(int M)
+{
+    CV_Assert(M > 1);
+    if (M != M_)
+        clear();
+    M_ = M;
+}
+
+int HNSWClassifier::get_ef_construction() const
+{
+    return ef_construction_;
+}
+
+void HNSWClassifier::set_ef_construction(int ef)
+{
+    CV_Assert(ef > 0);
+    ef_construction_ = ef;
+}
+
+int HNSWClassifier::get_ef_search() const
+{
+    return ef_search_;
+}
+
+void HNSWClassifier::set_ef_search(int ef)
+{
+    CV_Assert(ef > 0);
+    ef_search_ = ef;
+}
+
+const cv::Mat &
+HNSWClassifier::get_labels() const
+{
+    return labels_;
+}
+
+float HNSWClassifier::distance(const float *a, int node) const
+{
+    const float *b = samples_.ptr<float>(node);
+    float acc = 0.0f;
+#ifdef USE_OPENMP
+#pragma omp simd reduction(+ : acc)
+#endif
+    for (int k = 0; k < samples_.cols; ++k)
+    {
+        const float d = a[k] - b[k];
+        acc += d * d;
+    }
+    return acc;
+}
+
+void HNSWClassifier::allocate_links()
+{
+    const int N = samples_.rows;
+    offsets_.resize(N);
+    size_t upper_size = 0;
+    for (int i = 0; i < N; ++i)
+    {
+        offsets_[i] = upper_size;
+        upper_size += size_t(levels_[i]) * (1 + M_);
+    }
+    upper_.assign(upper_size, 0);
+    links0_.assign(size_t(N) * (1 + 2 * M_), 0);
+}
+
+const int *HNSWClassifier::links(int node, int level) const
+{
+    if (level == 0)
+        return links0_.data() + size_t(node) * (1 + 2 * M_);
+    return upper_.data() + offsets_[node] + size_t(level - 1) * (1 + M_);
+}
+
+int *HNSWClassifier::links(int node, int level)
+{
+    if (level == 0)
+        return links0_.data() + size_t(node) * (1 + 2 * M_);
+    return upper_.data() + offsets_[node] + size_t(level - 1) * (1 + M_);
+}
+
+/**
+ * @brief Copy the links of a node, under its lock if given.
+ */
+static void
+copy_links(const int *l, std::mutex *lock, std::vector<int> &dst)
+{
+    if (lock)
+    {
+        std::lock_guard<std::mutex> guard(*lock);
+        dst.assign(l + 1, l + 1 + l[0]);
+    }
+    else
+        dst.assign(l + 1, l + 1 + l[0]);
+}
+
+HNSWClassifier::Candidate
+HNSWClassifier::greedy_search(const float *q, Candidate entry, int level,
+                              std::vector<std::mutex> *locks) const
+{
+    std::vector<int> neighbours;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        copy_links(links(entry.second, level),
+                   locks ? &(*locks)[entry.second] : nullptr, neighbours);
+        for (int n : neighbours)
+        {
+            const float d = distance(q, n);
+            if (d < entry.first)
+            {
+                entry = Candidate(d, n);
+                changed = true;
+            }
+        }
+    }
+    return entry;
+}
+
+void HNSWClassifier::search_layer(const float *q, Candidate entry, int ef,
+                                  int level, VisitedList &visited,
+                                  std::vector<Candidate> &result,
+                                  std::vector<std::mutex> *locks) const
+{
+    // Nodes to expand (nearest on top) and the ef best found (worst on top).
+    std::priority_queue<Candidate, std::vector<Candidate>,
+                        std::greater<Candidate>>
+        frontier;
+    std::priority_queue<Candidate> best;
+    std::vector<int> neighbours;
+
+    visited.reset();
+    visited.marks[entry.second] = visited.epoch;
+    frontier.push(entry);
+    best.push(entry);
+    while (!frontier.empty())
+    {
+        const Candidate c = frontier.top();
+        if (c.first > best.top().first && int(best.size()) >= ef)
+            break;
+        frontier.pop();
+        copy_links(links(c.second, level),
+                   locks ? &(*locks)[c.second] : nullptr, neighbours);
+        for (int n : neighbours)
+        {
+            if (visited.marks[n] == visited.epoch)
+                continue;
+            visited.marks[n] = visited.epoch;
+            const float d = distance(q, n);
+            if (int(best.size()) < ef || d < best.top().first)
+            {
+                frontier.push(Candidate(d, n));
+                best.push(Candidate(d, n));
+                if (int(best.size()) > ef)
+                    best.pop();
+            }
+        }
+    }
+
+    result.resize(best.size());
+    for (size_t i = result.size(); i > 0; --i)
+    {
+        result[i - 1] = best.top();
+        best.pop();
+    }
+}
+
+void HNSWClassifier::select_neighbours(std::vector<Candidate> &candidates,
+                                       int M) const
+{
+    if (int(candidates.size()) <= M)
+        return;
+    std::vector<Candidate> selected;
+    selected.reserve(M);
+    for (size_t i = 0; i < candidates.size() && int(selected.size()) < M; ++i)
+    {
+        const Candidate &c = candidates[i];
+        const float *x = samples_.ptr<float>(c.second);
+        bool diverse = true;
+        for (size_t j = 0; j < selected.size() && diverse; ++j)
+            diverse = distance(x, selected[j].second) >= c.first;
+        if (diverse)
+            selected.push_back(c);
+    }
+    candidates.swap(selected);
+}
+
+void HNSWClassifier::insert(int node, VisitedList &visited,
+                            std::vector<std::mutex> &locks,
+                            std::mutex &entry_lock)
+{
+    const float *q = samples_.ptr<float>(node);
+    const int level = levels_[node];
+    std::unique_lock<std::mutex> top_lock(entry_lock);
+    const int entry = entry_point_;
+    const int top = max_level_;
+    // Only the insertions raising the top level keep the lock.
+    if (level <= top)
+        top_lock.unlock();
+
+    Candidate ep(distance(q, entry), entry);
+    for (int l = top; l > level; --l)
+        ep = greedy_search(q, ep, l, &locks);
+
+    std::vector<Candidate> found, cand;
+    for (int l = std::min(level, top); l >= 0; --l)
+    {
+        search_layer(q, ep, ef_construction_, l, visited, found, &locks);
+        // A concurrent insertion may have linked the node already: it must
+        // not link to itself.
+        found.erase(std::remove_if(found.begin(), found.end(),
+                                   [node](const Candidate &c)
+                                   { return c.second == node; }),
+                    found.end());
+        if (!found.empty())
+            ep = found[0];
+        select_neighbours(found, M_);
+        {
+            std::lock_guard<std::mutex> guard(locks[node]);
+            int *ln = links(node, l);
+            ln[0] = int(found.size());
+            for (size_t i = 0; i < found.size(); ++i)
+                ln[1 + i] = found[i].second;
+        }
+
+        // Add the reverse links, shrinking the full lists.
+        const int max_links = l == 0 ? 2 * M_ : M_;
+        for (const Candidate &f : found)
+        {
+            std::lock_guard<std::mutex> guard(locks[f.second]);
+            int *ln = links(f.second, l);
+            if (ln[0] < max_links)
+            {
+                ln[1 + ln[0]++] = node;
+                continue;
+            }
+            const float *x = samples_.ptr<float>(f.second);
+            cand.assign(1, Candidate(f.first, node));
+            for (int i = 1; i <= ln[0]; ++i)
+                cand.push_back(Candidate(distance(x, ln[i]), ln[i]));
+            std::sort(cand.begin(), cand.end());
+            select_neighbours(cand, max_links);
+            ln[0] = int(cand.size());
+            for (size_t i = 0; i < cand.size(); ++i)
+                ln[1 + i] = cand[i].second;
+        }
+    }
+
+    if (level > top)
+    {
+        entry_point_ = node;
+        max_level_ = level;
+    }
+}
+
+void HNSWClassifier::find_nearest(const cv::Mat &X, int K, cv::Mat &idx,
+                                  cv::Mat &dists) const
+{
+    CV_Assert(isTrained());
+    CV_Assert(X.cols == samples_.cols && K > 0);
+    cv::Mat Xf = X;
+    if (X.type() != CV_32FC1)
+        X.convertTo(Xf, CV_32F);
+
+    K = std::min(K, samples_.rows);
+    idx.create(X.rows, K, CV_32SC1);
+    dists.create(X.rows, K, CV_32FC1);
+    const int ef = std::max(ef_search_, K);
+
+#ifdef USE_OPENMP
+#pragma omp parallel if (X.rows > 1)
+#endif
+    {
+        VisitedList visited(samples_.rows);
+        std::vector<Candidate> found;
+#ifdef USE_OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+        for (int i = 0; i < X.rows; ++i)
+        {
+            const float *q = Xf.ptr<float>(i);
+            Candidate ep(distance(q, entry_point_), entry_point_);
+            for (int l = max_level_; l > 0; --l)
+                ep = greedy_search(q, ep, l, nullptr);
+            search_layer(q, ep, ef, 0, visited, found, nullptr);
+
+            int *ix = idx.ptr<int>(i);
+            float *dx = dists.ptr<float>(i);
+            const int n = std::min(K, int(found.size()));
+            for (int k = 0; k < n; ++k)
+            {
+                ix[k] = found[k].second;
+                dx[k] = found[k].first;
+            }
+            // A disconnected graph may give less than K neighbours.
+            for (int k = n; k < K; ++k)
+            {
+                ix[k] = -1;
+                dx[k] = FLT_MAX;
+            }
+        }
+    }
+}
+
+int HNSWClassifier::getVarCount() const
+{
+    return samples_.cols;
+}
+
+bool HNSWClassifier::isTrained() const
+{
+    return entry_point_ >= 0;
+}
+
+bool HNSWClassifier::isClassifier() const
+{
+    return true;
+}
+
+bool HNSWClassifier::train(const cv::Ptr<cv::ml::TrainData> &data, int)
+{
+    CV_Assert(data != nullptr);
+    return train(data->getTrainSamples(cv::ml::ROW_SAMPLE),
+                 cv::ml::ROW_SAMPLE, data->getTrainResponses());
+}
+
+bool HNSWClassifier::train(cv::InputArray samples, int layout,
+                           cv::InputArray responses)
+{
+    CV_Assert(layout == cv::ml::ROW_SAMPLE);
+    const cv::Mat X = samples.getMat();
+    const cv::Mat y = responses.getMat();
+    CV_Assert(X.rows > 0 && X.channels() == 1);
+    CV_Assert(y.total() == size_t(X.rows) && y.channels() == 1);
+
+    clear();
+    X.convertTo(samples_, CV_32F);
+    y.reshape(1, X.rows).convertTo(labels_, CV_32S);
+    const int N = samples_.rows;
+
+    // Levels are drawn before building so they do not depend on the
+    // insertion order of the threads.
+    const double mL = 1.0 / std::log(double(M_));
+    cv::RNG &rng = cv::theRNG();
+    levels_.resize(N);
+    for (int i = 0; i < N; ++i)
+        levels_[i] = std::min(MAX_LEVEL,
+                              int(-std::log(1.0 - rng.uniform(0.0, 1.0)) * mL));
+    allocate_links();
+    entry_point_ = 0;
+    max_level_ = levels_[0];
+
+    std::vector<std::mutex> locks(N);
+    std::mutex entry_lock;
+#ifdef USE_OPENMP
+#pragma omp parallel
+#endif
+    {
+        VisitedList visited(N);
+#ifdef USE_OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+        for (int i = 1; i < N; ++i)
+            insert(i, visited, locks, entry_lock);
+    }
+    return true;
+}
+
+float HNSWClassifier::predict(cv::InputArray samples, cv::OutputArray results,
+                              int) const
+{
+    CV_Assert(isTrained());
+    const cv::Mat X = samples.getMat();
+    cv::Mat idx, dists;
+    find_nearest(X, K_, idx, dists);
+
+    cv::Mat predictions(X.rows, 1, CV_32FC1);
+    for (int i = 0; i < X.rows; ++i)
+    {
+        const int *ix = idx.ptr<int>(i);
+        const int n = int(std::find(ix, ix + idx.cols, -1) - ix);
+        predictions.at<float>(i) = float(fsiv_knn_vote(labels_.ptr<int>(), ix, n));
+    }
+    if (results.needed())
+        predictions.copyTo(results);
+    return X.rows > 0 ? predictions.at<float>(0) : 0.0f;
+}
+
+void HNSWClassifier::clear()
+{
+    samples_.release();
+    labels_.release();
+    levels_.clear();
+    links0_.clear();
+    upper_.clear();
+    offsets_.clear();
+    entry_point_ = -1;
+    max_level_ = -1;
+}
+
+void HNSWClassifier::write(cv::FileStorage &fs) const
+{
+    writeFormat(fs);
+    fs << "K" << K_;
+    fs << "M" << M_;
+    fs << "ef_construction" << ef_construction_;
+    fs << "ef_search" << ef_search_;
+    fs << "entry_point" << entry_point_;
+    fs << "max_level" << max_level_;
+    fs << "samples" << samples_;
+    fs << "labels" << labels_;
+    fs << "levels" << cv::Mat(levels_);
+    fs << "links0" << cv::Mat(links0_);
+    fs << "upper_links" << cv::Mat(upper_);
+}
+
+void HNSWClassifier::read(const cv::FileNode &fn)
+{
+    clear();
+    fn["K"] >> K_;
+    fn["M"] >> M_;
+    fn["ef_construction"] >> ef_construction_;
+    fn["ef_search"] >> ef_search_;
+    fn["samples"] >> samples_;
+    fn["labels"] >> labels_;
+    CV_Assert(K_ > 0 && M_ > 1 && ef_construction_ > 0 && ef_search_ > 0);
+    CV_Assert(samples_.type() == CV_32FC1 && labels_.rows == samples_.rows);
+
+    cv::Mat levels, links0, upper;
+    fn["levels"] >> levels;
+    fn["links0"] >> links0;
+    fn["upper_links"] >> upper;
+    CV_Assert(levels.type() == CV_32SC1 && int(levels.total()) == samples_.rows);
+    levels_.assign(levels.ptr<int>(), levels.ptr<int>() + levels.total());
+    allocate_links();
+    CV_Assert(links0.total() == links0_.size() && upper.total() == upper_.size());
+    if (!links0_.empty())
+        std::copy(links0.ptr<int>(), links0.ptr<int>() + links0.total(), links0_.begin());
+    if (!upper_.empty())
+        std::copy(upper.ptr<int>(), upper.ptr<int>() + upper.total(), upper_.begin());
+
+    int entry = -1;
+    fn["entry_point"] >> entry;
+    fn["max_level"] >> max_level_;
+    CV_Assert(entry >= 0 && entry < samples_.rows && max_level_ == levels_[entry]);
+    entry_point_ = entry;
+}
+
+cv::String HNSWClassifier::getDefaultName() const
+{
+    return "fsiv_ml_hnsw";
+}
@@ -0,0 +1,183 @@
+/**
+ *  @file hnsw_classifier.hpp
+ */
+#pragma once
+
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+
+/**
+ * @brief Approximate K-NN classifier on a HNSW graph index.
+ *
+ * Hierarchical Navigable Small World graph (Malkov & Yashunin): every
+ * reference is a node linked to its M nearest neighbours (2M at the base
+ * layer) chosen with the diversity heuristic. Upper layers hold an
+ * exponentially decreasing subset of nodes, so a query greedily descends
+ * from the entry point and then runs a beam search of width efSearch at
+ * the base layer. The graph is built inserting the references in
+ * parallel with a lock per node.
+ */
+class HNSWClassifier : public cv::ml::StatModel
+{
+public:
+    HNSWClassifier();
+    virtual ~HNSWClassifier();
+
+    /**
+     * @brief Create a classifier with K=1, M=16, efConstruction=200 and
+     * efSearch=64.
+     */
+    static cv::Ptr<HNSWClassifier> create();
+
+    /**
+     * @brief Get the number of neighbours used to predict.
+     */
+    int get_K() const;
+
+    /**
+     * @brief Set the number of neighbours used to predict.
+     * @pre K>0
+     */
+    void set_K(int K);
+
+    /**
+     * @brief Get the num. of links per node in the upper layers.
+     */
+    int get_M() const;
+
+    /**
+     * @brief Set the num. of links per node (2M at the base layer).
+     * Changing it clears the trained graph.
+     * @pre M>1
+     */
+    void set_M(int M);
+
+    /**
+     * @brief Get the beam width used while building the graph.
+     */
+    int get_ef_construction() const;
+
+    /**
+     * @brief Set the beam width used while building the graph.
+     * @pre ef>0
+     */
+    void set_ef_construction(int ef);
+
+    /**
+     * @brief Get the beam width used while searching.
+     */
+    int get_ef_search() const;
+
+    /**
+     * @brief Set the beam width used while searching. Higher values trade
+     * latency for recall. The effective width is at least K.
+     * @pre ef>0
+     */
+    void set_ef_search(int ef);
+
+    /**
+     * @brief The labels of the reference samples (CV_32SC1 column).
+     */
+    const cv::Mat &get_labels() const;
+
+    /**
+     * @brief Find (approximately) the K nearest references of each sample.
+     * @param X are the samples (one per row).
+     * @param K is the number of neighbours.
+     * @param[out] idx are the indices of the neighbours sorted by distance.
+     * If the search finds less than K neighbours the row is completed with
+     * -1 indices.
+     * @param[out] dists are their squared L2 distances (FLT_MAX for the
+     * missing neighbours).
+     */
+    void find_nearest(const cv::Mat &X, int K, cv::Mat &idx,
+                      cv::Mat &dists) const;
+
+    virtual int getVarCount() const override;
+    virtual bool isTrained() const override;
+    virtual bool isClassifier() const override;
+    virtual bool train(const cv::Ptr<cv::ml::TrainData> &data,
+                       int flags = 0) override;
+    virtual bool train(cv::InputArray samples, int layout,
+                       cv::InputArray responses) override;
+    virtual float predict(cv::InputArray samples,
+                          cv::OutputArray results = cv::noArray(),
+                          int flags = 0) const override;
+    virtual void clear() override;
+    virtual void write(cv::FileStorage &fs) const override;
+    virtual void read(const cv::FileNode &fn) override;
+    virtual cv::String getDefaultName() const override;
+
+protected:
+    typedef std::pair<float, int> Candidate; // (squared distance, node)
+
+    /**
+     * @brief Marks visited nodes without clearing the marks between
+     * searches: a node is visited if its mark equals the current epoch.
+     */
+    struct VisitedList
+    {
+        explicit VisitedList(size_t n);
+        void reset();
+        std::vector<unsigned> marks;
+        unsigned epoch;
+    };
+
+    float distance(const float *a, int node) const;
+
+    /**
+     * @brief Size the link arrays for the levels of the nodes.
+     */
+    void allocate_links();
+
+    /**
+     * @brief Links of a node at a level: the count followed by the ids.
+     */
+    const int *links(int node, int level) const;
+    int *links(int node, int level);
+
+    /**
+     * @brief Greedy search of the nearest node at a level.
+     */
+    Candidate greedy_search(const float *q, Candidate entry, int level,
+                            std::vector<std::mutex> *locks) const;
+
+    /**
+     * @brief Beam search at a level.
+     * @param[out] result the ef nearest nodes found, sorted by distance.
+     * @param locks if not null, links are read under the node locks
+     * (used while building).
+     */
+    void search_layer(const float *q, Candidate entry, int ef, int level,
+                      VisitedList &visited, std::vector<Candidate> &result,
+                      std::vector<std::mutex> *locks) const;
+
+    /**
+     * @brief Keep at most M diverse neighbours: a candidate is discarded if
+     * it is closer to an already selected neighbour than to the base node.
+     * @param candidates are sorted by distance to the base node.
+     */
+    void select_neighbours(std::vector<Candidate> &candidates, int M) const;
+
+    /**
+     * @brief Insert a node into the graph.
+     */
+    void insert(int node, VisitedList &visited,
+                std::vector<std::mutex> &locks, std::mutex &entry_lock);
+
+    int K_;
+    int M_;
+    int ef_construction_;
+    int ef_search_;
+    cv::Mat samples_;             // CV_32FC1, one reference per row.
+    cv::Mat labels_;              // CV_32SC1 column.
+    std::vector<int> levels_;     // Top level of each node.
+    std::vector<int> links0_;     // Base layer: N x (1 + 2M).
+    std::vector<int> upper_;      // Upper layers: levels_[i] x (1 + M) per node.
+    std::vector<size_t> offsets_; // Offset of each node in upper_.
+    int entry_point_;
+    int max_level_;
+};
@@ -0,0 +1,427 @@
+/**
+ *  @file ivfpq_classifier.cpp
+ */
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include "distances.hpp"
+#include "kmeans.hpp"
+#include "knn_classifier.hpp"
+#include "ivfpq_classifier.hpp"
+
+static const int KMEANS_BATCH_SIZE = 2048;
+static const int KMEANS_ITERATIONS = 100;
+static const int QUERIES_BLOCK = 64;
+
+IVFPQClassifier::IVFPQClassifier()
+    : K_(1), lists_(64), code_size_(16), probes_(8), n_lists_(0), m_(0),
+      vars_(0), dsub_(0), ksub_(0)
+{
+}
+
+IVFPQClassifier::~IVFPQClassifier() {}
+
+cv::Ptr<IVFPQClassifier>
+IVFPQClassifier::create()
+{
+    return cv::makePtr<IVFPQClassifier>();
+}
+
+int IVFPQClassifier::get_K() const
+{
+    return K_;
+}
+
+void IVFPQClassifier::set_K(int K)
+{
+    CV_Assert(K > 0);
+    K_ = K;
+}
+
+int IVFPQClassifier::get_lists() const
+{
+    return lists_;
+}
+
+void IVFPQClassifier::set_lists(int lists)
+{
+    CV_Assert(lists > 0);
+    if (lists != lists_)
+        clear();
+    lists_ = lists;
+}
+
+int IVFPQClassifier::get_code_size() const
+{
+    return code_size_;
+}
+
+void IVFPQClassifier::set_code_size(int bytes)
+{
+    CV_Assert(bytes > 0);
+    if (bytes != code_size_)
+        clear();
+    code_size_ = bytes;
+}
+
+int IVFPQClassifier::get_probes() const
+{
+    return probes_;
+}
+
+void IVFPQClassifier::set_probes(int probes)
+{
+    CV_Assert(probes > 0);
+    probes_ = probes;
+}
+
+const cv::Mat &
+IVFPQClassifier::get_labels() const
+{
+    return labels_;
+}
+
+cv::Mat
+IVFPQClassifier::pad(const cv::Mat &X) const
+{
+    CV_Assert(X.cols == vars_ && X.channels() == 1);
+    const int cols = m_ * dsub_;
+    if (cols == vars_ && X.type() == CV_32FC1)
+        return X;
+    cv::Mat Xp = cv::Mat::zeros(X.rows, cols, CV_32FC1);
+    cv::Mat dst = Xp.colRange(0, vars_);
+    X.convertTo(dst, CV_32F);
+    return Xp;
+}
+
+cv::Mat
+IVFPQClassifier::reconstruct() const
+{
+    CV_Assert(isTrained());
+    cv::Mat R(codes_.rows, m_ * dsub_, CV_32FC1);
+    for (int l = 0; l < n_lists_; ++l)
+        for (int i = list_offsets_[l]; i < list_offsets_[l + 1]; ++i)
+        {
+            const uchar *code = codes_.ptr<uchar>(i);
+            const float *c = coarse_.ptr<float>(l);
+            float *r = R.ptr<float>(i);
+            std::copy(c, c + R.cols, r);
+            for (int j = 0; j < m_; ++j)
+            {
+                const float *p = codebooks_.ptr<float>(j * ksub_ + code[j]);
+                for (int d = 0; d < dsub_; ++d)
+                    r[j * dsub_ + d] += p[d];
+            }
+        }
+    return R;
+}
+
+void IVFPQClassifier::build_tables()
+{
+    const int m = m_;
+    coarse_sq_norms_ = fsiv_compute_sq_norms(coarse_);
+    const cv::Mat cb_norms = fsiv_compute_sq_norms(codebooks_);
+    list_tables_.create(n_lists_, m * ksub_, CV_32FC1);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int l = 0; l < n_lists_; ++l)
+    {
+        const float *c = coarse_.ptr<float>(l);
+        float *t = list_tables_.ptr<float>(l);
+        for (int j = 0; j < m; ++j)
+            for (int k = 0; k < ksub_; ++k)
+            {
+                const float *p = codebooks_.ptr<float>(j * ksub_ + k);
+                float dot = 0.0f;
+                for (int d = 0; d < dsub_; ++d)
+                    dot += c[j * dsub_ + d] * p[d];
+                t[j * ksub_ + k] = cb_norms.at<float>(j * ksub_ + k) + 2.0f * dot;
+            }
+    }
+}
+
+void IVFPQClassifier::find_nearest(const cv::Mat &X, int K, cv::Mat &idx,
+                                   cv::Mat &dists) const
+{
+    typedef std::pair<float, int> Candidate;
+    CV_Assert(isTrained());
+    CV_Assert(K > 0);
+    const cv::Mat Xp = pad(X);
+    const int N = codes_.rows;
+    const int m = m_;
+    K = std::min(K, N);
+    idx.create(X.rows, K, CV_32SC1);
+    dists.create(X.rows, K, CV_32FC1);
+    const int n_blocks = (X.rows + QUERIES_BLOCK - 1) / QUERIES_BLOCK;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic) if (n_blocks > 1)
+#endif
+    for (int b = 0; b < n_blocks; ++b)
+    {
+        const int i0 = b * QUERIES_BLOCK;
+        const int i1 = std::min(X.rows, i0 + QUERIES_BLOCK);
+        const cv::Mat Qb = Xp.rowRange(i0, i1);
+
+        // All the lists sorted by coarse distance: the first probes_ ones are
+        // scanned, and more only if they do not hold K references.
+        cv::Mat order, coarse_d;
+        fsiv_knn_search(Qb, coarse_, coarse_sq_norms_, n_lists_, order, coarse_d);
+
+        // B tables of the block, scaled by -2.
+        cv::Mat B(i1 - i0, m * ksub_, CV_32FC1), Bj;
+        for (int j = 0; j < m; ++j)
+        {
+            cv::gemm(Qb.colRange(j * dsub_, (j + 1) * dsub_),
+                     codebooks_.rowRange(j * ksub_, (j + 1) * ksub_), -2.0,
+                     cv::noArray(), 0.0, Bj, cv::GEMM_2_T);
+            cv::Mat dst = B.colRange(j * ksub_, (j + 1) * ksub_);
+            Bj.copyTo(dst);
+        }
+
+        std::vector<float> lut(size_t(m) * ksub_);
+        std::vector<Candidate> heap(K);
+        for (int r = 0; r < i1 - i0; ++r)
+        {
+            const float *bt = B.ptr<float>(r);
+            const int *lr = order.ptr<int>(r);
+            int n = 0;
+            float worst = std::numeric_limits<float>::max();
+            for (int p = 0; p < n_lists_ && (p < probes_ || n < K); ++p)
+            {
+                const int l = lr[p];
+                const float base = coarse_d.at<float>(r, p);
+                const float *t = list_tables_.ptr<float>(l);
+                float *lt = lut.data();
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+                for (int k = 0; k < m * ksub_; ++k)
+                    lt[k] = t[k] + bt[k];
+
+                for (int i = list_offsets_[l]; i < list_offsets_[l + 1]; ++i)
+                {
+                    const uchar *code = codes_.ptr<uchar>(i);
+                    float d = base;
+                    for (int j = 0; j < m; ++j)
+                        d += lt[j * ksub_ + code[j]];
+                    if (n < K)
+                    {
+                        heap[n++] = Candidate(d, i);
+                        std::push_heap(heap.begin(), heap.begin() + n);
+                        if (n == K)
+                            worst = heap[0].first;
+                    }
+                    else if (d < worst)
+                    {
+                        std::pop_heap(heap.begin(), heap.end());
+                        heap[K - 1] = Candidate(d, i);
+                        std::push_heap(heap.begin(), heap.end());
+                        worst = heap[0].first;
+                    }
+                }
+            }
+
+            std::sort_heap(heap.begin(), heap.end());
+            int *ix = idx.ptr<int>(i0 + r);
+            float *dx = dists.ptr<float>(i0 + r);
+            for (int k = 0; k < K; ++k)
+            {
+                ix[k] = heap[k].second;
+                dx[k] = std::max(0.0f, heap[k].first);
+            }
+        }
+    }
+}
+
+int IVFPQClassifier::getVarCount() const
+{
+    return vars_;
+}
+
+bool IVFPQClassifier::isTrained() const
+{
+    return !codes_.empty();
+}
+
+bool IVFPQClassifier::isClassifier() const
+{
+    return true;
+}
+
+bool IVFPQClassifier::train(const cv::Ptr<cv::ml::TrainData> &data, int)
+{
+    CV_Assert(data != nullptr);
+    return train(data->getTrainSamples(cv::ml::ROW_SAMPLE),
+                 cv::ml::ROW_SAMPLE, data->getTrainResponses());
+}
+
+bool IVFPQClassifier::train(cv::InputArray samples, int layout,
+                            cv::InputArray responses)
+{
+    CV_Assert(layout == cv::ml::ROW_SAMPLE);
+    const cv::Mat X = samples.getMat();
+    const cv::Mat y = responses.getMat();
+    CV_Assert(X.rows > 0 && X.cols > 0 && X.channels() == 1);
+    CV_Assert(y.total() == size_t(X.rows) && y.channels() == 1);
+
+    clear();
+    const int N = X.rows;
+    vars_ = X.cols;
+    // The configured sizes are kept: the model uses them clamped.
+    m_ = std::min(code_size_, vars_);
+    n_lists_ = std::min(lists_, N);
+    dsub_ = (vars_ + m_ - 1) / m_;
+    ksub_ = std::min(256, N);
+    const int m = m_;
+    const int batch = std::min(KMEANS_BATCH_SIZE, N);
+    const cv::Mat Xp = pad(X);
+    cv::RNG &rng = cv::theRNG();
+
+    // Coarse quantizer and residuals.
+    coarse_ = fsiv_minibatch_kmeans(Xp, n_lists_, batch, KMEANS_ITERATIONS, rng);
+    std::vector<int> assign;
+    fsiv_find_nearest_centers(Xp, coarse_, fsiv_compute_sq_norms(coarse_),
+                              assign);
+    cv::Mat R(N, Xp.cols, CV_32FC1);
+    for (int i = 0; i < N; ++i)
+    {
+        const float *x = Xp.ptr<float>(i);
+        const float *c = coarse_.ptr<float>(assign[i]);
+        float *r = R.ptr<float>(i);
+        for (int k = 0; k < Xp.cols; ++k)
+            r[k] = x[k] - c[k];
+    }
+
+    // Subquantizers are independent: learn and encode them in parallel.
+    std::vector<uint64> seeds(m);
+    for (auto &s : seeds)
+        s = rng.next();
+    codebooks_.create(m * ksub_, dsub_, CV_32FC1);
+    cv::Mat codes(N, m, CV_8UC1);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int j = 0; j < m; ++j)
+    {
+        const cv::Mat Rj = R.colRange(j * dsub_, (j + 1) * dsub_).clone();
+        cv::RNG local_rng(seeds[j]);
+        cv::Mat cb = codebooks_.rowRange(j * ksub_, (j + 1) * ksub_);
+        fsiv_minibatch_kmeans(Rj, ksub_, batch, KMEANS_ITERATIONS, local_rng)
+            .copyTo(cb);
+        std::vector<int> words;
+        fsiv_find_nearest_centers(Rj, cb, fsiv_compute_sq_norms(cb), words);
+        for (int i = 0; i < N; ++i)
+            codes.at<uchar>(i, j) = uchar(words[i]);
+    }
+
+    // Store the codes grouped by inverted list.
+    cv::Mat y32;
+    y.reshape(1, N).convertTo(y32, CV_32S);
+    list_offsets_.assign(n_lists_ + 1, 0);
+    for (int i = 0; i < N; ++i)
+        ++list_offsets_[assign[i] + 1];
+    for (int l = 0; l < n_lists_; ++l)
+        list_offsets_[l + 1] += list_offsets_[l];
+    std::vector<int> pos(list_offsets_.begin(), list_offsets_.end() - 1);
+    codes_.create(N, m, CV_8UC1);
+    labels_.create(N, 1, CV_32SC1);
+    for (int i = 0; i < N; ++i)
+    {
+        const int p = pos[assign[i]]++;
+        std::copy(codes.ptr<uchar>(i), codes.ptr<uchar>(i) + m, codes_.ptr<uchar>(p));
+        labels_.at<int>(p) = y32.at<int>(i);
+    }
+
+    build_tables();
+    return true;
+}
+
+float IVFPQClassifier::predict(cv::InputArray samples, cv::OutputArray results,
+                               int) const
+{
+    CV_Assert(isTrained());
+    const cv::Mat X = samples.getMat();
+    cv::Mat idx, dists;
+    find_nearest(X, K_, idx, dists);
+
+    cv::Mat predictions(X.rows, 1, CV_32FC1);
+    for (int i = 0; i < X.rows; ++i)
+        predictions.at<float>(i) =
+            float(fsiv_knn_vote(labels_.ptr<int>(), idx.ptr<int>(i), idx.cols));
+    if (results.needed())
+        predictions.copyTo(results);
+    return X.rows > 0 ? predictions.at<float>(0) : 0.0f;
+}
+
+void IVFPQClassifier::clear()
+{
+    n_lists_ = m_ = vars_ = dsub_ = ksub_ = 0;
+    coarse_.release();
+    codebooks_.release();
+    codes_.release();
+    labels_.release();
+    list_offsets_.clear();
+    coarse_sq_norms_.release();
+    list_tables_.release();
+}
+
+void IVFPQClassifier::write(cv::FileStorage &fs) const
+{
+    writeFormat(fs);
+    fs << "K" << K_;
+    fs << "lists" << lists_;
+    fs << "code_size" << code_size_;
+    fs << "probes" << probes_;
+    fs << "n_lists" << n_lists_;
+    fs << "m" << m_;
+    fs << "vars" << vars_;
+    fs << "dsub" << dsub_;
+    fs << "ksub" << ksub_;
+    fs << "coarse" << coarse_;
+    fs << "codebooks" << codebooks_;
+    fs << "list_offsets" << cv::Mat(list_offsets_);
+    fs << "codes" << codes_;
+    fs << "labels" << labels_;
+}
+
+void IVFPQClassifier::read(const cv::FileNode &fn)
+{
+    clear();
+    fn["K"] >> K_;
+    fn["lists"] >> lists_;
+    fn["code_size"] >> code_size_;
+    fn["probes"] >> probes_;
+    fn["n_lists"] >> n_lists_;
+    fn["m"] >> m_;
+    fn["vars"] >> vars_;
+    fn["dsub"] >> dsub_;
+    fn["ksub"] >> ksub_;
+    fn["coarse"] >> coarse_;
+    fn["codebooks"] >> codebooks_;
+    cv::Mat offsets;
+    fn["list_offsets"] >> offsets;
+    fn["codes"] >> codes_;
+    fn["labels"] >> labels_;
+
+    CV_Assert(K_ > 0 && lists_ > 0 && code_size_ > 0 && probes_ > 0);
+    CV_Assert(n_lists_ > 0 && n_lists_ <= lists_ && m_ > 0 && m_ <= code_size_);
+    CV_Assert(ksub_ > 0 && ksub_ <= 256 && dsub_ * m_ >= vars_);
+    CV_Assert(coarse_.type() == CV_32FC1 && coarse_.rows == n_lists_ &&
+              coarse_.cols == m_ * dsub_);
+    CV_Assert(codebooks_.type() == CV_32FC1 &&
+              codebooks_.rows == m_ * ksub_ && codebooks_.cols == dsub_);
+    CV_Assert(codes_.type() == CV_8UC1 && codes_.cols == m_);
+    CV_Assert(labels_.rows == codes_.rows);
+    CV_Assert(offsets.type() == CV_32SC1 && int(offsets.total()) == n_lists_ + 1);
+    list_offsets_.assign(offsets.ptr<int>(), offsets.ptr<int>() + offsets.total());
+    CV_Assert(list_offsets_.back() == codes_.rows);
+    build_tables();
+}
+
+cv::String IVFPQClassifier::getDefaultName() const
+{
+    return "fsiv_ml_ivfpq";
+}
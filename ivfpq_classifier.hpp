@@ -0,0 +1,147 @@
+/**
+ *  @file ivfpq_classifier.hpp
+ */
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+
+/**
+ * @brief Approximate K-NN classifier on a compressed IVF-PQ index.
+ *
+ * The references are partitioned by a coarse k-means quantizer into
+ * inverted lists, and the residual of each reference to its coarse center
+ * is encoded by a product quantizer: the feature vector is split into m
+ * subvectors, each one replaced by the 1 byte index of its nearest
+ * codeword. Only the codes (m bytes per reference), the labels and the
+ * codebooks are stored.
+ *
+ * A query only scans the n_probe lists with the nearest coarse centers,
+ * using asymmetric distances: the squared distance to a code is
+ * ||q-c||^2 + sum_j T_c[j][code_j] - 2 B[j][code_j], where the table
+ * T_c[j][k] = ||p_jk||^2 + 2c_j·p_jk is precomputed per list and the
+ * table B[j][k] = q_j·p_jk is computed once per query.
+ */
+class IVFPQClassifier : public cv::ml::StatModel
+{
+public:
+    IVFPQClassifier();
+    virtual ~IVFPQClassifier();
+
+    /**
+     * @brief Create a classifier with K=1, 64 lists, 16 bytes codes and
+     * 8 probes.
+     */
+    static cv::Ptr<IVFPQClassifier> create();
+
+    /**
+     * @brief Get the number of neighbours used to predict.
+     */
+    int get_K() const;
+
+    /**
+     * @brief Set the number of neighbours used to predict.
+     * @pre K>0
+     */
+    void set_K(int K);
+
+    /**
+     * @brief Get the number of inverted lists (coarse centers).
+     */
+    int get_lists() const;
+
+    /**
+     * @brief Set the number of inverted lists. Changing it clears the model.
+     * @pre lists>0
+     */
+    void set_lists(int lists);
+
+    /**
+     * @brief Get the number of bytes per code (subquantizers).
+     */
+    int get_code_size() const;
+
+    /**
+     * @brief Set the number of bytes per code. Changing it clears the model.
+     * @pre bytes>0
+     */
+    void set_code_size(int bytes);
+
+    /**
+     * @brief Get the number of lists scanned per query.
+     */
+    int get_probes() const;
+
+    /**
+     * @brief Set the number of lists scanned per query.
+     * @pre probes>0
+     */
+    void set_probes(int probes);
+
+    /**
+     * @brief Find (approximately) the K nearest references of each sample.
+     * @param X are the samples (one per row).
+     * @param K is the number of neighbours.
+     * @param[out] idx are the indices of the neighbours sorted by distance
+     * (in the order of the inverted lists, @see get_labels()).
+     * @param[out] dists are their approximate squared L2 distances.
+     */
+    void find_nearest(const cv::Mat &X, int K, cv::Mat &idx,
+                      cv::Mat &dists) const;
+
+    /**
+     * @brief The labels of the references in inverted list order.
+     */
+    const cv::Mat &get_labels() const;
+
+    /**
+     * @brief Decode the references: coarse center plus codewords.
+     * @return the (zero padded) decoded references in inverted list order.
+     */
+    cv::Mat reconstruct() const;
+
+    virtual int getVarCount() const override;
+    virtual bool isTrained() const override;
+    virtual bool isClassifier() const override;
+    virtual bool train(const cv::Ptr<cv::ml::TrainData> &data,
+                       int flags = 0) override;
+    virtual bool train(cv::InputArray samples, int layout,
+                       cv::InputArray responses) override;
+    virtual float predict(cv::InputArray samples,
+                          cv::OutputArray results = cv::noArray(),
+                          int flags = 0) const override;
+    virtual void clear() override;
+    virtual void write(cv::FileStorage &fs) const override;
+    virtual void read(const cv::FileNode &fn) override;
+    virtual cv::String getDefaultName() const override;
+
+protected:
+    /**
+     * @brief Pad the samples with zeros to m*dsub columns (CV_32FC1).
+     * @pre isTrained()
+     */
+    cv::Mat pad(const cv::Mat &X) const;
+
+    /**
+     * @brief Compute the tables derived from the stored model.
+     */
+    void build_tables();
+
+    int K_;
+    int lists_;                    // Configured lists.
+    int code_size_;                // Configured bytes per code.
+    int probes_;
+    int n_lists_;                  // Lists of the model (<=lists_).
+    int m_;                        // Subquantizers of the model (<=code_size_).
+    int vars_;                     // Feature dimension.
+    int dsub_;                     // Subvector dimension.
+    int ksub_;                     // Codewords per subquantizer (<=256).
+    cv::Mat coarse_;               // n_lists x (m*dsub) coarse centers.
+    cv::Mat codebooks_;            // (m*ksub) x dsub codewords.
+    cv::Mat codes_;                // N x m CV_8UC1, in inverted list order.
+    cv::Mat labels_;               // N x 1 CV_32SC1, in inverted list order.
+    std::vector<int> list_offsets_; // n_lists+1 offsets into codes_.
+    cv::Mat coarse_sq_norms_;
+    cv::Mat list_tables_;          // n_lists x (m*ksub) tables T_c.
+};
@@ -0,0 +1,185 @@
+/**
+ *  @file kdtree.cpp
+ */
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include "kdtree.hpp"
+
+// Subtrees with more points than this are built as separate tasks.
+static const int PARALLEL_BUILD_SIZE = 4096;
+
+KDTree::KDTree() : depth_(0) {}
+
+bool KDTree::empty() const
+{
+    return points_.empty();
+}
+
+void KDTree::clear()
+{
+    depth_ = 0;
+    points_.release();
+    index_.clear();
+    split_dim_.clear();
+    split_val_.clear();
+    begin_.clear();
+    end_.clear();
+}
+
+void KDTree::build(const cv::Mat &X, int leaf_size)
+{
+    CV_Assert(X.type() == CV_32FC1 && X.rows > 0);
+    CV_Assert(leaf_size > 0);
+
+    clear();
+    const int N = X.rows;
+    while ((N + (1 << depth_) - 1) >> depth_ > leaf_size)
+        ++depth_;
+    const int n_nodes = (2 << depth_) - 1;
+    split_dim_.assign(n_nodes, 0);
+    split_val_.assign(n_nodes, 0.0f);
+    begin_.assign(n_nodes, 0);
+    end_.assign(n_nodes, 0);
+    index_.resize(N);
+    for (int i = 0; i < N; ++i)
+        index_[i] = i;
+
+#ifdef USE_OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    build_node(X, 0, 0, N, 0);
+
+    points_.create(N, X.cols, CV_32FC1);
+    for (int i = 0; i < N; ++i)
+        X.row(index_[i]).copyTo(points_.row(i));
+}
+
+void KDTree::build_node(const cv::Mat &X, int node, int begin, int end,
+                        int depth)
+{
+    begin_[node] = begin;
+    end_[node] = end;
+    if (depth == depth_ || end - begin < 2)
+    {
+        // A short range still gets (empty) children down to the leaves.
+        if (depth < depth_)
+        {
+            build_node(X, 2 * node + 1, begin, end, depth + 1);
+            build_node(X, 2 * node + 2, end, end, depth + 1);
+        }
+        return;
+    }
+
+    // Split at the median of the dimension with the largest spread.
+    std::vector<float> lo(X.cols, std::numeric_limits<float>::max());
+    std::vector<float> hi(X.cols, std::numeric_limits<float>::lowest());
+    for (int i = begin; i < end; ++i)
+    {
+        const float *x = X.ptr<float>(index_[i]);
+        for (int k = 0; k < X.cols; ++k)
+        {
+            lo[k] = std::min(lo[k], x[k]);
+            hi[k] = std::max(hi[k], x[k]);
+        }
+    }
+    int dim = 0;
+    for (int k = 1; k < X.cols; ++k)
+        if (hi[k] - lo[k] > hi[dim] - lo[dim])
+            dim = k;
+
+    const int mid = begin + (end - begin) / 2;
+    std::nth_element(index_.begin() + begin, index_.begin() + mid,
+                     index_.begin() + end, [&X, dim](int a, int b)
+                     { return X.at<float>(a, dim) < X.at<float>(b, dim); });
+    split_dim_[node] = dim;
+    split_val_[node] = X.at<float>(index_[mid], dim);
+
+#ifdef USE_OPENMP
+#pragma omp task if (end - begin > PARALLEL_BUILD_SIZE)
+#endif
+    build_node(X, 2 * node + 1, begin, mid, depth + 1);
+    build_node(X, 2 * node + 2, mid, end, depth + 1);
+#ifdef USE_OPENMP
+#pragma omp taskwait
+#endif
+}
+
+void KDTree::knn_search(const cv::Mat &Q, int K, cv::Mat &idx,
+                        cv::Mat &dists) const
+{
+    CV_Assert(!empty());
+    CV_Assert(Q.type() == CV_32FC1 && Q.cols == points_.cols && K > 0);
+
+    K = std::min(K, points_.rows);
+    idx.create(Q.rows, K, CV_32SC1);
+    dists.create(Q.rows, K, CV_32FC1);
+    const int first_leaf = (1 << depth_) - 1;
+    const int D = points_.cols;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 64) if (Q.rows > 1)
+#endif
+    for (int i = 0; i < Q.rows; ++i)
+    {
+        typedef std::pair<float, int> Candidate;
+        const float *q = Q.ptr<float>(i);
+        // A max-heap of K candidates, the worst one on top.
+        std::vector<Candidate> heap;
+        heap.reserve(K);
+        // Nodes to visit with a lower bound of their distance.
+        std::vector<std::pair<int, float>> stack(1, std::make_pair(0, 0.0f));
+        while (!stack.empty())
+        {
+            const int node = stack.back().first;
+            const float bound = stack.back().second;
+            stack.pop_back();
+            if (int(heap.size()) == K && bound > heap[0].first)
+                continue;
+
+            if (node >= first_leaf)
+            {
+                for (int p = begin_[node]; p < end_[node]; ++p)
+                {
+                    const float *x = points_.ptr<float>(p);
+                    float d = 0.0f;
+#ifdef USE_OPENMP
+#pragma omp simd reduction(+ : d)
+#endif
+                    for (int k = 0; k < D; ++k)
+                        d += (q[k] - x[k]) * (q[k] - x[k]);
+                    const Candidate c(d, index_[p]);
+                    if (int(heap.size()) < K)
+                    {
+                        heap.push_back(c);
+                        std::push_heap(heap.begin(), heap.end());
+                    }
+                    else if (c < heap[0])
+                    {
+                        std::pop_heap(heap.begin(), heap.end());
+                        heap.back() = c;
+                        std::push_heap(heap.begin(), heap.end());
+                    }
+                }
+                continue;
+            }
+
+            // Visit the child on the query side first (pushed last).
+            const float diff = q[split_dim_[node]] - split_val_[node];
+            const int near = diff < 0.0f ? 2 * node + 1 : 2 * node + 2;
+            const int far = diff < 0.0f ? 2 * node + 2 : 2 * node + 1;
+            stack.push_back(std::make_pair(far, std::max(bound, diff * diff)));
+            stack.push_back(std::make_pair(near, bound));
+        }
+
+        std::sort_heap(heap.begin(), heap.end());
+        int *ix = idx.ptr<int>(i);
+        float *dx = dists.ptr<float>(i);
+        for (int k = 0; k < K; ++k)
+        {
+            ix[k] = heap[k].second;
+            dx[k] = heap[k].first;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ *  @file kdtree.hpp
+ */
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Exact nearest neighbours search with a balanced KD-tree.
+ *
+ * The tree is a complete binary tree stored in flat arrays (the children
+ * of node i are 2i+1 and 2i+2): each inner node splits its points at the
+ * median of the dimension of largest spread, and the points of every leaf
+ * are stored contiguously so a leaf is scanned linearly. Subtrees are
+ * built in parallel as OpenMP tasks.
+ *
+ * Queries descend to the nearest leaf first and prune the subtrees whose
+ * splitting plane is farther than the current K-th neighbour. This only
+ * pays off for low dimensional features (tens of dimensions at most).
+ */
+class KDTree
+{
+public:
+    KDTree();
+
+    /**
+     * @brief Build the tree.
+     * @param X are the points (one per row).
+     * @param leaf_size is the maximum number of points per leaf.
+     * @pre X.type()==CV_32FC1 && X.rows>0
+     * @pre leaf_size>0
+     */
+    void build(const cv::Mat &X, int leaf_size = 16);
+
+    /**
+     * @brief Find the K nearest points (squared L2 distance) of each query.
+     * @param Q are the queries (one per row).
+     * @param K is the number of neighbours (clipped to the num. of points).
+     * @param[out] idx is a Q.rows x K CV_32SC1 matrix with the row indices
+     * of the neighbours sorted by increasing distance (ties by index).
+     * @param[out] dists is a Q.rows x K CV_32FC1 matrix with their squared
+     * distances.
+     * @pre !empty()
+     * @pre Q.type()==CV_32FC1 && Q.cols==dimension of the points.
+     */
+    void knn_search(const cv::Mat &Q, int K, cv::Mat &idx,
+                    cv::Mat &dists) const;
+
+    /**
+     * @brief Is the tree not built?
+     */
+    bool empty() const;
+
+    /**
+     * @brief Release the tree.
+     */
+    void clear();
+
+protected:
+    void build_node(const cv::Mat &X, int node, int begin, int end,
+                    int depth);
+
+    int depth_;                    // Depth of the leaves.
+    cv::Mat points_;               // Points sorted by leaf.
+    std::vector<int> index_;       // Row of each point in the input.
+    std::vector<int> split_dim_;   // Splitting dimension of each node.
+    std::vector<float> split_val_; // Splitting value of each node.
+    std::vector<int> begin_;       // Range of points of each node.
+    std::vector<int> end_;
+};
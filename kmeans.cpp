@@ -0,0 +1,133 @@
+/**
+ *  @file kmeans.cpp
+ */
+#include <limits>
+#include <vector>
+#include "distances.hpp"
+#include "kmeans.hpp"
+
+/**
+ * @brief Seed K centers with k-means++ on a subset of the samples.
+ */
+static cv::Mat
+kmeanspp_seeds(const cv::Mat &samples, int K, cv::RNG &rng)
+{
+    // Seeding cost is O(n·K·d), so only a few samples per center are used.
+    const int n = std::min(samples.rows, 4 * K);
+    std::vector<int> subset(samples.rows);
+    for (int i = 0; i < samples.rows; ++i)
+        subset[i] = i;
+    for (int i = 0; i < n; ++i)
+        std::swap(subset[i], subset[rng.uniform(i, samples.rows)]);
+
+    cv::Mat S(n, samples.cols, CV_32FC1);
+    for (int i = 0; i < n; ++i)
+        samples.row(subset[i]).copyTo(S.row(i));
+
+    cv::Mat centers(K, samples.cols, CV_32FC1);
+    std::vector<double> min_d(n, std::numeric_limits<double>::max());
+    int next = rng.uniform(0, n);
+    for (int k = 0; k < K; ++k)
+    {
+        S.row(next).copyTo(centers.row(k));
+        const float *c = centers.ptr<float>(k);
+        double total = 0.0;
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+ : total)
+#endif
+        for (int i = 0; i < n; ++i)
+        {
+            const float *s = S.ptr<float>(i);
+            float d = 0.0f;
+            for (int j = 0; j < S.cols; ++j)
+                d += (s[j] - c[j]) * (s[j] - c[j]);
+            min_d[i] = std::min(min_d[i], double(d));
+            total += min_d[i];
+        }
+        if (k + 1 < K)
+        {
+            // sample the next seed with probability proportional to D^2.
+            double r = rng.uniform(0.0, 1.0) * total;
+            next = n - 1;
+            for (int i = 0; i < n; ++i)
+            {
+                r -= min_d[i];
+                if (r <= 0.0)
+                {
+                    next = i;
+                    break;
+                }
+            }
+        }
+    }
+    return centers;
+}
+
+cv::Mat
+fsiv_minibatch_kmeans(const cv::Mat &samples, int K,
+                      int batch_size, int iterations,
+                      cv::RNG &rng)
+{
+    CV_Assert(samples.type() == CV_32FC1);
+    CV_Assert(K > 0 && samples.rows >= K);
+    CV_Assert(batch_size > 0 && iterations >= 0);
+
+    const int d = samples.cols;
+    cv::Mat centers = kmeanspp_seeds(samples, K, rng);
+    cv::Mat c_norms = fsiv_compute_sq_norms(centers);
+    std::vector<double> counts(K, 0.0);
+
+    batch_size = std::min(batch_size, samples.rows);
+    cv::Mat batch(batch_size, d, CV_32FC1);
+    cv::Mat sums(K, d, CV_32FC1);
+    std::vector<int> batch_count(K);
+    std::vector<int> labels;
+
+    for (int it = 0; it < iterations; ++it)
+    {
+        for (int i = 0; i < batch_size; ++i)
+            samples.row(rng.uniform(0, samples.rows)).copyTo(batch.row(i));
+
+        fsiv_find_nearest_centers(batch, centers, c_norms, labels);
+
+        sums.setTo(0.0);
+        std::fill(batch_count.begin(), batch_count.end(), 0);
+        for (int i = 0; i < batch_size; ++i)
+        {
+            const int l = labels[i];
+            const float *x = batch.ptr<float>(i);
+            float *s = sums.ptr<float>(l);
+            for (int j = 0; j < d; ++j)
+                s[j] += x[j];
+            ++batch_count[l];
+        }
+
+        // c <- c + (sum - n*c) / count, the batched form of the per-sample
+        // update c <- (1 - 1/count)c + x/count.
+        for (int k = 0; k < K; ++k)
+        {
+            if (batch_count[k] == 0)
+                continue;
+            counts[k] += batch_count[k];
+            const float lr = float(1.0 / counts[k]);
+            const float n_k = float(batch_count[k]);
+            float *c = centers.ptr<float>(k);
+            const float *s = sums.ptr<float>(k);
+            float norm = 0.0f;
+            for (int j = 0; j < d; ++j)
+            {
+                c[j] += lr * (s[j] - n_k * c[j]);
+                norm += c[j] * c[j];
+            }
+            c_norms.at<float>(k) = norm;
+        }
+    }
+
+    // Re-seed the dead centers.
+    for (int k = 0; k < K && iterations > 0; ++k)
+        if (counts[k] == 0.0)
+            samples.row(rng.uniform(0, samples.rows)).copyTo(centers.row(k));
+
+    CV_Assert(centers.rows == K && centers.cols == samples.cols);
+    return centers;
+}
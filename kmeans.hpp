@@ -0,0 +1,31 @@
+/**
+ *  @file kmeans.hpp
+ */
+#pragma once
+
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Cluster samples with mini-batch k-means.
+ *
+ * Centers are seeded with k-means++ on a random subset of the samples and
+ * then refined with @a iterations mini-batch updates (Sculley, 2010): each
+ * batch is assigned in parallel to its nearest centers and every center
+ * moves towards the mean of its assigned samples with a per-center
+ * learning rate 1/count. Centers that never receive samples are re-seeded
+ * with random samples.
+ *
+ * @param samples are the samples to cluster (one per row).
+ * @param K is the number of clusters.
+ * @param batch_size is the number of samples used per iteration.
+ * @param iterations is the number of mini-batch iterations.
+ * @param rng is the random generator used for seeding and sampling.
+ * @return the centers, one per row.
+ * @pre samples.type()==CV_32FC1
+ * @pre samples.rows>=K && K>0
+ * @post ret_v.rows==K && ret_v.cols==samples.cols
+ * @post ret_v.type()==CV_32FC1
+ */
+cv::Mat fsiv_minibatch_kmeans(const cv::Mat &samples, int K,
+                              int batch_size, int iterations,
+                              cv::RNG &rng);
@@ -0,0 +1,396 @@
+/**
+ *  @file knn_classifier.cpp
+ */
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include "distances.hpp"
+#include "kmeans.hpp"
+#include "knn_classifier.hpp"
+
+// Condensing tests this many references at a time against the subset.
+static const int CONDENSE_BLOCK = 256;
+
+int fsiv_knn_vote(const int *labels, const int *neighbours, int K)
+{
+    CV_Assert(K > 0);
+    // As neighbours are sorted by distance, the first class found with the
+    // best count is also the one with the nearest neighbour among the tied.
+    int best = labels[neighbours[0]];
+    int best_count = 0;
+    for (int i = 0; i < K; ++i)
+    {
+        const int l = labels[neighbours[i]];
+        int count = 0;
+        for (int j = 0; j < K; ++j)
+            count += labels[neighbours[j]] == l;
+        if (count > best_count)
+        {
+            best_count = count;
+            best = l;
+        }
+    }
+    return best;
+}
+
+int fsiv_knn_weighted_vote(const int *labels, const int *neighbours,
+                           const float *sq_dists, int K)
+{
+    CV_Assert(K > 0);
+    int best = labels[neighbours[0]];
+    float best_weight = -1.0f;
+    for (int i = 0; i < K; ++i)
+    {
+        const int l = labels[neighbours[i]];
+        float weight = 0.0f;
+        for (int j = 0; j < K; ++j)
+            if (labels[neighbours[j]] == l)
+                weight += 1.0f / (std::sqrt(sq_dists[j]) + 1e-6f);
+        if (weight > best_weight)
+        {
+            best_weight = weight;
+            best = l;
+        }
+    }
+    return best;
+}
+
+cv::Mat fsiv_knn_leave_one_out(const cv::Mat &X, const cv::Mat &y, int K)
+{
+    CV_Assert(y.total() == size_t(X.rows));
+    cv::Mat Xf = X, labels;
+    if (X.type() != CV_32FC1)
+        X.convertTo(Xf, CV_32F);
+    y.reshape(1, X.rows).convertTo(labels, CV_32S);
+    cv::Mat idx, dists;
+    fsiv_loo_knn_search(Xf, fsiv_compute_sq_norms(Xf), K, idx, dists);
+    cv::Mat predictions(X.rows, 1, CV_32SC1);
+    for (int i = 0; i < X.rows; ++i)
+        predictions.at<int>(i) =
+            fsiv_knn_vote(labels.ptr<int>(), idx.ptr<int>(i), idx.cols);
+    return predictions;
+}
+
+KNNClassifier::KNNClassifier() : K_(1), algorithm_(AUTO) {}
+
+KNNClassifier::~KNNClassifier() {}
+
+cv::Ptr<KNNClassifier>
+KNNClassifier::create()
+{
+    return cv::makePtr<KNNClassifier>();
+}
+
+int KNNClassifier::get_K() const
+{
+    return K_;
+}
+
+void KNNClassifier::set_K(int K)
+{
+    CV_Assert(K > 0);
+    K_ = K;
+}
+
+int KNNClassifier::get_algorithm() const
+{
+    return algorithm_;
+}
+
+void KNNClassifier::set_algorithm(int algorithm)
+{
+    CV_Assert(algorithm == AUTO || algorithm == BRUTE_FORCE ||
+              algorithm == KD_TREE);
+    algorithm_ = algorithm;
+    if (isTrained())
+        build_index();
+}
+
+bool KNNClassifier::uses_kd_tree() const
+{
+    return algorithm_ == KD_TREE ||
+           (algorithm_ == AUTO && samples_.cols <= KD_TREE_MAX_DIMS &&
+            samples_.rows >= KD_TREE_MIN_SAMPLES);
+}
+
+void KNNClassifier::build_index()
+{
+    if (uses_kd_tree())
+    {
+        if (tree_.empty())
+            tree_.build(samples_);
+    }
+    else
+        tree_.clear();
+}
+
+void KNNClassifier::keep_references(const std::vector<int> &rows)
+{
+    cv::Mat samples(int(rows.size()), samples_.cols, CV_32FC1);
+    cv::Mat labels(int(rows.size()), 1, CV_32SC1);
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        samples_.row(rows[i]).copyTo(samples.row(int(i)));
+        labels.at<int>(int(i)) = labels_.at<int>(rows[i]);
+    }
+    samples_ = samples;
+    labels_ = labels;
+}
+
+int KNNClassifier::reduce(int method, int param)
+{
+    CV_Assert(isTrained());
+    const int N = samples_.rows;
+    const int *labels = labels_.ptr<int>();
+    cv::RNG &rng = cv::theRNG();
+
+    if (method == CONDENSED)
+    {
+        std::vector<int> order(N);
+        for (int i = 0; i < N; ++i)
+            order[i] = i;
+        for (int i = 0; i < N; ++i)
+            std::swap(order[i], order[i + rng.uniform(0, N - i)]);
+
+        // The subset grows in place in S; it starts with a sample per class.
+        cv::Mat S(N, samples_.cols, CV_32FC1), S_norms(N, 1, CV_32FC1);
+        std::vector<int> subset;
+        std::vector<char> in_subset(N, 0);
+        std::map<int, int> seen;
+        for (int i : order)
+            if (seen.insert(std::make_pair(labels[i], i)).second)
+                subset.push_back(i);
+
+        bool changed = true;
+        size_t n_copied = 0;
+        cv::Mat idx, dists;
+        while (changed)
+        {
+            changed = false;
+            for (int b0 = 0; b0 < N; b0 += CONDENSE_BLOCK)
+            {
+                for (; n_copied < subset.size(); ++n_copied)
+                {
+                    const int r = subset[n_copied];
+                    in_subset[r] = 1;
+                    samples_.row(r).copyTo(S.row(int(n_copied)));
+                    S_norms.at<float>(int(n_copied)) = sq_norms_.at<float>(r);
+                }
+                std::vector<int> block;
+                for (int i = b0; i < std::min(N, b0 + CONDENSE_BLOCK); ++i)
+                    if (!in_subset[order[i]])
+                        block.push_back(order[i]);
+                if (block.empty())
+                    continue;
+                cv::Mat Q(int(block.size()), samples_.cols, CV_32FC1);
+                for (size_t i = 0; i < block.size(); ++i)
+                    samples_.row(block[i]).copyTo(Q.row(int(i)));
+                const int n = int(subset.size());
+                fsiv_knn_search(Q, S.rowRange(0, n), S_norms.rowRange(0, n), 1,
+                                idx, dists);
+                for (size_t i = 0; i < block.size(); ++i)
+                    if (labels[subset[idx.at<int>(int(i), 0)]] != labels[block[i]])
+                    {
+                        subset.push_back(block[i]);
+                        changed = true;
+                    }
+            }
+        }
+        std::sort(subset.begin(), subset.end());
+        keep_references(subset);
+    }
+    else if (method == EDITED)
+    {
+        const cv::Mat predictions = fsiv_knn_leave_one_out(
+            samples_, labels_, param > 0 ? param : 3);
+        std::vector<int> kept;
+        for (int i = 0; i < N; ++i)
+            if (predictions.at<int>(i) == labels[i])
+                kept.push_back(i);
+        if (kept.empty())
+            std::cerr << "Warning: editing would remove all the references, "
+                      << "so they are kept." << std::endl;
+        else
+            keep_references(kept);
+    }
+    else if (method == PROTOTYPES)
+    {
+        const int P = param > 0 ? param : 64;
+        std::map<int, std::vector<int>> members;
+        for (int i = 0; i < N; ++i)
+            members[labels[i]].push_back(i);
+        std::vector<int> classes;
+        std::vector<uint64> seeds;
+        for (const auto &m : members)
+        {
+            classes.push_back(m.first);
+            seeds.push_back(rng.next());
+        }
+
+        std::vector<cv::Mat> prototypes(classes.size());
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (int c = 0; c < int(classes.size()); ++c)
+        {
+            const std::vector<int> &m = members.at(classes[c]);
+            cv::Mat S(int(m.size()), samples_.cols, CV_32FC1);
+            for (size_t i = 0; i < m.size(); ++i)
+                samples_.row(m[i]).copyTo(S.row(int(i)));
+            if (S.rows <= P)
+                prototypes[c] = S;
+            else
+            {
+                cv::RNG local_rng(seeds[c]);
+                prototypes[c] = fsiv_minibatch_kmeans(
+                    S, P, std::min(2048, S.rows), 100, local_rng);
+            }
+        }
+
+        cv::Mat samples, labels_p;
+        for (size_t c = 0; c < classes.size(); ++c)
+        {
+            samples.push_back(prototypes[c]);
+            labels_p.push_back(cv::Mat(prototypes[c].rows, 1, CV_32SC1,
+                                       cv::Scalar(classes[c])));
+        }
+        samples_ = samples;
+        labels_ = labels_p;
+    }
+    else
+        CV_Assert(method == NO_REDUCTION);
+
+    sq_norms_ = fsiv_compute_sq_norms(samples_);
+    tree_.clear();
+    build_index();
+    return samples_.rows;
+}
+
+const cv::Mat &
+KNNClassifier::get_samples() const
+{
+    return samples_;
+}
+
+const cv::Mat &
+KNNClassifier::get_labels() const
+{
+    return labels_;
+}
+
+void KNNClassifier::find_nearest(const cv::Mat &X, int K, cv::Mat &idx,
+                                 cv::Mat &dists) const
+{
+    CV_Assert(isTrained());
+    CV_Assert(X.cols == samples_.cols);
+    cv::Mat Xf = X;
+    if (X.type() != CV_32FC1)
+        X.convertTo(Xf, CV_32F);
+    if (!tree_.empty())
+        tree_.knn_search(Xf, K, idx, dists);
+    else
+        fsiv_knn_search(Xf, samples_, sq_norms_, K, idx, dists);
+}
+
+int KNNClassifier::vote(const int *neighbours, int K) const
+{
+    return fsiv_knn_vote(labels_.ptr<int>(), neighbours, K);
+}
+
+int KNNClassifier::getVarCount() const
+{
+    return samples_.cols;
+}
+
+bool KNNClassifier::isTrained() const
+{
+    return !samples_.empty();
+}
+
+bool KNNClassifier::isClassifier() const
+{
+    return true;
+}
+
+bool KNNClassifier::train(const cv::Ptr<cv::ml::TrainData> &data, int)
+{
+    CV_Assert(data != nullptr);
+    return train(data->getTrainSamples(cv::ml::ROW_SAMPLE),
+                 cv::ml::ROW_SAMPLE, data->getTrainResponses());
+}
+
+bool KNNClassifier::train(cv::InputArray samples, int layout,
+                          cv::InputArray responses)
+{
+    CV_Assert(layout == cv::ml::ROW_SAMPLE);
+    const cv::Mat X = samples.getMat();
+    const cv::Mat y = responses.getMat();
+    CV_Assert(X.rows > 0 && X.channels() == 1);
+    CV_Assert(y.total() == size_t(X.rows) && y.channels() == 1);
+
+    // convertTo always copies, so the model owns its data.
+    X.convertTo(samples_, CV_32F);
+    y.reshape(1, X.rows).convertTo(labels_, CV_32S);
+    sq_norms_ = fsiv_compute_sq_norms(samples_);
+    tree_.clear();
+    build_index();
+    return true;
+}
+
+float KNNClassifier::predict(cv::InputArray samples, cv::OutputArray results,
+                             int) const
+{
+    CV_Assert(isTrained());
+    const cv::Mat X = samples.getMat();
+    cv::Mat idx, dists;
+    find_nearest(X, K_, idx, dists);
+
+    cv::Mat predictions(X.rows, 1, CV_32FC1);
+    for (int i = 0; i < X.rows; ++i)
+        predictions.at<float>(i) = float(vote(idx.ptr<int>(i), idx.cols));
+    if (results.needed())
+        predictions.copyTo(results);
+    return X.rows > 0 ? predictions.at<float>(0) : 0.0f;
+}
+
+void KNNClassifier::clear()
+{
+    samples_.release();
+    labels_.release();
+    sq_norms_.release();
+    tree_.clear();
+}
+
+void KNNClassifier::write(cv::FileStorage &fs) const
+{
+    writeFormat(fs);
+    fs << "K" << K_;
+    fs << "algorithm" << algorithm_;
+    fs << "samples" << samples_;
+    fs << "labels" << labels_;
+}
+
+void KNNClassifier::read(const cv::FileNode &fn)
+{
+    clear();
+    fn["K"] >> K_;
+    fn["algorithm"] >> algorithm_;
+    fn["samples"] >> samples_;
+    fn["labels"] >> labels_;
+    CV_Assert(K_ > 0);
+    CV_Assert(algorithm_ == AUTO || algorithm_ == BRUTE_FORCE ||
+              algorithm_ == KD_TREE);
+    CV_Assert(samples_.empty() || samples_.type() == CV_32FC1);
+    CV_Assert(labels_.rows == samples_.rows);
+    if (!samples_.empty())
+    {
+        sq_norms_ = fsiv_compute_sq_norms(samples_);
+        build_index();
+    }
+}
+
+cv::String KNNClassifier::getDefaultName() const
+{
+    return "fsiv_ml_knn";
+}
@@ -0,0 +1,211 @@
+/**
+ *  @file knn_classifier.hpp
+ */
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+#include "kdtree.hpp"
+
+/**
+ * @brief Vote a label given the neighbours of a sample.
+ *
+ * Neighbours must be sorted by distance: ties are broken in favour of the
+ * class with the nearest neighbour.
+ *
+ * @param labels are the labels of the references.
+ * @param neighbours are the reference indices sorted by distance.
+ * @param K is the number of neighbours to use.
+ * @return the most voted label.
+ * @pre K>0
+ */
+int fsiv_knn_vote(const int *labels, const int *neighbours, int K);
+
+/**
+ * @brief Vote a label weighting each neighbour by the inverse of its
+ * distance.
+ *
+ * @param labels are the labels of the references.
+ * @param neighbours are the reference indices sorted by distance.
+ * @param sq_dists are the squared distances of the neighbours.
+ * @param K is the number of neighbours to use.
+ * @return the label with the largest sum of weights.
+ * @pre K>0
+ */
+int fsiv_knn_weighted_vote(const int *labels, const int *neighbours,
+                           const float *sq_dists, int K);
+
+/**
+ * @brief Leave-one-out K-NN prediction of a training set.
+ *
+ * Each sample is classified by its K nearest other samples, found with
+ * fsiv_loo_knn_search(), giving an estimate of the generalization
+ * accuracy on the training set itself.
+ *
+ * @param X are the samples (one per row).
+ * @param y are their labels.
+ * @param K is the number of neighbours (clipped to X.rows-1).
+ * @return a X.rows x 1 CV_32SC1 matrix with the predicted labels.
+ * @pre X.rows>1 && K>0
+ * @pre y.total()==X.rows
+ */
+cv::Mat fsiv_knn_leave_one_out(const cv::Mat &X, const cv::Mat &y, int K);
+
+/**
+ * @brief Exact K-NN classifier.
+ *
+ * A multithreaded replacement of cv::ml::KNearest::BRUTE_FORCE. The
+ * neighbours are found with fsiv_knn_search() (cache blocked GEMM tiles
+ * processed in parallel over blocks of queries) and the predicted label is
+ * the most voted one among the K nearest references. For low dimensional
+ * features the references are indexed by a KD-tree instead.
+ * @see fsiv_knn_vote()
+ */
+class KNNClassifier : public cv::ml::StatModel
+{
+public:
+    /**
+     * @brief Search algorithms.
+     * AUTO uses a KD-tree when the features have at most
+     * KD_TREE_MAX_DIMS dimensions and there are at least
+     * KD_TREE_MIN_SAMPLES references, and brute force otherwise: with more
+     * dimensions the tree visits most leaves, and with few references the
+     * GEMM tiles are as cheap as the tree descent.
+     */
+    enum Algorithms
+    {
+        AUTO = 0,
+        BRUTE_FORCE = 1,
+        KD_TREE = 2
+    };
+    static const int KD_TREE_MAX_DIMS = 16;
+    static const int KD_TREE_MIN_SAMPLES = 1024;
+
+    /**
+     * @brief Reference set reduction methods. @see reduce().
+     */
+    enum Reductions
+    {
+        NO_REDUCTION = 0,
+        CONDENSED = 1, // Hart's condensed nearest neighbour.
+        EDITED = 2,    // Wilson's edited nearest neighbour.
+        PROTOTYPES = 3 // Per class k-means prototypes.
+    };
+
+    KNNClassifier();
+    virtual ~KNNClassifier();
+
+    /**
+     * @brief Create a classifier with K=1.
+     */
+    static cv::Ptr<KNNClassifier> create();
+
+    /**
+     * @brief Get the number of neighbours used to predict.
+     */
+    int get_K() const;
+
+    /**
+     * @brief Set the number of neighbours used to predict.
+     * @pre K>0
+     */
+    void set_K(int K);
+
+    /**
+     * @brief Get the search algorithm. @see Algorithms.
+     */
+    int get_algorithm() const;
+
+    /**
+     * @brief Set the search algorithm. @see Algorithms.
+     */
+    void set_algorithm(int algorithm);
+
+    /**
+     * @brief Does the trained model search with a KD-tree?
+     */
+    bool uses_kd_tree() const;
+
+    /**
+     * @brief Reduce the stored reference set.
+     *
+     * - CONDENSED keeps a subset that classifies all the references
+     *   correctly with 1-NN. References are tested by blocks against the
+     *   current subset in parallel, and the misclassified ones of each
+     *   block are added until a full pass adds none.
+     * - EDITED removes the references misclassified by their @a param
+     *   nearest neighbours (default 3), i.e. noise and class overlaps.
+     *   If all of them are misclassified the set is not changed.
+     * - PROTOTYPES replaces the references of each class by @a param
+     *   k-means centers (default 64). Classes are clustered in parallel.
+     *
+     * @param method is the reduction method. @see Reductions.
+     * @param param is the parameter of the method (<=0 means default).
+     * @return the number of references kept.
+     * @pre isTrained()
+     */
+    int reduce(int method, int param = 0);
+
+    /**
+     * @brief The stored reference samples (one per row).
+     */
+    const cv::Mat &get_samples() const;
+
+    /**
+     * @brief The labels of the reference samples (CV_32SC1 column).
+     */
+    const cv::Mat &get_labels() const;
+
+    /**
+     * @brief Find the K nearest references of each sample.
+     * @param X are the samples (one per row).
+     * @param K is the number of neighbours.
+     * @param[out] idx are the indices of the neighbours sorted by distance.
+     * @param[out] dists are their squared L2 distances.
+     * @see fsiv_knn_search()
+     */
+    void find_nearest(const cv::Mat &X, int K, cv::Mat &idx,
+                      cv::Mat &dists) const;
+
+    /**
+     * @brief Vote the label given the sorted neighbours of a sample.
+     * @param neighbours are the reference indices sorted by distance.
+     * @param K is the number of neighbours to use.
+     */
+    int vote(const int *neighbours, int K) const;
+
+    virtual int getVarCount() const override;
+    virtual bool isTrained() const override;
+    virtual bool isClassifier() const override;
+    virtual bool train(const cv::Ptr<cv::ml::TrainData> &data,
+                       int flags = 0) override;
+    virtual bool train(cv::InputArray samples, int layout,
+                       cv::InputArray responses) override;
+    virtual float predict(cv::InputArray samples,
+                          cv::OutputArray results = cv::noArray(),
+                          int flags = 0) const override;
+    virtual void clear() override;
+    virtual void write(cv::FileStorage &fs) const override;
+    virtual void read(const cv::FileNode &fn) override;
+    virtual cv::String getDefaultName() const override;
+
+protected:
+    /**
+     * @brief Build the KD-tree if the algorithm selects it.
+     */
+    void build_index();
+
+    /**
+     * @brief Keep only some references.
+     * @param rows are the rows of the references to keep.
+     */
+    void keep_references(const std::vector<int> &rows);
+
+    int K_;
+    int algorithm_;
+    cv::Mat samples_;  // CV_32FC1, one reference per row.
+    cv::Mat labels_;   // CV_32SC1 column.
+    cv::Mat sq_norms_; // Squared norms of the references.
+    KDTree tree_;      // Only built when uses_kd_tree().
+};
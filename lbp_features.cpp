@@ -0,0 +1,111 @@
+/**
+ *  @file lbp_features.cpp
+ */
+#include <vector>
+#include "fixed_size_features.hpp"
+#include "lbp_features.hpp"
+
+static std::string name_{"LBP Histogram Feature Extractor"};
+static std::string help_{
+    "  This extractor computes the LBP code (8 neighbours, radius 1) of each\n"
+    "  pixel and returns the normalized histogram of codes of each cell of a\n"
+    "  GxG grid (G*G*59 features if uniform codes are used, else G*G*256).\n"
+    "  Parameters: U:G\n"
+    "    U: if 1 use uniform LBP codes. Default 1.\n"
+    "    G: grid size. Default 2.\n"};
+
+static constexpr auto UNIFORM_MAP = fsiv_make_uniform_lbp_map();
+static_assert(UNIFORM_MAP[0] == 0 && UNIFORM_MAP[255] == 57 && UNIFORM_MAP[5] == 58,
+              "Wrong uniform LBP map.");
+
+const std::string &
+LBPFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+LBPFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+LBPFeatures::LBPFeatures()
+{
+    type_ = FSIV_LBP;
+    params_ = {1.0f, 2.0f};
+}
+
+LBPFeatures::~LBPFeatures() {}
+
+cv::Mat
+LBPFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    const bool uniform = params_[0] != 0.0f;
+    const int G = int(params_[1]);
+    const int bins = uniform ? 59 : 256;
+    const int H = img.rows - 2;
+    const int W = img.cols - 2;
+    CV_Assert(G > 0 && H >= G && W >= G);
+
+    cv::Mat features = cv::Mat::zeros(1, G * G * bins, CV_32FC1);
+    float *hist = features.ptr<float>();
+    if (FixedSampleExtractor::accepts(img) &&
+        FixedSampleExtractor::lbp(img, uniform, G, hist))
+        return features;
+
+    thread_local cv::Mat img8;
+    thread_local std::vector<uint8_t> codes;
+    const cv::Mat *src = &img;
+    if (img.depth() != CV_8U)
+    {
+        cv::normalize(img, img8, 0, 255, cv::NORM_MINMAX, CV_8U);
+        src = &img8;
+    }
+    codes.resize(W);
+
+    // Cell gy has the rows [gy*H/G, (gy+1)*H/G), as the columns.
+    int gy = 0;
+    for (int y = 0; y < H; ++y)
+    {
+        const uint8_t *r0 = src->ptr<uint8_t>(y);
+        const uint8_t *r1 = src->ptr<uint8_t>(y + 1);
+        const uint8_t *r2 = src->ptr<uint8_t>(y + 2);
+        uint8_t *code = codes.data();
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+        for (int x = 0; x < W; ++x)
+        {
+            const uint8_t c = r1[x + 1];
+            code[x] = uint8_t((r0[x] >= c) | ((r0[x + 1] >= c) << 1) |
+                              ((r0[x + 2] >= c) << 2) | ((r1[x + 2] >= c) << 3) |
+                              ((r2[x + 2] >= c) << 4) | ((r2[x + 1] >= c) << 5) |
+                              ((r2[x] >= c) << 6) | ((r1[x] >= c) << 7));
+        }
+        while ((gy + 1) * H / G <= y)
+            ++gy;
+        for (int gx = 0; gx < G; ++gx)
+        {
+            float *h = hist + (gy * G + gx) * bins;
+            const int x1 = (gx + 1) * W / G;
+            for (int x = gx * W / G; x < x1; ++x)
+                h[uniform ? UNIFORM_MAP[code[x]] : code[x]] += 1.0f;
+        }
+    }
+    for (int gy = 0; gy < G; ++gy)
+        for (int gx = 0; gx < G; ++gx)
+        {
+            const int n = ((gy + 1) * H / G - gy * H / G) * ((gx + 1) * W / G - gx * W / G);
+            float *h = hist + (gy * G + gx) * bins;
+            for (int b = 0; b < bins; ++b)
+                h[b] /= float(n);
+        }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
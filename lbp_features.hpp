@@ -0,0 +1,49 @@
+/**
+ *  @file lbp_features.hpp
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "features.hpp"
+
+/**
+ * @brief Build the uniform LBP mapping of the 8 bit codes.
+ *
+ * Codes with at most two 0/1 transitions (circularly) get their own bin
+ * (58 bins) and the rest share the last one (59 bins in total).
+ */
+constexpr std::array<uint8_t, 256>
+fsiv_make_uniform_lbp_map()
+{
+    std::array<uint8_t, 256> map{};
+    int next = 0;
+    for (int code = 0; code < 256; ++code)
+    {
+        int transitions = 0;
+        for (int b = 0; b < 8; ++b)
+            transitions += ((code >> b) & 1) != ((code >> ((b + 1) % 8)) & 1);
+        map[code] = uint8_t(transitions <= 2 ? next++ : 58);
+    }
+    return map;
+}
+
+/**
+ * @brief Local Binary Patterns histogram features extractor.
+ *
+ * Computes the 8 neighbour (radius 1) LBP code of every pixel and returns
+ * a normalized histogram of codes for each cell of a GxG grid.
+ */
+class LBPFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    LBPFeatures();
+    ~LBPFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+};
@@ -0,0 +1,205 @@
+/**
+ *  @file linear_svm_classifier.cpp
+ */
+#include <algorithm>
+#include <vector>
+#include "linear_svm_classifier.hpp"
+
+LinearSVMClassifier::LinearSVMClassifier() : C_(1.0) {}
+
+LinearSVMClassifier::~LinearSVMClassifier() {}
+
+cv::Ptr<LinearSVMClassifier>
+LinearSVMClassifier::create()
+{
+    return cv::makePtr<LinearSVMClassifier>();
+}
+
+double LinearSVMClassifier::get_C() const
+{
+    return C_;
+}
+
+void LinearSVMClassifier::set_C(double C)
+{
+    CV_Assert(C > 0.0);
+    C_ = C;
+}
+
+const cv::Mat &LinearSVMClassifier::get_weights() const
+{
+    return weights_;
+}
+
+void LinearSVMClassifier::fold(const cv::ml::SVM &svm)
+{
+    CV_Assert(svm.isTrained());
+    CV_Assert(svm.getType() == cv::ml::SVM::C_SVC &&
+              svm.getKernelType() == cv::ml::SVM::LINEAR);
+    clear();
+    C_ = svm.getC();
+
+    // cv::ml::SVM does not expose its class labels: read them back from
+    // its serialized form.
+    {
+        cv::FileStorage out(".yml", cv::FileStorage::WRITE |
+                                        cv::FileStorage::MEMORY);
+        out << "svm" << "{";
+        svm.write(out);
+        out << "}";
+        cv::FileStorage in(out.releaseAndGetString(),
+                           cv::FileStorage::READ | cv::FileStorage::MEMORY);
+        cv::Mat labels;
+        in["svm"]["class_labels"] >> labels;
+        CV_Assert(labels.total() > 1);
+        labels.reshape(1, int(labels.total())).convertTo(classes_, CV_32S);
+    }
+
+    // The decision functions are stored for the pairs (i, j), i<j, in
+    // row major order.
+    const int n = classes_.rows;
+    const int P = n * (n - 1) / 2;
+    const cv::Mat sv = svm.getSupportVectors();
+    CV_Assert(sv.type() == CV_32FC1);
+    weights_.create(P, sv.cols, CV_32FC1);
+    bias_.create(1, P, CV_32FC1);
+    cv::Mat alpha, svidx;
+    std::vector<double> w(sv.cols);
+    for (int p = 0; p < P; ++p)
+    {
+        const double rho = svm.getDecisionFunction(p, alpha, svidx);
+        CV_Assert(alpha.type() == CV_64FC1 && svidx.type() == CV_32SC1);
+        std::fill(w.begin(), w.end(), 0.0);
+        for (int k = 0; k < int(alpha.total()); ++k)
+        {
+            const double a = alpha.at<double>(k);
+            const float *s = sv.ptr<float>(svidx.at<int>(k));
+            for (int d = 0; d < sv.cols; ++d)
+                w[d] += a * s[d];
+        }
+        float *wp = weights_.ptr<float>(p);
+        for (int d = 0; d < sv.cols; ++d)
+            wp[d] = float(w[d]);
+        bias_.at<float>(p) = float(-rho);
+    }
+}
+
+void LinearSVMClassifier::decision_function(const cv::Mat &X,
+                                            cv::Mat &scores) const
+{
+    CV_Assert(isTrained());
+    CV_Assert(X.cols == weights_.cols && X.channels() == 1);
+    cv::Mat Xf = X;
+    if (X.type() != CV_32FC1)
+        X.convertTo(Xf, CV_32F);
+
+    cv::gemm(Xf, weights_, 1.0, cv::noArray(), 0.0, scores, cv::GEMM_2_T);
+    const float *b = bias_.ptr<float>();
+    for (int i = 0; i < scores.rows; ++i)
+    {
+        float *s = scores.ptr<float>(i);
+        for (int p = 0; p < scores.cols; ++p)
+            s[p] += b[p];
+    }
+}
+
+int LinearSVMClassifier::getVarCount() const
+{
+    return weights_.cols;
+}
+
+bool LinearSVMClassifier::isTrained() const
+{
+    return !weights_.empty();
+}
+
+bool LinearSVMClassifier::isClassifier() const
+{
+    return true;
+}
+
+bool LinearSVMClassifier::train(const cv::Ptr<cv::ml::TrainData> &data, int)
+{
+    CV_Assert(data != nullptr);
+    return train(data->getTrainSamples(cv::ml::ROW_SAMPLE),
+                 cv::ml::ROW_SAMPLE, data->getTrainResponses());
+}
+
+bool LinearSVMClassifier::train(cv::InputArray samples, int layout,
+                                cv::InputArray responses)
+{
+    cv::Ptr<cv::ml::SVM> svm = cv::ml::SVM::create();
+    svm->setType(cv::ml::SVM::C_SVC);
+    svm->setKernel(cv::ml::SVM::LINEAR);
+    svm->setC(C_);
+    if (!svm->train(samples, layout, responses))
+        return false;
+    fold(*svm);
+    return true;
+}
+
+float LinearSVMClassifier::predict(cv::InputArray samples,
+                                   cv::OutputArray results, int) const
+{
+    CV_Assert(isTrained());
+    const cv::Mat X = samples.getMat();
+    cv::Mat scores;
+    decision_function(X, scores);
+
+    const int n = classes_.rows;
+    cv::Mat predictions(X.rows, 1, CV_32FC1);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static) if (X.rows > 1)
+#endif
+    for (int i = 0; i < X.rows; ++i)
+    {
+        const float *s = scores.ptr<float>(i);
+        std::vector<int> votes(n, 0);
+        for (int a = 0, p = 0; a < n; ++a)
+            for (int b = a + 1; b < n; ++b, ++p)
+                ++votes[s[p] > 0.0f ? a : b];
+        int best = 0;
+        for (int c = 1; c < n; ++c)
+            if (votes[c] > votes[best])
+                best = c;
+        predictions.at<float>(i) = float(classes_.at<int>(best));
+    }
+    if (results.needed())
+        predictions.copyTo(results);
+    return X.rows > 0 ? predictions.at<float>(0) : 0.0f;
+}
+
+void LinearSVMClassifier::clear()
+{
+    weights_.release();
+    bias_.release();
+    classes_.release();
+}
+
+void LinearSVMClassifier::write(cv::FileStorage &fs) const
+{
+    writeFormat(fs);
+    fs << "C" << C_;
+    fs << "classes" << classes_;
+    fs << "weights" << weights_;
+    fs << "bias" << bias_;
+}
+
+void LinearSVMClassifier::read(const cv::FileNode &fn)
+{
+    clear();
+    fn["C"] >> C_;
+    fn["classes"] >> classes_;
+    fn["weights"] >> weights_;
+    fn["bias"] >> bias_;
+    CV_Assert(C_ > 0.0);
+    CV_Assert(classes_.type() == CV_32SC1 && classes_.rows > 1);
+    CV_Assert(weights_.type() == CV_32FC1 &&
+              weights_.rows == classes_.rows * (classes_.rows - 1) / 2);
+    CV_Assert(bias_.type() == CV_32FC1 && bias_.cols == weights_.rows);
+}
+
+cv::String LinearSVMClassifier::getDefaultName() const
+{
+    return "fsiv_ml_linear_svm";
+}
@@ -0,0 +1,82 @@
+/**
+ *  @file linear_svm_classifier.hpp
+ */
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+
+/**
+ * @brief Compact linear C-SVC.
+ *
+ * With a linear kernel the decision function of each one-vs-one pair of
+ * classes sum_k alpha_k <sv_k, x> - rho collapses to <w, x> + b with
+ * w = sum_k alpha_k sv_k. This model stores a weight vector and a bias per
+ * pair, P = n(n-1)/2 rows instead of the support vectors, and scores a
+ * batch of samples with a single GEMM (one GEMV per sample). The vote is
+ * the same as cv::ml::SVM: each pair votes its first class if the score
+ * is positive and the second one otherwise, ties go to the first class.
+ */
+class LinearSVMClassifier : public cv::ml::StatModel
+{
+public:
+    LinearSVMClassifier();
+    virtual ~LinearSVMClassifier();
+
+    /**
+     * @brief Create a classifier with C=1.
+     */
+    static cv::Ptr<LinearSVMClassifier> create();
+
+    /**
+     * @brief Get the regularization parameter used to train.
+     */
+    double get_C() const;
+
+    /**
+     * @brief Set the regularization parameter used to train.
+     * @pre C>0
+     */
+    void set_C(double C);
+
+    /**
+     * @brief Fold the support vectors of a trained linear C-SVC.
+     * @param svm is the trained SVM.
+     * @pre svm.isTrained()
+     * @pre svm.getType()==C_SVC && svm.getKernelType()==LINEAR
+     */
+    void fold(const cv::ml::SVM &svm);
+
+    /**
+     * @brief The weight vectors, one per pair of classes (CV_32FC1).
+     */
+    const cv::Mat &get_weights() const;
+
+    /**
+     * @brief Compute the decision value of every pair of classes.
+     * @param X are the samples (one per row).
+     * @param[out] scores is a X.rows x P CV_32FC1 matrix.
+     */
+    void decision_function(const cv::Mat &X, cv::Mat &scores) const;
+
+    virtual int getVarCount() const override;
+    virtual bool isTrained() const override;
+    virtual bool isClassifier() const override;
+    virtual bool train(const cv::Ptr<cv::ml::TrainData> &data,
+                       int flags = 0) override;
+    virtual bool train(cv::InputArray samples, int layout,
+                       cv::InputArray responses) override;
+    virtual float predict(cv::InputArray samples,
+                          cv::OutputArray results = cv::noArray(),
+                          int flags = 0) const override;
+    virtual void clear() override;
+    virtual void write(cv::FileStorage &fs) const override;
+    virtual void read(const cv::FileNode &fn) override;
+    virtual cv::String getDefaultName() const override;
+
+protected:
+    double C_;
+    cv::Mat weights_; // P x D CV_32FC1, one row per pair (i<j).
+    cv::Mat bias_;    // 1 x P CV_32FC1, -rho of each pair.
+    cv::Mat classes_; // n x 1 CV_32SC1, the class labels.
+};
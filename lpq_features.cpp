@@ -0,0 +1,237 @@
+/**
+ *  @file lpq_features.cpp
+ */
+#include <algorithm>
+#include <cmath>
+#include "lpq_features.hpp"
+
+static std::string name_{"LPQ Histogram Feature Extractor"};
+static std::string help_{
+    "  This extractor computes the Local Phase Quantization code of each\n"
+    "  pixel (signs of the STFT over a MxM window at the frequencies (a,0),\n"
+    "  (0,a), (a,a) and (a,-a) with a=1/M) and returns the normalized\n"
+    "  histogram of codes of each cell of a GxG grid (G*G*256 features).\n"
+    "  It is insensitive to (centrally symmetric) blur.\n"
+    "  Parameters: M:G:D\n"
+    "    M: window size (odd). Default 7.\n"
+    "    G: grid size. Default 1.\n"
+    "    D: if 1 decorrelate the coefficients (rho=0.9). Default 1.\n"};
+
+// Correlation coefficient between adjacent pixels for decorrelation.
+static const double RHO = 0.9;
+
+const std::string &
+LPQFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+LPQFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+LPQFeatures::LPQFeatures()
+{
+    type_ = FSIV_LPQ;
+    params_ = {7.0f, 1.0f, 1.0f};
+    build_filters();
+}
+
+LPQFeatures::~LPQFeatures() {}
+
+void LPQFeatures::build_filters()
+{
+    const int M = int(params_[0]);
+    const bool decorrelate = params_[2] != 0.0f;
+    CV_Assert(M >= 3 && M % 2 == 1);
+    const int r = M / 2;
+
+    // w1[k] = exp(-2*pi*i*a*(k-r)) with a = 1/M.
+    cos_.resize(M);
+    sin_.resize(M);
+    for (int k = 0; k < M; ++k)
+    {
+        const double phase = 2.0 * CV_PI * (k - r) / M;
+        cos_[k] = float(std::cos(phase));
+        sin_[k] = float(-std::sin(phase));
+    }
+
+    cv::Mat T = cv::Mat::eye(8, 8, CV_64FC1);
+    if (decorrelate)
+    {
+        // Rows: real and imaginary parts of the 2D filters of the four
+        // frequencies over the MxM window (in the order of the codes).
+        const int n = M * M;
+        cv::Mat F(8, n, CV_64FC1);
+        for (int y = 0; y < M; ++y)
+            for (int x = 0; x < M; ++x)
+            {
+                const double cx = cos_[x], sx = sin_[x], cy = cos_[y], sy = sin_[y];
+                const int p = y * M + x;
+                F.at<double>(0, p) = cx;
+                F.at<double>(1, p) = sx;
+                F.at<double>(2, p) = cy;
+                F.at<double>(3, p) = sy;
+                F.at<double>(4, p) = cy * cx - sy * sx;
+                F.at<double>(5, p) = cy * sx + sy * cx;
+                F.at<double>(6, p) = cy * cx + sy * sx;
+                F.at<double>(7, p) = cy * sx - sy * cx;
+            }
+        // Pixel covariance model rho^distance.
+        cv::Mat C(n, n, CV_64FC1);
+        for (int p = 0; p < n; ++p)
+            for (int q = 0; q < n; ++q)
+                C.at<double>(p, q) = std::pow(RHO, std::hypot(double(p % M - q % M),
+                                                               double(p / M - q / M)));
+        cv::Mat D = F * C * F.t();
+        // Slightly different scales avoid degenerated singular values.
+        for (int i = 0; i < 8; ++i)
+        {
+            const double s = 1.0 + (7 - i) * 1e-6;
+            cv::Mat row = D.row(i), col = D.col(i);
+            row *= s;
+            col *= s;
+        }
+        cv::Mat w, u, vt;
+        cv::SVD::compute(D, w, u, vt);
+        T = vt;
+    }
+    for (int i = 0; i < 64; ++i)
+        transform_[i] = float(T.at<double>(i / 8, i % 8));
+    filters_params_ = params_;
+}
+
+cv::Mat
+LPQFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    if (params_ != filters_params_)
+        build_filters();
+    const int M = int(params_[0]);
+    const int G = int(params_[1]);
+    const int H = img.rows - M + 1; // Valid STFT size.
+    const int W = img.cols - M + 1;
+    CV_Assert(G > 0 && H >= G && W >= G);
+
+    thread_local cv::Mat src;
+    thread_local std::vector<float> h0, h1r, h1i, rows;
+    thread_local std::vector<uint8_t> codes;
+    img.convertTo(src, CV_32F, img.depth() == CV_8U ? 1.0 / 255.0 : 1.0);
+    const float *wc = cos_.data();
+    const float *ws = sin_.data();
+
+    // Horizontal pass: filters w0 (box) and w1 (complex) on every row.
+    const size_t hsize = size_t(img.rows) * W;
+    h0.assign(hsize, 0.0f);
+    h1r.assign(hsize, 0.0f);
+    h1i.assign(hsize, 0.0f);
+    for (int y = 0; y < img.rows; ++y)
+    {
+        const float *in = src.ptr<float>(y);
+        float *o0 = &h0[size_t(y) * W];
+        float *o1 = &h1r[size_t(y) * W];
+        float *o2 = &h1i[size_t(y) * W];
+        for (int k = 0; k < M; ++k)
+        {
+            const float *s = in + k;
+            const float c = wc[k], sn = ws[k];
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int x = 0; x < W; ++x)
+            {
+                o0[x] += s[x];
+                o1[x] += c * s[x];
+                o2[x] += sn * s[x];
+            }
+        }
+    }
+
+    cv::Mat features = cv::Mat::zeros(1, G * G * 256, CV_32FC1);
+    float *hist = features.ptr<float>();
+    rows.resize(size_t(8) * W);
+    codes.resize(W);
+    float *f[8];
+    for (int i = 0; i < 8; ++i)
+        f[i] = &rows[size_t(i) * W];
+    // Cell gy has the rows [gy*H/G, (gy+1)*H/G), as the columns.
+    int gy = 0;
+    for (int y = 0; y < H; ++y)
+    {
+        // Vertical pass for one output row, across all the columns.
+        std::fill(rows.begin(), rows.end(), 0.0f);
+        for (int k = 0; k < M; ++k)
+        {
+            const float *a0 = &h0[size_t(y + k) * W];
+            const float *ar = &h1r[size_t(y + k) * W];
+            const float *ai = &h1i[size_t(y + k) * W];
+            const float c = wc[k], sn = ws[k];
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int x = 0; x < W; ++x)
+            {
+                f[0][x] += ar[x];                  // (a,0) real.
+                f[1][x] += ai[x];                  // (a,0) imag.
+                f[2][x] += c * a0[x];              // (0,a) real.
+                f[3][x] += sn * a0[x];             // (0,a) imag.
+                f[4][x] += c * ar[x] - sn * ai[x]; // (a,a) real.
+                f[5][x] += c * ai[x] + sn * ar[x]; // (a,a) imag.
+                f[6][x] += c * ar[x] + sn * ai[x]; // (a,-a) real.
+                f[7][x] += c * ai[x] - sn * ar[x]; // (a,-a) imag.
+            }
+        }
+
+        // Decorrelate and quantize the signs.
+        uint8_t *code = codes.data();
+        std::fill(codes.begin(), codes.end(), uint8_t(0));
+        for (int i = 0; i < 8; ++i)
+        {
+            const float *t = transform_ + 8 * i;
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int x = 0; x < W; ++x)
+            {
+                const float g = t[0] * f[0][x] + t[1] * f[1][x] + t[2] * f[2][x] +
+                                t[3] * f[3][x] + t[4] * f[4][x] + t[5] * f[5][x] +
+                                t[6] * f[6][x] + t[7] * f[7][x];
+                code[x] |= uint8_t((g > 0.0f) << i);
+            }
+        }
+
+        while ((gy + 1) * H / G <= y)
+            ++gy;
+        for (int gx = 0; gx < G; ++gx)
+        {
+            float *h = hist + (gy * G + gx) * 256;
+            const int x1 = (gx + 1) * W / G;
+            for (int x = gx * W / G; x < x1; ++x)
+                h[code[x]] += 1.0f;
+        }
+    }
+    for (int gy = 0; gy < G; ++gy)
+        for (int gx = 0; gx < G; ++gx)
+        {
+            const int n = ((gy + 1) * H / G - gy * H / G) * ((gx + 1) * W / G - gx * W / G);
+            float *h = hist + (gy * G + gx) * 256;
+            for (int b = 0; b < 256; ++b)
+                h[b] /= float(n);
+        }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+bool LPQFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    build_filters();
+    return true;
+}
@@ -0,0 +1,42 @@
+/**
+ *  @file lpq_features.hpp
+ */
+#pragma once
+
+#include <vector>
+#include "features.hpp"
+
+/**
+ * @brief Local Phase Quantization features extractor.
+ *
+ * Blur invariant texture descriptor: the signs of the real and imaginary
+ * parts of a local STFT (MxM window) at four low frequencies, optionally
+ * decorrelated, give an 8 bit code per pixel. A normalized histogram of
+ * codes is returned for each cell of a GxG grid.
+ * The STFT is computed with separable 1D complex filters.
+ */
+class LPQFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    LPQFeatures();
+    ~LPQFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual bool load_model(std::string const &fname) override;
+
+protected:
+    /**
+     * @brief Build the 1D filters and the decorrelation transform.
+     */
+    void build_filters();
+
+    std::vector<float> filters_params_;
+    std::vector<float> cos_; // Real part of the 1D filter.
+    std::vector<float> sin_; // Imaginary part of the 1D filter.
+    float transform_[64];    // 8x8 decorrelation (row major).
+};
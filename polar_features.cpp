@@ -0,0 +1,151 @@
+/**
+ *  @file polar_features.cpp
+ */
+#include <cmath>
+#include "polar_features.hpp"
+
+static std::string name_{"Polar Profile Feature Extractor"};
+static std::string help_{
+    "  This extractor unwraps the image around its center to R radii x A\n"
+    "  angles and returns the radial intensity profile (R features) plus,\n"
+    "  for each radius, the magnitudes of the angular DFT harmonics 1..H\n"
+    "  (R*H features), which are rotation invariant.\n"
+    "  Parameters: R:A:H\n"
+    "    R: num. of radii. Default 16.\n"
+    "    A: num. of angles. Default 32.\n"
+    "    H: num. of angular harmonics per radius (H<=A/2). Default 8.\n"};
+
+const std::string &
+PolarFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+PolarFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+PolarFeatures::PolarFeatures()
+{
+    type_ = FSIV_POLAR_PROFILE;
+    params_ = {16.0f, 32.0f, 8.0f};
+    build_table(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE), offsets_, weights_);
+}
+
+PolarFeatures::~PolarFeatures() {}
+
+void PolarFeatures::build_table(const cv::Size &size, std::vector<int> &offsets,
+                                std::vector<float> &weights) const
+{
+    const int R = int(params_[0]);
+    const int A = int(params_[1]);
+    CV_Assert(R > 0 && A > 1);
+    CV_Assert(size.width > 1 && size.height > 1);
+
+    const double cx = (size.width - 1) / 2.0;
+    const double cy = (size.height - 1) / 2.0;
+    const double r_max = std::min(cx, cy);
+    offsets.resize(size_t(R) * A * 4);
+    weights.resize(size_t(R) * A * 4);
+    for (int r = 0; r < R; ++r)
+    {
+        const double rho = (r + 0.5) * r_max / R;
+        for (int a = 0; a < A; ++a)
+        {
+            const double theta = 2.0 * CV_PI * a / A;
+            const double x = std::min(std::max(cx + rho * std::cos(theta), 0.0), size.width - 1.0);
+            const double y = std::min(std::max(cy + rho * std::sin(theta), 0.0), size.height - 1.0);
+            const int x0 = std::min(int(x), size.width - 2);
+            const int y0 = std::min(int(y), size.height - 2);
+            const float fx = float(x - x0);
+            const float fy = float(y - y0);
+            const size_t s = (size_t(r) * A + a) * 4;
+            offsets[s] = y0 * size.width + x0;
+            offsets[s + 1] = y0 * size.width + x0 + 1;
+            offsets[s + 2] = (y0 + 1) * size.width + x0;
+            offsets[s + 3] = (y0 + 1) * size.width + x0 + 1;
+            weights[s] = (1.0f - fx) * (1.0f - fy);
+            weights[s + 1] = fx * (1.0f - fy);
+            weights[s + 2] = (1.0f - fx) * fy;
+            weights[s + 3] = fx * fy;
+        }
+    }
+}
+
+cv::Mat
+PolarFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    const int R = int(params_[0]);
+    const int A = int(params_[1]);
+    const int H = int(params_[2]);
+    CV_Assert(H >= 0 && H <= A / 2);
+    const std::vector<int> *offsets = &offsets_;
+    const std::vector<float> *weights = &weights_;
+    if (img.size() != cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE))
+    {
+        thread_local std::vector<int> other_offsets;
+        thread_local std::vector<float> other_weights;
+        thread_local cv::Size other_size;
+        thread_local std::vector<float> other_params;
+        if (img.size() != other_size || params_ != other_params)
+        {
+            build_table(img.size(), other_offsets, other_weights);
+            other_size = img.size();
+            other_params = params_;
+        }
+        offsets = &other_offsets;
+        weights = &other_weights;
+    }
+
+    cv::Mat src;
+    img.convertTo(src, CV_32F, img.depth() == CV_8U ? 1.0 / 255.0 : 1.0);
+    const float *pixels = src.ptr<float>();
+
+    // Gather-only unwrap into per thread scratch.
+    thread_local cv::Mat polar, spectrum;
+    polar.create(R, A, CV_32FC1);
+    float *p = polar.ptr<float>();
+    const int *o = offsets->data();
+    const float *w = weights->data();
+    for (int s = 0; s < R * A; ++s, o += 4, w += 4)
+        p[s] = w[0] * pixels[o[0]] + w[1] * pixels[o[1]] +
+               w[2] * pixels[o[2]] + w[3] * pixels[o[3]];
+
+    cv::dft(polar, spectrum, cv::DFT_ROWS | cv::DFT_COMPLEX_OUTPUT);
+
+    cv::Mat features(1, R * (1 + H), CV_32FC1);
+    float *profile = features.ptr<float>();
+    float *harmonics = profile + R;
+    const float inv = 1.0f / float(A);
+    for (int r = 0; r < R; ++r)
+    {
+        const float *c = spectrum.ptr<float>(r);
+        // The DC term is the mean intensity of the ring.
+        profile[r] = c[0] * inv;
+        for (int h = 1; h <= H; ++h)
+            harmonics[r * H + h - 1] = std::sqrt(c[2 * h] * c[2 * h] + c[2 * h + 1] * c[2 * h + 1]) * inv;
+    }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+bool PolarFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    build_table(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE), offsets_, weights_);
+    return true;
+}
+
+void PolarFeatures::set_params(const std::vector<float> &params)
+{
+    FeaturesExtractor::set_params(params);
+    build_table(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE), offsets_, weights_);
+}
@@ -0,0 +1,49 @@
+/**
+ *  @file polar_features.hpp
+ */
+#pragma once
+
+#include <vector>
+#include "features.hpp"
+
+/**
+ * @brief Radial/polar profile extractor.
+ *
+ * The image is unwrapped around its center to a R radii x A angles polar
+ * image using a sampling table (pixel offsets and bilinear weights) built
+ * for the sample size when the parameters are set or the model is loaded
+ * (other sizes use a table built per thread), so the unwrap is a
+ * gather-only loop. The features
+ * are the radial intensity profile and, for each radius, the magnitudes of
+ * the first harmonics of the angular DFT, which are rotation invariant.
+ */
+class PolarFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    PolarFeatures();
+    ~PolarFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual bool load_model(std::string const &fname) override;
+    virtual void set_params(const std::vector<float> &params) override;
+
+protected:
+    /**
+     * @brief Build the polar sampling table for an image size.
+     * @param size is the image size.
+     * @param offsets are the output pixel offsets.
+     * @param weights are the output bilinear weights.
+     */
+    void build_table(const cv::Size &size, std::vector<int> &offsets,
+                     std::vector<float> &weights) const;
+
+    // Per polar sample: offsets of the 4 neighbour pixels in a continuous
+    // image and their bilinear weights.
+    std::vector<int> offsets_;
+    std::vector<float> weights_;
+};
@@ -0,0 +1,208 @@
+/**
+ *  @file random_conv_features.cpp
+ */
+#include <cmath>
+#include "convnet.hpp"
+#include "random_conv_features.hpp"
+
+static std::string name_{"Random Convolutional Feature Extractor"};
+static std::string help_{
+    "  This extractor runs a fixed convolutional network with seeded random\n"
+    "  filters: conv KxK (F1 filters) + ReLU + 2x2 max pooling, an optional\n"
+    "  conv 3x3 (F2 filters) + ReLU, and average pooling of each map over a\n"
+    "  GxG grid (F2*G*G features, or F1*G*G if F2 is 0).\n"
+    "  Parameters: S:F1:K:F2:G\n"
+    "    S: random seed of the filters. Default 1.\n"
+    "    F1: num. of filters of the first layer. Default 16.\n"
+    "    K: kernel size of the first layer (odd). Default 5.\n"
+    "    F2: num. of filters of the second layer (0 means no second\n"
+    "        layer). Default 32.\n"
+    "    G: pooling grid size. Default 4.\n"};
+
+// Images processed by each GEMM. Chunks run in parallel.
+static const int CHUNK_SIZE = 8;
+static const int K2 = 3;
+
+const std::string &
+RandomConvFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+RandomConvFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+RandomConvFeatures::RandomConvFeatures()
+{
+    type_ = FSIV_RANDOM_CONV;
+    params_ = {1.0f, 16.0f, 5.0f, 32.0f, 4.0f};
+    build_filters();
+}
+
+RandomConvFeatures::~RandomConvFeatures() {}
+
+/**
+ * @brief Fill n filters of size len with zero-mean unit-norm gaussian noise.
+ */
+static void
+random_filters(cv::RNG &rng, int n, int len, std::vector<float> &w)
+{
+    w.resize(size_t(n) * len);
+    for (int f = 0; f < n; ++f)
+    {
+        float *filter = &w[size_t(f) * len];
+        double mean = 0.0;
+        for (int i = 0; i < len; ++i)
+        {
+            filter[i] = float(rng.gaussian(1.0));
+            mean += filter[i];
+        }
+        mean /= len;
+        double norm = 0.0;
+        for (int i = 0; i < len; ++i)
+        {
+            filter[i] -= float(mean);
+            norm += filter[i] * filter[i];
+        }
+        const float inv = float(1.0 / (std::sqrt(norm) + 1e-12));
+        for (int i = 0; i < len; ++i)
+            filter[i] *= inv;
+    }
+}
+
+void RandomConvFeatures::build_filters()
+{
+    const int F1 = int(params_[1]);
+    const int K1 = int(params_[2]);
+    const int F2 = int(params_[3]);
+    CV_Assert(F1 > 0 && K1 > 0 && K1 % 2 == 1 && F2 >= 0 && int(params_[4]) > 0);
+    cv::RNG rng(static_cast<uint64>(params_[0]));
+    random_filters(rng, F1, K1 * K1, w1_);
+    random_filters(rng, F2, F1 * K2 * K2, w2_);
+    filters_params_ = params_;
+}
+
+cv::Mat
+RandomConvFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    cv::Mat features = extract_features_batch(std::vector<cv::Mat>{img});
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+cv::Mat
+RandomConvFeatures::extract_features_batch(const std::vector<cv::Mat> &imgs)
+{
+    CV_Assert(imgs.size() > 0);
+    const cv::Size size = imgs[0].size();
+    for (auto &img : imgs)
+    {
+        CV_Assert(img.channels() == 1);
+        if (img.size() != size)
+            return FeaturesExtractor::extract_features_batch(imgs);
+    }
+    if (params_ != filters_params_)
+        build_filters();
+    const int F1 = int(params_[1]);
+    const int K1 = int(params_[2]);
+    const int F2 = int(params_[3]);
+    const int G = int(params_[4]);
+    const int H = size.height;
+    const int W = size.width;
+    CV_Assert(H >= 2 * G && W >= 2 * G);
+    const int HW = H * W;
+    const int H2 = H / 2;
+    const int W2 = W / 2;
+    const int HW2 = H2 * W2;
+    const int F_out = F2 > 0 ? F2 : F1;
+
+    const int n = int(imgs.size());
+    cv::Mat features(n, F_out * G * G, CV_32FC1);
+    const int n_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+#ifdef USE_OPENMP
+#pragma omp parallel if (n_chunks > 1)
+#endif
+    {
+        // Per thread buffers, reused for all its chunks.
+        std::vector<float> input(size_t(CHUNK_SIZE) * HW);
+        std::vector<float> cols1(size_t(K1) * K1 * CHUNK_SIZE * HW);
+        std::vector<float> maps1(size_t(F1) * CHUNK_SIZE * HW);
+        std::vector<float> pooled(size_t(CHUNK_SIZE) * F1 * HW2);
+        std::vector<float> cols2(F2 > 0 ? size_t(F1) * K2 * K2 * CHUNK_SIZE * HW2 : 0);
+        std::vector<float> maps2(size_t(F2) * CHUNK_SIZE * HW2);
+
+#ifdef USE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (int chunk = 0; chunk < n_chunks; ++chunk)
+        {
+            const int i0 = chunk * CHUNK_SIZE;
+            const int nb = std::min(CHUNK_SIZE, n - i0);
+
+            // Standardize each image (zero mean, unit variance).
+            for (int b = 0; b < nb; ++b)
+            {
+                cv::Mat dst(H, W, CV_32FC1, &input[size_t(b) * HW]);
+                imgs[i0 + b].convertTo(dst, CV_32F);
+                cv::Scalar mean, stddev;
+                cv::meanStdDev(dst, mean, stddev);
+                dst.convertTo(dst, CV_32F, 1.0 / (stddev[0] + 1e-6), -mean[0] / (stddev[0] + 1e-6));
+            }
+
+            // Layer 1: the images of the chunk are side by side in the
+            // columns of a single (F1 x K1*K1) x (K1*K1 x nb*HW) product.
+            const size_t ld1 = size_t(nb) * HW;
+            for (int b = 0; b < nb; ++b)
+                fsiv_im2col(&input[size_t(b) * HW], HW, 1, H, W, K1, K1 / 2,
+                            &cols1[size_t(b) * HW], ld1);
+            fsiv_sgemm(F1, int(ld1), K1 * K1, w1_.data(), K1 * K1,
+                       cols1.data(), ld1, maps1.data(), ld1);
+            fsiv_bias_relu(maps1.data(), ld1, F1, int(ld1), nullptr);
+            for (int b = 0; b < nb; ++b)
+                fsiv_maxpool2(&maps1[size_t(b) * HW], ld1, F1, H, W,
+                              &pooled[size_t(b) * F1 * HW2]);
+
+            if (F2 > 0)
+            {
+                // Layer 2: 3x3 conv over the F1 pooled maps.
+                const size_t ld2 = size_t(nb) * HW2;
+                for (int b = 0; b < nb; ++b)
+                    fsiv_im2col(&pooled[size_t(b) * F1 * HW2], HW2, F1, H2, W2,
+                                K2, K2 / 2, &cols2[size_t(b) * HW2], ld2);
+                fsiv_sgemm(F2, int(ld2), F1 * K2 * K2, w2_.data(), F1 * K2 * K2,
+                           cols2.data(), ld2, maps2.data(), ld2);
+                fsiv_bias_relu(maps2.data(), ld2, F2, int(ld2), nullptr);
+                for (int b = 0; b < nb; ++b)
+                    fsiv_grid_avgpool(&maps2[size_t(b) * HW2], ld2, F2, H2, W2, G,
+                                      features.ptr<float>(i0 + b));
+            }
+            else
+            {
+                for (int b = 0; b < nb; ++b)
+                    fsiv_grid_avgpool(&pooled[size_t(b) * F1 * HW2], HW2, F1, H2, W2, G,
+                                      features.ptr<float>(i0 + b));
+            }
+        }
+    }
+
+    CV_Assert(features.rows == n);
+    CV_Assert(features.type() == CV_32FC1);
+    return features;
+}
+
+bool RandomConvFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    build_filters();
+    return true;
+}
@@ -0,0 +1,43 @@
+/**
+ *  @file random_conv_features.hpp
+ */
+#pragma once
+
+#include <vector>
+#include "features.hpp"
+
+/**
+ * @brief Random convolutional features extractor.
+ *
+ * A fixed (untrained) convolutional network: a bank of seeded random
+ * zero-mean filters, ReLU and 2x2 max pooling, an optional second random
+ * 3x3 convolution with ReLU, and average pooling of each map over a GxG
+ * grid. Batches of images run through the im2col + blocked GEMM engine of
+ * convnet.hpp. The filters are generated from the seed, so only the
+ * parameters are saved in the model.
+ */
+class RandomConvFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    RandomConvFeatures();
+    ~RandomConvFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual cv::Mat extract_features_batch(const std::vector<cv::Mat> &imgs) override;
+    virtual bool load_model(std::string const &fname) override;
+
+protected:
+    /**
+     * @brief Generate the filters from the seed and the architecture.
+     */
+    void build_filters();
+
+    std::vector<float> filters_params_;
+    std::vector<float> w1_; // F1 x (K1*K1)
+    std::vector<float> w2_; // F2 x (F1*3*3)
+};
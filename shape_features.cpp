@@ -0,0 +1,146 @@
+/**
+ *  @file shape_features.cpp
+ */
+#include <cmath>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include "shape_features.hpp"
+
+static std::string name_{"Grain Shape Feature Extractor"};
+static std::string help_{
+    "  This extractor segments the grain as the largest connected component\n"
+    "  of a thresholded image (the polarity is chosen so the image border is\n"
+    "  background) and returns shape features of its outer contour: area,\n"
+    "  perimeter, circularity, convexity, solidity, the 7 Hu moments (log\n"
+    "  scaled) and F Fourier descriptors (5+7+F features).\n"
+    "  Parameters: T:F\n"
+    "    T: threshold: 0 Otsu, 1 adaptive (mean). Default 0.\n"
+    "    F: num. of Fourier descriptors. Default 10.\n"};
+
+// Num. of contour points used for the Fourier descriptors.
+static const int CONTOUR_SAMPLES = 64;
+
+const std::string &
+ShapeFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+ShapeFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+ShapeFeatures::ShapeFeatures()
+{
+    type_ = FSIV_SHAPE;
+    params_ = {0.0f, 10.0f};
+}
+
+ShapeFeatures::~ShapeFeatures() {}
+
+/**
+ * @brief Per thread buffers reused between images.
+ */
+struct ShapeBuffers
+{
+    cv::Mat img8, mask, labels, stats, centroids, grain;
+    std::vector<std::vector<cv::Point>> contours;
+    std::vector<cv::Point> hull;
+    cv::Mat z, spectrum;
+};
+
+cv::Mat
+ShapeFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    const bool adaptive = params_[0] != 0.0f;
+    const int F = int(params_[1]);
+    CV_Assert(F >= 0 && F <= CONTOUR_SAMPLES - 2);
+    thread_local ShapeBuffers b;
+
+    cv::Mat features = cv::Mat::zeros(1, 5 + 7 + F, CV_32FC1);
+    float *f = features.ptr<float>();
+
+    const cv::Mat *src = &img;
+    if (img.depth() != CV_8U)
+    {
+        cv::normalize(img, b.img8, 0, 255, cv::NORM_MINMAX, CV_8U);
+        src = &b.img8;
+    }
+    if (adaptive)
+        cv::adaptiveThreshold(*src, b.mask, 255, cv::ADAPTIVE_THRESH_MEAN_C,
+                              cv::THRESH_BINARY, (std::min(src->rows, src->cols) / 4) | 1, 0);
+    else
+        cv::threshold(*src, b.mask, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+    // The grain should not touch most of the border.
+    const double border = cv::sum(b.mask.row(0))[0] + cv::sum(b.mask.row(b.mask.rows - 1))[0] +
+                          cv::sum(b.mask.col(0))[0] + cv::sum(b.mask.col(b.mask.cols - 1))[0];
+    if (border > 255.0 * (b.mask.rows + b.mask.cols))
+        cv::bitwise_not(b.mask, b.mask);
+
+    const int n_labels = cv::connectedComponentsWithStats(b.mask, b.labels, b.stats,
+                                                          b.centroids, 8, CV_32S);
+    int best = 0;
+    for (int l = 1; l < n_labels; ++l)
+        if (best == 0 || b.stats.at<int>(l, cv::CC_STAT_AREA) > b.stats.at<int>(best, cv::CC_STAT_AREA))
+            best = l;
+    if (best == 0)
+        return features; // No grain found.
+    cv::compare(b.labels, best, b.grain, cv::CMP_EQ);
+
+    cv::findContours(b.grain, b.contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+    if (b.contours.empty())
+        return features;
+    size_t c = 0;
+    for (size_t i = 1; i < b.contours.size(); ++i)
+        if (b.contours[i].size() > b.contours[c].size())
+            c = i;
+    const std::vector<cv::Point> &contour = b.contours[c];
+
+    const double img_area = double(img.rows) * img.cols;
+    const double area = b.stats.at<int>(best, cv::CC_STAT_AREA);
+    const double perimeter = std::max(cv::arcLength(contour, true), 1.0);
+    cv::convexHull(contour, b.hull);
+    const double hull_perimeter = cv::arcLength(b.hull, true);
+    const double hull_area = std::max(cv::contourArea(b.hull), 1.0);
+    f[0] = float(area / img_area);
+    f[1] = float(perimeter / (2.0 * (img.rows + img.cols)));
+    f[2] = float(std::min(4.0 * CV_PI * area / (perimeter * perimeter), 1.0));
+    f[3] = float(std::min(hull_perimeter / perimeter, 1.0));
+    f[4] = float(std::min(area / hull_area, 1.0));
+
+    double hu[7];
+    cv::HuMoments(cv::moments(b.grain, true), hu);
+    for (int i = 0; i < 7; ++i)
+        f[5 + i] = hu[i] == 0.0 ? 0.0f : float(-std::copysign(1.0, hu[i]) * std::log10(std::abs(hu[i])));
+
+    if (F > 0)
+    {
+        // Fourier descriptors |Z_k|/|Z_1|, k=2..F+1, of the contour as a
+        // complex signal: invariant to translation, scale, rotation and
+        // starting point.
+        b.z.create(1, CONTOUR_SAMPLES, CV_32FC2);
+        cv::Vec2f *z = b.z.ptr<cv::Vec2f>();
+        for (int i = 0; i < CONTOUR_SAMPLES; ++i)
+        {
+            const cv::Point &p = contour[size_t(i) * contour.size() / CONTOUR_SAMPLES];
+            z[i] = cv::Vec2f(float(p.x), float(p.y));
+        }
+        cv::dft(b.z, b.spectrum);
+        const cv::Vec2f *Z = b.spectrum.ptr<cv::Vec2f>();
+        const float z1 = std::max(std::hypot(Z[1][0], Z[1][1]),
+                                  std::hypot(Z[CONTOUR_SAMPLES - 1][0], Z[CONTOUR_SAMPLES - 1][1]));
+        if (z1 > 0.0f)
+            for (int k = 0; k < F; ++k)
+                f[12 + k] = std::hypot(Z[k + 2][0], Z[k + 2][1]) / z1;
+    }
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
@@ -0,0 +1,27 @@
+/**
+ *  @file shape_features.hpp
+ */
+#pragma once
+
+#include "features.hpp"
+
+/**
+ * @brief Grain shape features extractor.
+ *
+ * Segments the grain (largest connected component of an Otsu or adaptive
+ * threshold) and describes the shape of its contour: area, perimeter,
+ * circularity, convexity, solidity, Hu moments and Fourier descriptors.
+ */
+class ShapeFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    ShapeFeatures();
+    ~ShapeFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+};
@@ -0,0 +1,720 @@
+/**
+ *  @file smo_svm.cpp
+ */
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#include "smo_svm.hpp"
+
+// Kernel rows shorter than this (samples x dims) are not parallelized.
+static const int PARALLEL_ROW_SIZE = 1 << 16;
+// Iterations between two shrinking passes (or fewer for small problems).
+static const int SHRINKING_PERIOD = 1000;
+// Second order coefficient used when the kernel is not positive definite.
+static const double TAU = 1e-12;
+
+namespace
+{
+
+struct KernelParams
+{
+    int type;
+    double gamma;
+    double coef0;
+    double degree;
+};
+
+/**
+ * @brief A LRU cache of full kernel rows K(x_i, .) of a subproblem.
+ */
+class KernelCache
+{
+public:
+    KernelCache(const cv::Mat &X, const std::vector<float> &sq_norms,
+                const KernelParams &params, size_t bytes)
+        : X_(X), sq_norms_(sq_norms), params_(params), used_(0)
+    {
+        const size_t l = size_t(X.rows);
+        capacity_ = int(std::min(l, std::max<size_t>(2, bytes / (l * sizeof(float)))));
+        data_.resize(size_t(capacity_) * l);
+        slot_.assign(X.rows, -1);
+        owner_.assign(capacity_, -1);
+        position_.resize(capacity_);
+    }
+
+    /**
+     * @brief Kernel value from a dot product and the squared norms.
+     */
+    float kernel(double dot, double ni, double nj) const
+    {
+        switch (params_.type)
+        {
+        case cv::ml::SVM::POLY:
+            return float(std::pow(params_.gamma * dot + params_.coef0,
+                                  params_.degree));
+        case cv::ml::SVM::RBF:
+            return float(std::exp(-params_.gamma *
+                                  std::max(0.0, ni + nj - 2.0 * dot)));
+        case cv::ml::SVM::SIGMOID:
+            return float(std::tanh(params_.gamma * dot + params_.coef0));
+        default:
+            return float(dot);
+        }
+    }
+
+    /**
+     * @brief Get the row of sample i. It stays valid until two more rows
+     * are requested.
+     */
+    const float *row(int i)
+    {
+        int s = slot_[i];
+        if (s >= 0)
+        {
+            lru_.splice(lru_.begin(), lru_, position_[s]);
+            return data_.data() + size_t(s) * X_.rows;
+        }
+        if (used_ < capacity_)
+        {
+            s = used_++;
+            lru_.push_front(s);
+        }
+        else
+        {
+            s = lru_.back();
+            slot_[owner_[s]] = -1;
+            lru_.splice(lru_.begin(), lru_, std::prev(lru_.end()));
+        }
+        position_[s] = lru_.begin();
+        owner_[s] = i;
+        slot_[i] = s;
+        float *out = data_.data() + size_t(s) * X_.rows;
+        compute(i, out);
+        return out;
+    }
+
+protected:
+    void compute(int i, float *out) const
+    {
+        const float *xi = X_.ptr<float>(i);
+        const int l = X_.rows;
+        const int D = X_.cols;
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static) if (size_t(l) * D > size_t(PARALLEL_ROW_SIZE))
+#endif
+        for (int j = 0; j < l; ++j)
+        {
+            const float *xj = X_.ptr<float>(j);
+            float dot = 0.0f;
+#ifdef USE_OPENMP
+#pragma omp simd reduction(+ : dot)
+#endif
+            for (int k = 0; k < D; ++k)
+                dot += xi[k] * xj[k];
+            out[j] = kernel(dot, sq_norms_[i], sq_norms_[j]);
+        }
+    }
+
+    const cv::Mat &X_;
+    const std::vector<float> &sq_norms_;
+    KernelParams params_;
+    int capacity_;                              // Num. of cached rows.
+    int used_;                                  // Num. of slots in use.
+    std::vector<float> data_;                   // capacity_ x l rows.
+    std::vector<int> slot_;                     // Slot of each row or -1.
+    std::vector<int> owner_;                    // Row of each slot.
+    std::list<int> lru_;                        // Slots, most recent first.
+    std::vector<std::list<int>::iterator> position_; // Of each slot in lru_.
+};
+
+/**
+ * @brief The dual C-SVC problem of a pair of classes:
+ *   min 1/2 a'Qa - e'a  s.t.  y'a = 0, 0 <= a_i <= C_i
+ * with Q_ij = y_i y_j K(x_i, x_j).
+ */
+class SMOSolver
+{
+public:
+    SMOSolver(const cv::Mat &X, const std::vector<signed char> &y,
+              double Cp, double Cn, double eps, int max_iter,
+              const KernelParams &params, size_t cache_bytes)
+        : l_(X.rows), y_(y), Cp_(Cp), Cn_(Cn), eps_(eps), max_iter_(max_iter),
+          reached_max_iter_(false), sq_norms_(X.rows), cache_(X, sq_norms_, params, cache_bytes)
+    {
+        QD_.resize(l_);
+        for (int i = 0; i < l_; ++i)
+        {
+            const float *x = X.ptr<float>(i);
+            double n = 0.0;
+            for (int k = 0; k < X.cols; ++k)
+                n += double(x[k]) * x[k];
+            sq_norms_[i] = float(n);
+            QD_[i] = cache_.kernel(n, n, n);
+        }
+    }
+
+    /**
+     * @brief Solve the problem.
+     * @param[out] alpha are the coefficients a_i * y_i.
+     * @return rho, the decision function is sum_i alpha_i K(x_i, x) - rho.
+     */
+    double solve(std::vector<double> &alpha);
+
+    /**
+     * @brief Did solve() stop at the iteration limit before converging?
+     */
+    bool reached_max_iter() const { return reached_max_iter_; }
+
+protected:
+    double C(int i) const { return y_[i] > 0 ? Cp_ : Cn_; }
+    bool is_upper_bound(int i) const { return alpha_[i] >= C(i); }
+    bool is_lower_bound(int i) const { return alpha_[i] <= 0.0; }
+    bool is_free(int i) const { return !is_upper_bound(i) && !is_lower_bound(i); }
+
+    bool select_working_set(int &out_i, int &out_j);
+    bool be_shrunk(int i, double Gmax1, double Gmax2) const;
+    void do_shrinking();
+    void reconstruct_gradient();
+    double calculate_rho() const;
+
+    const int l_;
+    const std::vector<signed char> &y_;
+    const double Cp_, Cn_, eps_;
+    const int max_iter_;
+    bool reached_max_iter_;
+    std::vector<float> sq_norms_;
+    KernelCache cache_;
+    std::vector<float> QD_;       // K(x_i, x_i).
+    std::vector<double> alpha_;
+    std::vector<double> G_;       // Gradient of the objective.
+    std::vector<double> G_bar_;   // Gradient part of the upper bounded.
+    std::vector<int> active_;     // Active (not shrunk) variables.
+    std::vector<char> is_active_;
+    bool unshrink_;
+};
+
+bool SMOSolver::select_working_set(int &out_i, int &out_j)
+{
+    // i = argmax { -y_t G_t : t in I_up }
+    double Gmax = -std::numeric_limits<double>::infinity();
+    int Gmax_idx = -1;
+    for (int t : active_)
+    {
+        if (y_[t] > 0)
+        {
+            if (!is_upper_bound(t) && -G_[t] >= Gmax)
+            {
+                Gmax = -G_[t];
+                Gmax_idx = t;
+            }
+        }
+        else if (!is_lower_bound(t) && G_[t] >= Gmax)
+        {
+            Gmax = G_[t];
+            Gmax_idx = t;
+        }
+    }
+    if (Gmax_idx < 0)
+        return true;
+
+    // j minimizes the second order decrease of the objective among the
+    // t in I_low with -y_t G_t < Gmax.
+    const int i = Gmax_idx;
+    const float *K_i = cache_.row(i);
+    double Gmax2 = -std::numeric_limits<double>::infinity();
+    double obj_diff_min = std::numeric_limits<double>::infinity();
+    int Gmin_idx = -1;
+    for (int j : active_)
+    {
+        double grad_diff;
+        if (y_[j] > 0)
+        {
+            if (is_lower_bound(j))
+                continue;
+            grad_diff = Gmax + G_[j];
+            Gmax2 = std::max(Gmax2, G_[j]);
+        }
+        else
+        {
+            if (is_upper_bound(j))
+                continue;
+            grad_diff = Gmax - G_[j];
+            Gmax2 = std::max(Gmax2, -G_[j]);
+        }
+        if (grad_diff > 0.0)
+        {
+            double quad_coef = QD_[i] + QD_[j] - 2.0 * K_i[j];
+            if (quad_coef <= 0.0)
+                quad_coef = TAU;
+            const double obj_diff = -(grad_diff * grad_diff) / quad_coef;
+            if (obj_diff <= obj_diff_min)
+            {
+                Gmin_idx = j;
+                obj_diff_min = obj_diff;
+            }
+        }
+    }
+    if (Gmax + Gmax2 < eps_ || Gmin_idx < 0)
+        return true;
+    out_i = Gmax_idx;
+    out_j = Gmin_idx;
+    return false;
+}
+
+bool SMOSolver::be_shrunk(int i, double Gmax1, double Gmax2) const
+{
+    if (is_upper_bound(i))
+        return y_[i] > 0 ? -G_[i] > Gmax1 : -G_[i] > Gmax2;
+    if (is_lower_bound(i))
+        return y_[i] > 0 ? G_[i] > Gmax2 : G_[i] > Gmax1;
+    return false;
+}
+
+void SMOSolver::do_shrinking()
+{
+    // Gmax1 = max { -y_i G_i : i in I_up }, Gmax2 = max { y_i G_i : i in I_low }
+    double Gmax1 = -std::numeric_limits<double>::infinity();
+    double Gmax2 = -std::numeric_limits<double>::infinity();
+    for (int i : active_)
+    {
+        if (y_[i] > 0)
+        {
+            if (!is_upper_bound(i))
+                Gmax1 = std::max(Gmax1, -G_[i]);
+            if (!is_lower_bound(i))
+                Gmax2 = std::max(Gmax2, G_[i]);
+        }
+        else
+        {
+            if (!is_upper_bound(i))
+                Gmax2 = std::max(Gmax2, -G_[i]);
+            if (!is_lower_bound(i))
+                Gmax1 = std::max(Gmax1, G_[i]);
+        }
+    }
+
+    // Close to the solution, check once every variable again.
+    if (!unshrink_ && Gmax1 + Gmax2 <= eps_ * 10.0)
+    {
+        unshrink_ = true;
+        reconstruct_gradient();
+        active_.resize(l_);
+        for (int i = 0; i < l_; ++i)
+            active_[i] = i;
+        std::fill(is_active_.begin(), is_active_.end(), 1);
+    }
+
+    size_t n = 0;
+    for (int i : active_)
+    {
+        if (be_shrunk(i, Gmax1, Gmax2))
+            is_active_[i] = 0;
+        else
+            active_[n++] = i;
+    }
+    active_.resize(n);
+}
+
+void SMOSolver::reconstruct_gradient()
+{
+    if (int(active_.size()) == l_)
+        return;
+    std::vector<int> inactive;
+    for (int k = 0; k < l_; ++k)
+        if (!is_active_[k])
+        {
+            G_[k] = G_bar_[k] - 1.0;
+            inactive.push_back(k);
+        }
+    for (int j = 0; j < l_; ++j)
+    {
+        if (!is_free(j))
+            continue;
+        const float *K_j = cache_.row(j);
+        const double a = alpha_[j] * y_[j];
+        for (int k : inactive)
+            G_[k] += a * y_[k] * K_j[k];
+    }
+}
+
+double SMOSolver::calculate_rho() const
+{
+    double ub = std::numeric_limits<double>::infinity();
+    double lb = -std::numeric_limits<double>::infinity();
+    double sum_free = 0.0;
+    int nr_free = 0;
+    for (int i = 0; i < l_; ++i)
+    {
+        const double yG = y_[i] * G_[i];
+        if (is_upper_bound(i))
+        {
+            if (y_[i] < 0)
+                ub = std::min(ub, yG);
+            else
+                lb = std::max(lb, yG);
+        }
+        else if (is_lower_bound(i))
+        {
+            if (y_[i] > 0)
+                ub = std::min(ub, yG);
+            else
+                lb = std::max(lb, yG);
+        }
+        else
+        {
+            ++nr_free;
+            sum_free += yG;
+        }
+    }
+    return nr_free > 0 ? sum_free / nr_free : (ub + lb) / 2.0;
+}
+
+double SMOSolver::solve(std::vector<double> &alpha)
+{
+    alpha_.assign(l_, 0.0);
+    G_.assign(l_, -1.0);
+    G_bar_.assign(l_, 0.0);
+    active_.resize(l_);
+    for (int i = 0; i < l_; ++i)
+        active_[i] = i;
+    is_active_.assign(l_, 1);
+    unshrink_ = false;
+
+    reached_max_iter_ = true;
+    int counter = std::min(l_, SHRINKING_PERIOD) + 1;
+    for (int iter = 0; iter < max_iter_; ++iter)
+    {
+        if (--counter == 0)
+        {
+            counter = std::min(l_, SHRINKING_PERIOD);
+            do_shrinking();
+        }
+
+        int i = -1, j = -1;
+        if (select_working_set(i, j))
+        {
+            // Optimal on the active set: check all the variables.
+            reconstruct_gradient();
+            const bool all_active = int(active_.size()) == l_;
+            active_.resize(l_);
+            for (int k = 0; k < l_; ++k)
+                active_[k] = k;
+            std::fill(is_active_.begin(), is_active_.end(), 1);
+            if (all_active || select_working_set(i, j))
+            {
+                reached_max_iter_ = false;
+                break;
+            }
+            counter = 1; // shrink again on the next iteration.
+        }
+
+        // Both rows stay valid as the cache keeps at least two.
+        const float *K_i = cache_.row(i);
+        const float *K_j = cache_.row(j);
+        const double C_i = C(i), C_j = C(j);
+        const double old_alpha_i = alpha_[i], old_alpha_j = alpha_[j];
+        double quad_coef = QD_[i] + QD_[j] - 2.0 * K_i[j];
+        if (quad_coef <= 0.0)
+            quad_coef = TAU;
+
+        if (y_[i] != y_[j])
+        {
+            const double delta = (-G_[i] - G_[j]) / quad_coef;
+            const double diff = alpha_[i] - alpha_[j];
+            alpha_[i] += delta;
+            alpha_[j] += delta;
+            if (diff > 0.0)
+            {
+                if (alpha_[j] < 0.0)
+                {
+                    alpha_[j] = 0.0;
+                    alpha_[i] = diff;
+                }
+            }
+            else if (alpha_[i] < 0.0)
+            {
+                alpha_[i] = 0.0;
+                alpha_[j] = -diff;
+            }
+            if (diff > C_i - C_j)
+            {
+                if (alpha_[i] > C_i)
+                {
+                    alpha_[i] = C_i;
+                    alpha_[j] = C_i - diff;
+                }
+            }
+            else if (alpha_[j] > C_j)
+            {
+                alpha_[j] = C_j;
+                alpha_[i] = C_j + diff;
+            }
+        }
+        else
+        {
+            const double delta = (G_[i] - G_[j]) / quad_coef;
+            const double sum = alpha_[i] + alpha_[j];
+            alpha_[i] -= delta;
+            alpha_[j] += delta;
+            if (sum > C_i)
+            {
+                if (alpha_[i] > C_i)
+                {
+                    alpha_[i] = C_i;
+                    alpha_[j] = sum - C_i;
+                }
+            }
+            else if (alpha_[j] < 0.0)
+            {
+                alpha_[j] = 0.0;
+                alpha_[i] = sum;
+            }
+            if (sum > C_j)
+            {
+                if (alpha_[j] > C_j)
+                {
+                    alpha_[j] = C_j;
+                    alpha_[i] = sum - C_j;
+                }
+            }
+            else if (alpha_[i] < 0.0)
+            {
+                alpha_[i] = 0.0;
+                alpha_[j] = sum;
+            }
+        }
+
+        // Update the gradient of the active variables.
+        const double dA_i = (alpha_[i] - old_alpha_i) * y_[i];
+        const double dA_j = (alpha_[j] - old_alpha_j) * y_[j];
+        for (int k : active_)
+            G_[k] += y_[k] * (K_i[k] * dA_i + K_j[k] * dA_j);
+
+        // Keep G_bar up to date for the variables that change bound.
+        const bool ui = old_alpha_i >= C_i, uj = old_alpha_j >= C_j;
+        if (ui != is_upper_bound(i))
+        {
+            const double c = (ui ? -C_i : C_i) * y_[i];
+            for (int k = 0; k < l_; ++k)
+                G_bar_[k] += c * y_[k] * K_i[k];
+        }
+        if (uj != is_upper_bound(j))
+        {
+            const double c = (uj ? -C_j : C_j) * y_[j];
+            for (int k = 0; k < l_; ++k)
+                G_bar_[k] += c * y_[k] * K_j[k];
+        }
+    }
+
+    reconstruct_gradient();
+    alpha.resize(l_);
+    for (int i = 0; i < l_; ++i)
+        alpha[i] = alpha_[i] * y_[i];
+    return calculate_rho();
+}
+
+} // namespace
+
+bool fsiv_smo_supports(const cv::ml::SVM &svm)
+{
+    const int kernel = svm.getKernelType();
+    return svm.getType() == cv::ml::SVM::C_SVC &&
+           (kernel == cv::ml::SVM::LINEAR || kernel == cv::ml::SVM::POLY ||
+            kernel == cv::ml::SVM::RBF || kernel == cv::ml::SVM::SIGMOID);
+}
+
+void fsiv_train_smo_svm(cv::ml::SVM &svm, const cv::Mat &X, const cv::Mat &y,
+                        int cache_mb)
+{
+    CV_Assert(fsiv_smo_supports(svm));
+    CV_Assert(X.rows > 1 && X.channels() == 1);
+    CV_Assert(y.total() == size_t(X.rows) && cache_mb > 0);
+
+    cv::Mat Xf, labels;
+    X.convertTo(Xf, CV_32F);
+    y.reshape(1, X.rows).convertTo(labels, CV_32S);
+
+    // Classes sorted by label, as cv::ml::SVM does.
+    std::map<int, std::vector<int>> members;
+    for (int i = 0; i < X.rows; ++i)
+        members[labels.at<int>(i)].push_back(i);
+    CV_Assert(members.size() > 1);
+    std::vector<int> classes;
+    std::vector<const std::vector<int> *> rows;
+    for (const auto &m : members)
+    {
+        classes.push_back(m.first);
+        rows.push_back(&m.second);
+    }
+    const int n = int(classes.size());
+
+    const cv::Mat weights = svm.getClassWeights();
+    CV_Assert(weights.empty() || weights.total() == size_t(n));
+    cv::Mat class_C(n, 1, CV_64FC1, cv::Scalar(svm.getC()));
+    if (!weights.empty())
+    {
+        cv::Mat w;
+        weights.reshape(1, n).convertTo(w, CV_64F);
+        class_C = class_C.mul(w);
+    }
+
+    // As cv::ml::SVM, with LIBSVM's defaults for the criteria not set.
+    const cv::TermCriteria criteria = svm.getTermCriteria();
+    const double eps = (criteria.type & cv::TermCriteria::EPS) && criteria.epsilon > 0.0
+                           ? criteria.epsilon
+                           : 1e-3;
+    const int max_iter = (criteria.type & cv::TermCriteria::COUNT) && criteria.maxCount > 0
+                             ? criteria.maxCount
+                             : std::max(10000000, X.rows > INT_MAX / 100 ? INT_MAX : 100 * X.rows);
+    KernelParams params;
+    params.type = svm.getKernelType();
+    params.gamma = svm.getGamma();
+    params.coef0 = svm.getCoef0();
+    params.degree = svm.getDegree();
+
+    // The pairs (a, b), a<b, in OpenCV's order, solved largest first.
+    std::vector<std::pair<int, int>> pairs;
+    for (int a = 0; a < n; ++a)
+        for (int b = a + 1; b < n; ++b)
+            pairs.push_back(std::make_pair(a, b));
+    const int P = int(pairs.size());
+    std::vector<int> order(P);
+    for (int p = 0; p < P; ++p)
+        order[p] = p;
+    std::sort(order.begin(), order.end(), [&](int p, int q)
+              { return rows[pairs[p].first]->size() + rows[pairs[p].second]->size() >
+                       rows[pairs[q].first]->size() + rows[pairs[q].second]->size(); });
+
+    int n_threads = 1;
+#ifdef USE_OPENMP
+    n_threads = std::max(1, std::min(P, omp_get_max_threads()));
+#endif
+    const size_t cache_bytes = (size_t(cache_mb) << 20) / n_threads;
+
+    std::vector<double> rho(P);
+    std::vector<char> reached_max_iter(P, 0);
+    std::vector<std::vector<int>> sv_rows(P);
+    std::vector<std::vector<double>> sv_alpha(P);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+#endif
+    for (int o = 0; o < P; ++o)
+    {
+        const int p = order[o];
+        const std::vector<int> &pos = *rows[pairs[p].first];
+        const std::vector<int> &neg = *rows[pairs[p].second];
+        const int l = int(pos.size() + neg.size());
+        cv::Mat Xp(l, Xf.cols, CV_32FC1);
+        std::vector<signed char> yp(l);
+        std::vector<int> index(l);
+        for (int i = 0; i < l; ++i)
+        {
+            const bool is_pos = i < int(pos.size());
+            index[i] = is_pos ? pos[i] : neg[i - pos.size()];
+            yp[i] = is_pos ? 1 : -1;
+            Xf.row(index[i]).copyTo(Xp.row(i));
+        }
+
+        SMOSolver solver(Xp, yp, class_C.at<double>(pairs[p].first),
+                         class_C.at<double>(pairs[p].second), eps, max_iter,
+                         params, cache_bytes);
+        std::vector<double> alpha;
+        rho[p] = solver.solve(alpha);
+        reached_max_iter[p] = solver.reached_max_iter();
+        for (int i = 0; i < l; ++i)
+            if (alpha[i] != 0.0)
+            {
+                sv_rows[p].push_back(index[i]);
+                sv_alpha[p].push_back(alpha[i]);
+            }
+    }
+
+    const int n_stopped = int(std::count(reached_max_iter.begin(),
+                                         reached_max_iter.end(), 1));
+    if (n_stopped > 0)
+        std::cerr << "Warning: SMO reached the limit of " << max_iter
+                  << " iterations before converging in " << n_stopped << " of "
+                  << P << " pairs of classes. Raise the iterations of the SVM "
+                  << "term criteria (or its epsilon)." << std::endl;
+
+    // Number the support vectors shared by all the pairs.
+    std::vector<int> sv_of(X.rows, -1);
+    std::vector<int> sv_index;
+    for (int p = 0; p < P; ++p)
+        for (int &r : sv_rows[p])
+        {
+            if (sv_of[r] < 0)
+            {
+                sv_of[r] = int(sv_index.size());
+                sv_index.push_back(r);
+            }
+            r = sv_of[r];
+        }
+
+    // Load the model with cv::ml::SVM's own reader.
+    static const char *kernel_names[] = {"LINEAR", "POLY", "RBF", "SIGMOID"};
+    cv::FileStorage out(".yml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+    out << "svm" << "{";
+    out << "format" << 3;
+    out << "svmType" << "C_SVC";
+    out << "kernel" << "{" << "type" << kernel_names[params.type];
+    if (params.type == cv::ml::SVM::POLY)
+        out << "degree" << params.degree;
+    if (params.type != cv::ml::SVM::LINEAR)
+        out << "gamma" << params.gamma;
+    if (params.type == cv::ml::SVM::POLY || params.type == cv::ml::SVM::SIGMOID)
+        out << "coef0" << params.coef0;
+    out << "}";
+    out << "C" << svm.getC();
+    out << "term_criteria" << "{:";
+    if (criteria.type & cv::TermCriteria::EPS)
+        out << "epsilon" << criteria.epsilon;
+    if (criteria.type & cv::TermCriteria::COUNT)
+        out << "iterations" << criteria.maxCount;
+    out << "}";
+    out << "var_count" << Xf.cols;
+    out << "class_count" << n;
+    out << "class_labels" << cv::Mat(classes, true);
+    if (!weights.empty())
+        out << "class_weights" << weights;
+    out << "sv_total" << int(sv_index.size());
+    out << "support_vectors" << "[";
+    for (int r : sv_index)
+    {
+        out << "[:";
+        out.writeRaw("f", Xf.ptr(r), Xf.cols * Xf.elemSize());
+        out << "]";
+    }
+    out << "]";
+    out << "decision_functions" << "[";
+    for (int p = 0; p < P; ++p)
+    {
+        const int sv_count = int(sv_rows[p].size());
+        out << "{" << "sv_count" << sv_count << "rho" << rho[p];
+        out << "alpha" << "[:";
+        out.writeRaw("d", sv_alpha[p].data(), sv_count * sizeof(double));
+        out << "]";
+        out << "index" << "[:";
+        out.writeRaw("i", sv_rows[p].data(), sv_count * sizeof(int));
+        out << "]";
+        out << "}";
+    }
+    out << "]";
+    out << "}";
+
+    cv::FileStorage in(out.releaseAndGetString(),
+                       cv::FileStorage::READ | cv::FileStorage::MEMORY);
+    svm.read(in["svm"]);
+    CV_Assert(svm.isTrained());
+}
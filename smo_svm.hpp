@@ -0,0 +1,42 @@
+/**
+ *  @file smo_svm.hpp
+ */
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+
+/**
+ * @brief Can fsiv_train_smo_svm() train this SVM?
+ *
+ * Only C_SVC with the LINEAR, POLY, RBF or SIGMOID kernels is supported.
+ */
+bool fsiv_smo_supports(const cv::ml::SVM &svm);
+
+/**
+ * @brief Train a C-SVC with a native multithreaded SMO solver.
+ *
+ * A replacement of cv::ml::SVM::train(). Each one-vs-one pair of classes
+ * is solved with SMO using second order working set selection and the
+ * shrinking heuristic of LIBSVM (Fan, Chen & Lin, 2005). Kernel rows are
+ * kept in a LRU cache and computed with SIMD dot products. The pairs are
+ * solved concurrently, largest first; when there is a single pair the
+ * kernel rows are computed in parallel instead.
+ *
+ * The solution is loaded into @a svm in OpenCV's own model format, so it
+ * is predicted, saved and loaded as any cv::ml::SVM. As cv::ml::SVM, the
+ * SVM term criteria give the stopping tolerance (EPS) and the maximum
+ * iterations of each pair (COUNT); when not set, LIBSVM's defaults are
+ * used (1e-3 and max(10^7, 100 samples)). A warning is printed if a pair
+ * stops at the iteration limit.
+ *
+ * @param svm is the SVM to train, with its parameters already set.
+ * @param X are the samples (one per row).
+ * @param y are the labels.
+ * @param cache_mb is the total size of the kernel caches in megabytes.
+ * @pre fsiv_smo_supports(svm)
+ * @pre y.total()==X.rows and there are at least two classes.
+ * @post svm.isTrained()
+ */
+void fsiv_train_smo_svm(cv::ml::SVM &svm, const cv::Mat &X, const cv::Mat &y,
+                        int cache_mb = 1024);
@@ -0,0 +1,653 @@
+/**
+ *  @file test_native_code.cpp
+ *
+ *  Tests of the native classifiers and search kernels.
+ *
+ *  Usage: test_native_code <test_name>
+ *  Each test builds a small random problem, compares the native code with
+ *  a reference result and returns EXIT_SUCCESS if they match.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/ml.hpp>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "common_code.hpp"
+#include "distances.hpp"
+
+/**
+ * @brief Random samples with small integer coordinates (many ties).
+ */
+cv::Mat random_samples(int rows, int cols, int levels, cv::RNG &rng)
+{
+  cv::Mat Xi(rows, cols, CV_32SC1), X;
+  rng.fill(Xi, cv::RNG::UNIFORM, 0, levels);
+  Xi.convertTo(X, CV_32F);
+  return X;
+}
+
+/**
+ * @brief Labels of the samples: the quadrant of their two first components.
+ */
+cv::Mat quadrant_labels(const cv::Mat &X, int levels)
+{
+  cv::Mat y(X.rows, 1, CV_32SC1);
+  for (int i = 0; i < X.rows; ++i)
+    y.at<int>(i) = 2 * (X.at<float>(i, 0) * 2 >= levels) +
+                   (X.at<float>(i, 1) * 2 >= levels);
+  return y;
+}
+
+/**
+ * @brief Gaussian clusters, one per class, in random positions.
+ * @param[out] y are the labels (0..classes-1), CV_32SC1.
+ */
+cv::Mat gaussian_clusters(int rows, int cols, int classes, cv::RNG &rng,
+                          cv::Mat &y)
+{
+  cv::RNG centers_rng(0xC1A55E5);
+  cv::Mat centers(classes, cols, CV_32FC1);
+  centers_rng.fill(centers, cv::RNG::UNIFORM, -2.0f, 2.0f);
+  cv::Mat X(rows, cols, CV_32FC1);
+  rng.fill(X, cv::RNG::NORMAL, 0.0f, 1.0f);
+  y.create(rows, 1, CV_32SC1);
+  for (int i = 0; i < rows; ++i)
+  {
+    y.at<int>(i) = i % classes;
+    cv::Mat row = X.row(i);
+    row += centers.row(i % classes);
+  }
+  return X;
+}
+
+/**
+ * @brief Check that two matrices are equal.
+ */
+bool same(const cv::Mat &a, const cv::Mat &b, const std::string &what)
+{
+  if (a.size() != b.size() || a.type() != b.type() ||
+      cv::norm(a, b, cv::NORM_INF) != 0.0)
+  {
+    std::cerr << "Error: " << what << " differ." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief KNNClassifier keeps its parameters, references and predictions
+ * after a save/load round trip, with both search algorithms.
+ */
+bool test_knn_classifier_save_load()
+{
+  cv::RNG rng(0x1234);
+  const std::string fname = cv::tempfile(".yml");
+  bool ok = true;
+  for (int algorithm : {int(KNNClassifier::BRUTE_FORCE), int(KNNClassifier::KD_TREE)})
+  {
+    const cv::Mat X = random_samples(600, 8, 16, rng);
+    const cv::Mat y = quadrant_labels(X, 16);
+    const cv::Mat Q = random_samples(200, 8, 16, rng);
+
+    cv::Ptr<cv::ml::StatModel> clf = fsiv_create_native_knn_classifier(5, algorithm);
+    fsiv_train_classifier(clf, X, y);
+    const cv::Mat expected = fsiv_predict_labels(clf, Q);
+    fsiv_save_classifier_model(clf, fname);
+
+    cv::Ptr<cv::ml::StatModel> loaded = fsiv_load_classifier_model(fname);
+    const KNNClassifier *knn = dynamic_cast<KNNClassifier *>(loaded.get());
+    if (!knn)
+    {
+      std::cerr << "Error: the model was not loaded as a KNNClassifier." << std::endl;
+      ok = false;
+      break;
+    }
+    if (knn->get_K() != 5 || knn->get_algorithm() != algorithm ||
+        knn->uses_kd_tree() != (algorithm == KNNClassifier::KD_TREE))
+    {
+      std::cerr << "Error: the loaded parameters differ." << std::endl;
+      ok = false;
+    }
+    const KNNClassifier *trained = dynamic_cast<KNNClassifier *>(clf.get());
+    ok = same(knn->get_samples(), trained->get_samples(), "references") && ok;
+    ok = same(knn->get_labels(), trained->get_labels(), "labels") && ok;
+    ok = same(fsiv_predict_labels(loaded, Q), expected, "predictions") && ok;
+  }
+  std::remove(fname.c_str());
+  return ok;
+}
+
+/**
+ * @brief HNSWClassifier built concurrently (with OpenMP) finds at least 95%
+ * of the exact nearest neighbours, every reference finds itself, and a
+ * save/load round trip keeps its neighbours and predictions.
+ */
+bool test_hnsw_recall()
+{
+#ifdef USE_OPENMP
+  // Several threads even on small machines, so insertions race.
+  omp_set_num_threads(std::max(4, omp_get_max_threads()));
+#endif
+  cv::RNG rng(0x4242);
+  const std::string fname = cv::tempfile(".yml");
+  bool ok = true;
+  cv::Mat X(3000, 16, CV_32FC1), y(X.rows, 1, CV_32SC1), Q(300, 16, CV_32FC1);
+  rng.fill(X, cv::RNG::UNIFORM, 0.0f, 1.0f);
+  rng.fill(Q, cv::RNG::UNIFORM, 0.0f, 1.0f);
+  for (int i = 0; i < X.rows; ++i)
+    y.at<int>(i) = X.at<float>(i, 0) >= 0.5f;
+  // Queries equal to references.
+  X.rowRange(0, 100).copyTo(Q.rowRange(0, 100));
+
+  cv::Ptr<cv::ml::StatModel> clf = fsiv_create_hnsw_classifier(5, 16, 200, 100);
+  fsiv_train_classifier(clf, X, y);
+  const HNSWClassifier *hnsw = dynamic_cast<HNSWClassifier *>(clf.get());
+
+  const int K = 10;
+  cv::Mat idx, dists, gt_idx, gt_dists;
+  hnsw->find_nearest(Q, K, idx, dists);
+  fsiv_knn_search(Q, X, fsiv_compute_sq_norms(X), K, gt_idx, gt_dists);
+  int found = 0, self = 0;
+  for (int i = 0; i < Q.rows; ++i)
+  {
+    const int *ix = idx.ptr<int>(i);
+    for (int k = 0; k < K; ++k)
+      found += std::find(ix, ix + K, gt_idx.at<int>(i, k)) != ix + K;
+    self += i < 100 && dists.at<float>(i, 0) == 0.0f;
+  }
+  const double recall = double(found) / (Q.rows * K);
+  if (recall < 0.95 || self != 100)
+  {
+    std::cerr << "Error: recall " << recall << " and " << self
+              << " of 100 references found themselves." << std::endl;
+    ok = false;
+  }
+
+  const cv::Mat expected = fsiv_predict_labels(clf, Q);
+  fsiv_save_classifier_model(clf, fname);
+  cv::Ptr<cv::ml::StatModel> loaded = fsiv_load_classifier_model(fname);
+  std::remove(fname.c_str());
+  const HNSWClassifier *l_hnsw = dynamic_cast<HNSWClassifier *>(loaded.get());
+  if (!l_hnsw)
+  {
+    std::cerr << "Error: the model was not loaded as a HNSWClassifier." << std::endl;
+    return false;
+  }
+  if (l_hnsw->get_K() != 5 || l_hnsw->get_M() != 16 ||
+      l_hnsw->get_ef_construction() != 200 || l_hnsw->get_ef_search() != 100)
+  {
+    std::cerr << "Error: the loaded parameters differ." << std::endl;
+    ok = false;
+  }
+  cv::Mat l_idx, l_dists;
+  l_hnsw->find_nearest(Q, K, l_idx, l_dists);
+  ok = same(l_idx, idx, "neighbours") && ok;
+  ok = same(l_dists, dists, "distances") && ok;
+  ok = same(fsiv_predict_labels(loaded, Q), expected, "predictions") && ok;
+  return ok;
+}
+
+/**
+ * @brief IVFPQClassifier with its padding exposed.
+ */
+class IVFPQProbe : public IVFPQClassifier
+{
+public:
+  using IVFPQClassifier::pad;
+};
+
+/**
+ * @brief IVFPQClassifier pads the samples with zeros, its asymmetric
+ * distances are the distances to the decoded references, it keeps the
+ * configured sizes when it clamps them and a save/load round trip keeps
+ * its predictions.
+ */
+bool test_ivfpq()
+{
+  struct Config
+  {
+    int rows, lists, code_size;
+  };
+  cv::RNG rng(0x4343);
+  const std::string fname = cv::tempfile(".yml");
+  const int dims = 10;
+  bool ok = true;
+  // Subvectors of 3 (padded to 12 columns), and sizes clamped to the data.
+  for (const Config &c : {Config{1000, 8, 4}, Config{200, 500, 32}})
+  {
+    cv::Mat y, y_q;
+    const cv::Mat X = gaussian_clusters(c.rows, dims, 4, rng, y);
+    const cv::Mat Q = gaussian_clusters(100, dims, 4, rng, y_q);
+    cv::Ptr<IVFPQProbe> ivfpq = cv::makePtr<IVFPQProbe>();
+    ivfpq->set_K(5);
+    ivfpq->set_lists(c.lists);
+    ivfpq->set_code_size(c.code_size);
+    ivfpq->set_probes(c.lists);
+    cv::Ptr<cv::ml::StatModel> clf = ivfpq;
+    fsiv_train_classifier(clf, X, y);
+    if (ivfpq->get_lists() != c.lists || ivfpq->get_code_size() != c.code_size)
+    {
+      std::cerr << "Error: the configured sizes changed." << std::endl;
+      ok = false;
+    }
+
+    const int m = std::min(c.code_size, dims);
+    const int cols = m * ((dims + m - 1) / m);
+    const cv::Mat Qp = ivfpq->pad(Q);
+    if (Qp.type() != CV_32FC1 || Qp.rows != Q.rows || Qp.cols != cols ||
+        cv::norm(Qp.colRange(0, dims), Q, cv::NORM_INF) != 0.0 ||
+        (cols > dims && cv::norm(Qp.colRange(dims, cols), cv::NORM_INF) != 0.0))
+    {
+      std::cerr << "Error: wrong padding." << std::endl;
+      ok = false;
+    }
+
+    // All the lists are probed, so the nearest decoded references must be
+    // found with their exact distances.
+    const cv::Mat R = ivfpq->reconstruct();
+    const int K = 20;
+    cv::Mat idx, dists, gt_idx, gt_dists;
+    ivfpq->find_nearest(Q, K, idx, dists);
+    fsiv_knn_search(Qp, R, fsiv_compute_sq_norms(R), K, gt_idx, gt_dists);
+    int wrong = 0;
+    for (int i = 0; i < Q.rows; ++i)
+      for (int k = 0; k < K; ++k)
+      {
+        const float *q = Qp.ptr<float>(i);
+        const float *r = R.ptr<float>(idx.at<int>(i, k));
+        double d = 0.0;
+        for (int j = 0; j < cols; ++j)
+          d += (double(q[j]) - r[j]) * (double(q[j]) - r[j]);
+        const double tol = 1e-3 * (1.0 + d);
+        wrong += std::abs(dists.at<float>(i, k) - d) > tol ||
+                 std::abs(gt_dists.at<float>(i, k) - d) > tol;
+      }
+    if (wrong > 0)
+    {
+      std::cerr << "Error: " << wrong << " asymmetric distances differ from "
+                << "the distances to the decoded references." << std::endl;
+      ok = false;
+    }
+
+    const cv::Mat expected = fsiv_predict_labels(clf, Q);
+    fsiv_save_classifier_model(clf, fname);
+    cv::Ptr<cv::ml::StatModel> loaded = fsiv_load_classifier_model(fname);
+    const IVFPQClassifier *l_ivfpq = dynamic_cast<IVFPQClassifier *>(loaded.get());
+    if (!l_ivfpq)
+    {
+      std::cerr << "Error: the model was not loaded as an IVFPQClassifier." << std::endl;
+      ok = false;
+      continue;
+    }
+    if (l_ivfpq->get_K() != 5 || l_ivfpq->get_lists() != c.lists ||
+        l_ivfpq->get_code_size() != c.code_size || l_ivfpq->get_probes() != c.lists)
+    {
+      std::cerr << "Error: the loaded parameters differ." << std::endl;
+      ok = false;
+    }
+    ok = same(l_ivfpq->reconstruct(), R, "decoded references") && ok;
+    ok = same(l_ivfpq->get_labels(), ivfpq->get_labels(), "labels") && ok;
+    ok = same(fsiv_predict_labels(loaded, Q), expected, "predictions") && ok;
+  }
+  std::remove(fname.c_str());
+  return ok;
+}
+
+/**
+ * @brief fsiv_hamming_knn_search() agrees with a naive popcount for the
+ * specialized 64, 128 and 256 bit kernels and for another size, and
+ * HammingKNNClassifier keeps its codes and predictions after a save/load
+ * round trip.
+ */
+bool test_hamming_knn_search()
+{
+  cv::RNG rng(0x4444);
+  bool ok = true;
+  for (int bits : {64, 128, 256, 192})
+  {
+    // An odd number of references to leave a tail after the vector loops.
+    cv::Mat R(1001, bits / 8, CV_8UC1), Q(50, bits / 8, CV_8UC1);
+    rng.fill(R, cv::RNG::UNIFORM, 0, 256);
+    rng.fill(Q, cv::RNG::UNIFORM, 0, 256);
+    // Queries equal to references, and repeated references (ties).
+    R.rowRange(0, 10).copyTo(Q.rowRange(0, 10));
+    R.rowRange(0, 100).copyTo(R.rowRange(500, 600));
+    for (int K : {1, 10})
+    {
+      cv::Mat idx, dists;
+      fsiv_hamming_knn_search(Q, R, K, idx, dists);
+      cv::Mat gt_idx(Q.rows, K, CV_32SC1), gt_dists(Q.rows, K, CV_32SC1);
+      for (int i = 0; i < Q.rows; ++i)
+      {
+        std::vector<std::pair<int, int>> all(R.rows);
+        for (int r = 0; r < R.rows; ++r)
+        {
+          int d = 0;
+          for (int b = 0; b < R.cols; ++b)
+            for (int x = Q.at<uchar>(i, b) ^ R.at<uchar>(r, b); x; x >>= 1)
+              d += x & 1;
+          all[r] = std::make_pair(d, r);
+        }
+        std::sort(all.begin(), all.end());
+        for (int k = 0; k < K; ++k)
+        {
+          gt_dists.at<int>(i, k) = all[k].first;
+          gt_idx.at<int>(i, k) = all[k].second;
+        }
+      }
+      ok = same(idx, gt_idx, "neighbours") && ok;
+      ok = same(dists, gt_dists, "distances") && ok;
+    }
+  }
+
+  const std::string fname = cv::tempfile(".yml");
+  cv::Mat y, y_q;
+  const cv::Mat X = gaussian_clusters(600, 40, 4, rng, y);
+  const cv::Mat Q = gaussian_clusters(200, 40, 4, rng, y_q);
+  cv::Ptr<cv::ml::StatModel> clf = fsiv_create_hamming_classifier(3, 32, 10);
+  fsiv_train_classifier(clf, X, y);
+  const cv::Mat expected = fsiv_predict_labels(clf, Q);
+  fsiv_save_classifier_model(clf, fname);
+  cv::Ptr<cv::ml::StatModel> loaded = fsiv_load_classifier_model(fname);
+  std::remove(fname.c_str());
+  const HammingKNNClassifier *hamming = dynamic_cast<HammingKNNClassifier *>(loaded.get());
+  if (!hamming)
+  {
+    std::cerr << "Error: the model was not loaded as a HammingKNNClassifier." << std::endl;
+    return false;
+  }
+  if (hamming->get_K() != 3 || hamming->get_bits() != 32 ||
+      hamming->get_itq_iterations() != 10)
+  {
+    std::cerr << "Error: the loaded parameters differ." << std::endl;
+    ok = false;
+  }
+  cv::Mat codes, loaded_codes;
+  dynamic_cast<HammingKNNClassifier *>(clf.get())->encode(Q, codes);
+  hamming->encode(Q, loaded_codes);
+  ok = same(loaded_codes, codes, "codes") && ok;
+  ok = same(fsiv_predict_labels(loaded, Q), expected, "predictions") && ok;
+  return ok;
+}
+
+/**
+ * @brief The KD-tree finds the same neighbours as the brute force search,
+ * ties included (both sort them by increasing index).
+ */
+bool test_kdtree_knn_search()
+{
+  cv::RNG rng(0x4545);
+  bool ok = true;
+  for (int dims : {2, 3, 8})
+  {
+    // Few grey levels: many references at the same distance.
+    const cv::Mat R = random_samples(3000, dims, 4, rng);
+    cv::Mat Q = random_samples(300, dims, 4, rng);
+    // Queries equal to references.
+    R.rowRange(0, 100).copyTo(Q.rowRange(0, 100));
+    for (int K : {1, 7, 40})
+    {
+      cv::Mat idx, dists, gt_idx, gt_dists;
+      fsiv_knn_search(Q, R, fsiv_compute_sq_norms(R), K, gt_idx, gt_dists);
+      for (int leaf_size : {1, 16})
+      {
+        KDTree tree;
+        tree.build(R, leaf_size);
+        tree.knn_search(Q, K, idx, dists);
+        ok = same(idx, gt_idx, "neighbours") && ok;
+        ok = same(dists, gt_dists, "distances") && ok;
+      }
+    }
+  }
+  return ok;
+}
+
+/**
+ * @brief KNNClassifier::reduce() on separable clusters: CONDENSED keeps a
+ * subset that classifies all the references, EDITED keeps all of them, and
+ * EDITED does not empty a set where every reference is misclassified.
+ */
+bool test_knn_reduce()
+{
+  cv::RNG rng(0x4646);
+  bool ok = true;
+  cv::Mat y;
+  cv::Mat X = gaussian_clusters(900, 4, 3, rng, y);
+  // Spread the clusters so they do not overlap.
+  for (int i = 0; i < X.rows; ++i)
+    X.at<float>(i, 0) += 20.0f * y.at<int>(i);
+
+  for (int method : {int(KNNClassifier::CONDENSED), int(KNNClassifier::EDITED)})
+  {
+    cv::Ptr<cv::ml::StatModel> clf = fsiv_create_native_knn_classifier(1, KNNClassifier::BRUTE_FORCE);
+    fsiv_train_classifier(clf, X, y);
+    KNNClassifier *knn = dynamic_cast<KNNClassifier *>(clf.get());
+    const int kept = knn->reduce(method);
+    if (kept != knn->get_samples().rows || kept > X.rows ||
+        (method == KNNClassifier::CONDENSED && kept >= X.rows / 2) ||
+        (method == KNNClassifier::EDITED && kept != X.rows))
+    {
+      std::cerr << "Error: method " << method << " kept " << kept << " of "
+                << X.rows << " references." << std::endl;
+      ok = false;
+    }
+    ok = same(fsiv_predict_labels(clf, X), y, "predictions") && ok;
+  }
+
+  // Each reference is nearer to the other class.
+  const float x2[] = {0.0f, 1.0f, 10.0f, 11.0f};
+  cv::Mat X2(4, 1, CV_32FC1), y2(4, 1, CV_32SC1);
+  for (int i = 0; i < X2.rows; ++i)
+  {
+    X2.at<float>(i) = x2[i];
+    y2.at<int>(i) = i % 2;
+  }
+  cv::Ptr<cv::ml::StatModel> clf = fsiv_create_native_knn_classifier(1, KNNClassifier::BRUTE_FORCE);
+  fsiv_train_classifier(clf, X2, y2);
+  KNNClassifier *knn = dynamic_cast<KNNClassifier *>(clf.get());
+  if (knn->reduce(KNNClassifier::EDITED, 1) != X2.rows)
+  {
+    std::cerr << "Error: editing removed all the references." << std::endl;
+    ok = false;
+  }
+  ok = same(fsiv_predict_labels(clf, X2), y2, "predictions after editing") && ok;
+  return ok;
+}
+
+/**
+ * @brief fsiv_loo_knn_search() finds the K+1 nearest neighbours of
+ * fsiv_knn_search(X, X, ...) without the sample itself.
+ */
+bool test_loo_knn_search()
+{
+  cv::RNG rng(0x4848);
+  bool ok = true;
+  // Sizes below, equal to and above a multiple of the symmetric tiles.
+  for (int N : {2, 300, 512, 1000})
+  {
+    const cv::Mat X = random_samples(N, 4, 4, rng);
+    const cv::Mat norms = fsiv_compute_sq_norms(X);
+    for (int K : {1, 5, 32})
+    {
+      cv::Mat idx, dists, all_idx, all_dists;
+      fsiv_loo_knn_search(X, norms, K, idx, dists);
+      fsiv_knn_search(X, X, norms, K + 1, all_idx, all_dists);
+      const int Ke = std::min(K, N - 1);
+      cv::Mat gt_idx(N, Ke, CV_32SC1), gt_dists(N, Ke, CV_32FC1);
+      for (int i = 0; i < N; ++i)
+      {
+        // Self is not in the list if more than K+1 samples are equal to it.
+        for (int k = 0, n = 0; k < all_idx.cols && n < Ke; ++k)
+          if (all_idx.at<int>(i, k) != i)
+          {
+            gt_idx.at<int>(i, n) = all_idx.at<int>(i, k);
+            gt_dists.at<float>(i, n++) = all_dists.at<float>(i, k);
+          }
+      }
+      ok = same(idx, gt_idx, "neighbours") && ok;
+      ok = same(dists, gt_dists, "distances") && ok;
+    }
+  }
+  return ok;
+}
+
+/**
+ * @brief A LinearSVMClassifier folded from a linear C-SVC predicts the same
+ * labels, also after fsiv_save_classifier_model() and
+ * fsiv_load_svm_classifier_model().
+ */
+bool test_linear_svm_fold()
+{
+  cv::RNG rng(0x4949);
+  const std::string fname = cv::tempfile(".yml");
+  bool ok = true;
+  for (int classes : {2, 4})
+  {
+    cv::Mat y, y_q;
+    const cv::Mat X = gaussian_clusters(400, 10, classes, rng, y);
+    const cv::Mat Q = gaussian_clusters(400, 10, classes, rng, y_q);
+
+    cv::Ptr<cv::ml::SVM> svm = cv::ml::SVM::create();
+    svm->setType(cv::ml::SVM::C_SVC);
+    svm->setKernel(cv::ml::SVM::LINEAR);
+    svm->setC(0.5);
+    svm->train(X, cv::ml::ROW_SAMPLE, y);
+    cv::Mat expected;
+    svm->predict(Q, expected);
+    expected.convertTo(expected, CV_32S);
+
+    cv::Ptr<LinearSVMClassifier> linear = LinearSVMClassifier::create();
+    linear->fold(*svm);
+    cv::Ptr<cv::ml::StatModel> folded = linear;
+    ok = same(fsiv_predict_labels(folded, Q), expected, "folded predictions") && ok;
+
+    cv::Ptr<cv::ml::StatModel> clf = svm;
+    fsiv_save_classifier_model(clf, fname);
+    cv::Ptr<cv::ml::StatModel> loaded = fsiv_load_svm_classifier_model(fname);
+    if (!dynamic_cast<LinearSVMClassifier *>(loaded.get()))
+    {
+      std::cerr << "Error: the model was not loaded as a LinearSVMClassifier." << std::endl;
+      ok = false;
+      continue;
+    }
+    ok = same(fsiv_predict_labels(loaded, Q), expected, "loaded predictions") && ok;
+  }
+  std::remove(fname.c_str());
+  return ok;
+}
+
+/**
+ * @brief fsiv_train_smo_svm() gives the same model as cv::ml::SVM::train().
+ *
+ * Both solvers stop at the same tolerance but follow different paths, so
+ * samples very near the boundaries may differ: the numbers of support
+ * vectors must agree within 2% and 99% of the predictions must match.
+ */
+bool test_smo_svm()
+{
+  cv::RNG rng(0x5050);
+  bool ok = true;
+  for (int kernel : {int(cv::ml::SVM::RBF), int(cv::ml::SVM::POLY)})
+  {
+    cv::Mat y, y_q;
+    const cv::Mat X = gaussian_clusters(600, 8, 3, rng, y);
+    const cv::Mat Q = gaussian_clusters(600, 8, 3, rng, y_q);
+
+    cv::Ptr<cv::ml::SVM> svms[2];
+    cv::Mat predictions[2];
+    for (int s = 0; s < 2; ++s)
+    {
+      svms[s] = cv::ml::SVM::create();
+      svms[s]->setType(cv::ml::SVM::C_SVC);
+      svms[s]->setKernel(kernel);
+      svms[s]->setC(1.0);
+      svms[s]->setGamma(0.1);
+      svms[s]->setDegree(2.0);
+      svms[s]->setCoef0(1.0);
+      svms[s]->setTermCriteria(cv::TermCriteria(
+          cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 1000000, 1e-5));
+      if (s == 0)
+        svms[s]->train(X, cv::ml::ROW_SAMPLE, y);
+      else
+        fsiv_train_smo_svm(*svms[s], X, y);
+      svms[s]->predict(Q, predictions[s]);
+    }
+
+    const int n_sv = svms[0]->getSupportVectors().rows;
+    const int smo_sv = svms[1]->getSupportVectors().rows;
+    if (std::abs(n_sv - smo_sv) > 2 + n_sv / 50)
+    {
+      std::cerr << "Error: " << smo_sv << " support vectors instead of "
+                << n_sv << "." << std::endl;
+      ok = false;
+    }
+    int differ = 0;
+    for (int i = 0; i < Q.rows; ++i)
+      differ += predictions[0].at<float>(i) != predictions[1].at<float>(i);
+    if (differ > Q.rows / 100)
+    {
+      std::cerr << "Error: " << differ << " of " << Q.rows
+                << " predictions differ." << std::endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+struct NativeTest
+{
+  const char *name;
+  bool (*run)();
+};
+
+static const NativeTest tests[] = {
+    {"knn_classifier_save_load", test_knn_classifier_save_load},
+    {"hnsw_recall", test_hnsw_recall},
+    {"ivfpq", test_ivfpq},
+    {"hamming_knn_search", test_hamming_knn_search},
+    {"kdtree_knn_search", test_kdtree_knn_search},
+    {"knn_reduce", test_knn_reduce},
+    {"loo_knn_search", test_loo_knn_search},
+    {"linear_svm_fold", test_linear_svm_fold},
+    {"smo_svm", test_smo_svm},
+};
+
+int main(int argc, char *const *argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <test_name>" << std::endl;
+    for (const NativeTest &t : tests)
+      std::cerr << "  " << t.name << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string name = argv[1];
+  for (const NativeTest &t : tests)
+    if (name == t.name)
+    {
+      try
+      {
+        const bool ok = t.run();
+        std::cout << name << (ok ? ": passed." : ": FAILED.") << std::endl;
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+      }
+      catch (std::exception &e)
+      {
+        std::cerr << "Exception caught: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  std::cerr << "Error: unknown test '" << name << "'." << std::endl;
+  return EXIT_FAILURE;
+}
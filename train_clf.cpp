@@ -1,5 +1,7 @@
 #include <iostream>
+#include <iomanip>
 #include <sstream>
+#include <algorithm>
 #include <exception>
 #include <time.h>
 #include <stdlib.h>
@@ -25,13 +27,28 @@ const char *keys =
     "{f_params     |      | Feature extractor parameters (if any). Format <value>[:<value>:<value>...].}"
     "{f_save_model |      | Filename to save the trained feature extractor model. If empty no model is saved.}"
     "{f_load_model |      | Filename to load a pre-trained feature extractor model. If empty a new model is trained.}"
-    "{clf          |0     | Classifier to train/test. 0: K-NN, 1:SVM, 2:RTREES.}"
+    "{clf          |0     | Classifier to train/test. 0: K-NN, 1:SVM, 2:RTREES, 3:Native K-NN, 4:HNSW K-NN, 5:IVF-PQ K-NN, 6:Hamming K-NN.}"
     "{knn_K        |1     | Parameter K for K-NN class.}"
+    "{knn_R        |0     | Reduce the native K-NN references. 0:None, 1:Condensed NN, 2:Edited NN, 3:Per class prototypes.}"
+    "{knn_RP       |0     | Parameter of the reduction (Edited NN: K, default 3; prototypes: per class, default 64).}"
+    "{knn_sweep    |0     | If >0, evaluate on the validation set every K-NN K up to this value from a single neighbours search.}"
+    "{knn_loo      |      | For K-NN classifiers, report the leave-one-out accuracy on the training set instead of the training accuracy.}"
+    "{knn_A        |0     | Search algorithm of the native K-NN. 0:Auto, 1:Brute force, 2:KD-tree.}"
+    "{hnsw_M       |16    | Num. of links per node of the HNSW graph.}"
+    "{hnsw_efC     |200   | Beam width used to build the HNSW graph.}"
+    "{hnsw_efS     |64    | Beam width used to search the HNSW graph.}"
+    "{hnsw_bench   |      | Report recall@K and latency of HNSW against exact K-NN on the validation set.}"
+    "{ivf_L        |64    | Num. of inverted lists of the IVF-PQ index.}"
+    "{ivf_B        |16    | Bytes per code of the IVF-PQ index.}"
+    "{ivf_P        |8     | Num. of inverted lists scanned per query.}"
+    "{bin_B        |256   | Bits per code of the Hamming K-NN.}"
+    "{bin_I        |50    | ITQ iterations of the Hamming K-NN (0: sign of PCA).}"
     "{svm_C        |1.0   | Parameter C for SVM class.}"
     "{svm_K        |0     | Kernel to use with SVM class. 0:Linear, 1:Polynomial. "
     "2:RBF, 3:SIGMOID, 4:CHI2, 5:INTER}"
     "{svm_D        |3.0   | Degree of svm polynomial kernel.}"
     "{svm_G        |1.0   | Gamma for svm RBF kernel.}"
+    "{svm_cv       |      | Train the SVM with OpenCV instead of the native SMO trainer.}"
     "{rtrees_V     |0     | Num of random features sampled per node. "
     "Default 0 meas sqrt(num. of total features).}"
     "{rtrees_T     |50    | Max num. of rtrees in the forest.}"
@@ -49,7 +66,9 @@ std::vector<float>
 parse_feature_params(const std::string &f_params)
 {
   std::vector<float> feature_params;
-  std::istringstream in(f_params);
+  std::string values = f_params;
+  std::replace(values.begin(), values.end(), ':', ' ');
+  std::istringstream in(values);
   float v;
   while (in)
   {
@@ -60,6 +79,136 @@ parse_feature_params(const std::string &f_params)
   return feature_params;
 }
 
+/**
+ * @brief Print the references, their size and the validation accuracy of a
+ * native K-NN classifier.
+ */
+void report_knn_references(const std::string &title,
+                           cv::Ptr<cv::ml::StatModel> &clsf,
+                           const cv::Mat &X_v, const cv::Mat &y_v)
+{
+  KNNClassifier *knn = dynamic_cast<KNNClassifier *>(clsf.get());
+  const cv::Mat &R = knn->get_samples();
+  std::cout << std::setw(10) << title << std::setw(12) << R.rows
+            << std::setw(12) << (R.total() * R.elemSize()) / (1024.0 * 1024.0);
+  if (!X_v.empty())
+  {
+    cv::Mat predict_labels = fsiv_predict_labels(clsf, X_v);
+    cv::Mat cmat = fsiv_compute_confusion_matrix(y_v, predict_labels, 15);
+    std::cout << std::setw(12) << fsiv_compute_accuracy(cmat);
+  }
+  std::cout << std::endl;
+}
+
+/**
+ * @brief Print the validation accuracy and mRR of K-NN for every K up to
+ * K_max, with majority and distance weighted votes.
+ *
+ * The sorted K_max nearest neighbours of the validation samples are
+ * searched once, so each K only costs a vote per sample.
+ */
+void report_knn_sweep(const KNNClassifier &knn, const cv::Mat &X_v,
+                      const cv::Mat &y_v, int K_max)
+{
+  cv::Mat idx, dists;
+  cv::TickMeter search_timer, sweep_timer;
+  search_timer.start();
+  knn.find_nearest(X_v, K_max, idx, dists);
+  search_timer.stop();
+
+  sweep_timer.start();
+  const int *labels = knn.get_labels().ptr<int>();
+  cv::Mat majority(X_v.rows, 1, CV_32SC1), weighted(X_v.rows, 1, CV_32SC1);
+  // acc, mRR, weighted acc and weighted mRR of each K.
+  cv::Mat results(idx.cols, 4, CV_32FC1);
+  for (int K = 1; K <= idx.cols; ++K)
+  {
+    for (int i = 0; i < X_v.rows; ++i)
+    {
+      majority.at<int>(i) = fsiv_knn_vote(labels, idx.ptr<int>(i), K);
+      weighted.at<int>(i) = fsiv_knn_weighted_vote(labels, idx.ptr<int>(i),
+                                                    dists.ptr<float>(i), K);
+    }
+    cv::Mat cmat_m = fsiv_compute_confusion_matrix(y_v, majority, 15);
+    cv::Mat cmat_w = fsiv_compute_confusion_matrix(y_v, weighted, 15);
+    float *r = results.ptr<float>(K - 1);
+    r[0] = fsiv_compute_accuracy(cmat_m);
+    r[1] = fsiv_compute_mean_recognition_rate(fsiv_compute_recognition_rates(cmat_m));
+    r[2] = fsiv_compute_accuracy(cmat_w);
+    r[3] = fsiv_compute_mean_recognition_rate(fsiv_compute_recognition_rates(cmat_w));
+  }
+  sweep_timer.stop();
+
+  std::cout << "Neighbours search: " << search_timer.getTimeMilli()
+            << " ms. Sweep of " << idx.cols << " values of K: "
+            << sweep_timer.getTimeMicro() << " us." << std::endl;
+  std::cout << std::setw(6) << "K" << std::setw(12) << "acc"
+            << std::setw(12) << "mRR" << std::setw(12) << "w-acc"
+            << std::setw(12) << "w-mRR" << std::endl;
+  int best = 0;
+  for (int k = 0; k < results.rows; ++k)
+  {
+    const float *r = results.ptr<float>(k);
+    std::cout << std::setw(6) << k + 1;
+    for (int c = 0; c < 4; ++c)
+      std::cout << std::setw(12) << r[c];
+    std::cout << std::endl;
+    const float *b = results.ptr<float>(best);
+    if (std::max(r[0], r[2]) > std::max(b[0], b[2]))
+      best = k;
+  }
+  const float *b = results.ptr<float>(best);
+  std::cout << "Best K=" << best + 1 << " ("
+            << (b[2] > b[0] ? "weighted" : "majority") << " vote)."
+            << std::endl;
+}
+
+/**
+ * @brief Print the recall@K and latency of a HNSW index for several search
+ * beam widths against the exact K nearest neighbours.
+ */
+void report_hnsw_recall(HNSWClassifier &hnsw, const cv::Mat &X_t,
+                        const cv::Mat &y_t, const cv::Mat &X_v, int K)
+{
+  KNNClassifier exact;
+  exact.train(X_t, cv::ml::ROW_SAMPLE, y_t);
+  cv::Mat gt_idx, gt_dists, idx, dists;
+  cv::TickMeter timer;
+  timer.start();
+  exact.find_nearest(X_v, K, gt_idx, gt_dists);
+  timer.stop();
+  const double exact_ms = timer.getTimeMilli() / X_v.rows;
+  std::cout << "Exact K-NN: " << exact_ms << " ms/query." << std::endl;
+  std::cout << std::setw(8) << "efS" << std::setw(12) << "recall@K"
+            << std::setw(12) << "ms/query" << std::setw(10) << "speedup"
+            << std::endl;
+
+  const int ef_search = hnsw.get_ef_search();
+  for (int ef : {1, 16, 32, 64, 128, 256, 512})
+  {
+    if (ef < K && ef != 1)
+      continue;
+    hnsw.set_ef_search(std::max(ef, K));
+    timer.reset();
+    timer.start();
+    hnsw.find_nearest(X_v, K, idx, dists);
+    timer.stop();
+    size_t hits = 0;
+    for (int i = 0; i < idx.rows; ++i)
+      for (int k = 0; k < idx.cols; ++k)
+      {
+        const int *gt = gt_idx.ptr<int>(i);
+        hits += std::find(gt, gt + gt_idx.cols, idx.at<int>(i, k)) != gt + gt_idx.cols;
+      }
+    const double ms = timer.getTimeMilli() / X_v.rows;
+    std::cout << std::setw(8) << hnsw.get_ef_search()
+              << std::setw(12) << double(hits) / gt_idx.total()
+              << std::setw(12) << ms << std::setw(10) << exact_ms / ms
+              << std::endl;
+  }
+  hnsw.set_ef_search(ef_search);
+}
+
 int main(int argc, char *const *argv)
 {
   int retCode = EXIT_SUCCESS;
@@ -104,13 +253,28 @@ int main(int argc, char *const *argv)
     std::string model_fname = parser.get<std::string>("@model");
     int classifier = parser.get<int>("clf");
     int knn_K = parser.get<int>("knn_K");
+    int knn_A = parser.get<int>("knn_A");
+    int knn_R = parser.get<int>("knn_R");
+    int knn_RP = parser.get<int>("knn_RP");
+    int knn_sweep = parser.get<int>("knn_sweep");
+    bool knn_loo = parser.has("knn_loo");
     float svm_C = parser.get<float>("svm_C");
     int svm_K = parser.get<int>("svm_K");
     float svm_D = parser.get<float>("svm_D");
     float svm_G = parser.get<float>("svm_G");
+    bool svm_cv = parser.has("svm_cv");
     int rtrees_V = parser.get<int>("rtrees_V");
     int rtrees_T = parser.get<int>("rtrees_T");
     double rtrees_E = parser.get<double>("rtrees_E");
+    int hnsw_M = parser.get<int>("hnsw_M");
+    int hnsw_efC = parser.get<int>("hnsw_efC");
+    int hnsw_efS = parser.get<int>("hnsw_efS");
+    bool hnsw_bench = parser.has("hnsw_bench");
+    int ivf_L = parser.get<int>("ivf_L");
+    int ivf_B = parser.get<int>("ivf_B");
+    int ivf_P = parser.get<int>("ivf_P");
+    int bin_B = parser.get<int>("bin_B");
+    int bin_I = parser.get<int>("bin_I");
     size_t seed = parser.get<size_t>("rseed");
     if (!parser.check())
     {
@@ -210,6 +374,32 @@ int main(int argc, char *const *argv)
                 << std::endl;
       clsf = fsiv_create_rtrees_classifier(rtrees_V, rtrees_T, rtrees_E);
     }
+    else if (classifier == 3)
+    {
+      std::cout << "Using a native K-NN classifier with k=" << knn_K
+                << " algorithm=" << knn_A << std::endl;
+      clsf = fsiv_create_native_knn_classifier(knn_K, knn_A);
+    }
+    else if (classifier == 4)
+    {
+      std::cout << "Using a HNSW K-NN classifier with k=" << knn_K
+                << " M=" << hnsw_M << " efC=" << hnsw_efC
+                << " efS=" << hnsw_efS << std::endl;
+      clsf = fsiv_create_hnsw_classifier(knn_K, hnsw_M, hnsw_efC, hnsw_efS);
+    }
+    else if (classifier == 5)
+    {
+      std::cout << "Using an IVF-PQ K-NN classifier with k=" << knn_K
+                << " L=" << ivf_L << " B=" << ivf_B << " P=" << ivf_P
+                << std::endl;
+      clsf = fsiv_create_ivfpq_classifier(knn_K, ivf_L, ivf_B, ivf_P);
+    }
+    else if (classifier == 6)
+    {
+      std::cout << "Using a Hamming K-NN classifier with k=" << knn_K
+                << " B=" << bin_B << " I=" << bin_I << std::endl;
+      clsf = fsiv_create_hamming_classifier(knn_K, bin_B, bin_I);
+    }
     else
     {
       std::cerr << "Error: unknown classifier." << std::endl;
@@ -218,15 +408,64 @@ int main(int argc, char *const *argv)
 
     std::cout << std::endl;
     std::cout << "Training ... ";
-    fsiv_train_classifier(clsf, X_t, y_t);
-    std::cout << "done." << std::endl;
+    cv::TickMeter train_timer;
+    train_timer.start();
+    if (svm_cv && classifier == 1)
+      clsf->train(X_t, cv::ml::ROW_SAMPLE, y_t);
+    else
+      fsiv_train_classifier(clsf, X_t, y_t);
+    train_timer.stop();
+    std::cout << "done (" << train_timer.getTimeSec() << " s)." << std::endl;
+    if (cv::ml::SVM *svm = dynamic_cast<cv::ml::SVM *>(clsf.get()))
+    {
+      // Linear SVMs trained by OpenCV only keep the merged vectors.
+      cv::Mat sv = svm->getUncompressedSupportVectors();
+      if (sv.empty())
+        sv = svm->getSupportVectors();
+      std::cout << "SVM with " << sv.rows << " support vectors." << std::endl;
+    }
+    if (KNNClassifier *knn = dynamic_cast<KNNClassifier *>(clsf.get()))
+    {
+      if (knn_R != KNNClassifier::NO_REDUCTION)
+      {
+        std::cout << "Reducing the K-NN references:" << std::endl;
+        std::cout << std::setw(10) << "" << std::setw(12) << "references"
+                  << std::setw(12) << "Mb" << std::setw(12)
+                  << (X_v.empty() ? "" : "valid acc") << std::endl;
+        report_knn_references("before", clsf, X_v, y_v);
+        knn->reduce(knn_R, knn_RP);
+        report_knn_references("after", clsf, X_v, y_v);
+      }
+      std::cout << "Native K-NN search: "
+                << (knn->uses_kd_tree() ? "KD-tree" : "brute force")
+                << std::endl;
+    }
 
-    std::cout << "Computing training accuracy ... ";
-    cv::Mat predict_labels = fsiv_predict_labels(clsf, X_t);
-    cv::Mat cmat = fsiv_compute_confusion_matrix(y_t, predict_labels, 15);
-    float acc = fsiv_compute_accuracy(cmat);
-    std::cout << "done." << std::endl;
-    std::cout << "Training accuracy: " << acc << std::endl;
+    cv::Mat predict_labels, cmat;
+    float acc;
+    if (knn_loo && (classifier == 0 || classifier == 3))
+    {
+      // A K-NN always finds a training sample itself, so the training
+      // accuracy is meaningless: leave each sample out of its neighbours.
+      std::cout << "Computing leave-one-out training accuracy ... ";
+      cv::TickMeter timer;
+      timer.start();
+      predict_labels = fsiv_knn_leave_one_out(X_t, y_t, knn_K);
+      timer.stop();
+      cmat = fsiv_compute_confusion_matrix(y_t, predict_labels, 15);
+      acc = fsiv_compute_accuracy(cmat);
+      std::cout << "done (" << timer.getTimeMilli() << " ms)." << std::endl;
+      std::cout << "Leave-one-out training accuracy: " << acc << std::endl;
+    }
+    else
+    {
+      std::cout << "Computing training accuracy ... ";
+      predict_labels = fsiv_predict_labels(clsf, X_t);
+      cmat = fsiv_compute_confusion_matrix(y_t, predict_labels, 15);
+      acc = fsiv_compute_accuracy(cmat);
+      std::cout << "done." << std::endl;
+      std::cout << "Training accuracy: " << acc << std::endl;
+    }
     std::cout << std::endl;
 
     if (!X_v.empty())
@@ -238,6 +477,29 @@ int main(int argc, char *const *argv)
       acc = fsiv_compute_accuracy(cmat);
       std::cout << "Validation accuracy: " << acc << std::endl;
       std::cout << std::endl;
+
+      if (knn_sweep > 0)
+      {
+        std::cout << "K-NN sweep on the validation set:" << std::endl;
+        KNNClassifier *knn = dynamic_cast<KNNClassifier *>(clsf.get());
+        if (knn)
+          report_knn_sweep(*knn, X_v, y_v, knn_sweep);
+        else
+        {
+          KNNClassifier exact;
+          exact.train(X_t, cv::ml::ROW_SAMPLE, y_t);
+          report_knn_sweep(exact, X_v, y_v, knn_sweep);
+        }
+        std::cout << std::endl;
+      }
+
+      HNSWClassifier *hnsw = dynamic_cast<HNSWClassifier *>(clsf.get());
+      if (hnsw_bench && hnsw)
+      {
+        std::cout << "HNSW recall vs latency on the validation set:" << std::endl;
+        report_hnsw_recall(*hnsw, X_t, y_t, X_v, knn_K);
+        std::cout << std::endl;
+      }
     }
 
     std::cout << "Saving the model to '" << model_fname << "'." << std::endl;
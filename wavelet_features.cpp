@@ -0,0 +1,202 @@
+/**
+ *  @file wavelet_features.cpp
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "wavelet_features.hpp"
+
+static std::string name_{"Wavelet Energy Feature Extractor"};
+static std::string help_{
+    "  This extractor computes an L level 2D wavelet transform of the image\n"
+    "  and returns, for the three detail subbands of each level, the energy\n"
+    "  (mean of squares), the mean absolute value and the standard deviation,\n"
+    "  plus the mean and the standard deviation of the last approximation\n"
+    "  (9*L+2 features). The image size must be a multiple of 2^L.\n"
+    "  Parameters: L:W\n"
+    "    L: num. of levels. Default 3.\n"
+    "    W: wavelet: 0 Haar, 1 CDF 5/3. Default 0.\n"};
+
+const std::string &
+WaveletFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+WaveletFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+WaveletFeatures::WaveletFeatures()
+{
+    type_ = FSIV_WAVELET;
+    params_ = {3.0f, 0.0f};
+}
+
+WaveletFeatures::~WaveletFeatures() {}
+
+/**
+ * @brief Get a per thread scratch buffer of at least n floats.
+ * The buffer only grows, so once warm there are no allocations.
+ */
+static float *
+scratch(size_t n)
+{
+    thread_local std::vector<float> arena;
+    if (arena.size() < n)
+        arena.resize(n);
+    return arena.data();
+}
+
+/**
+ * @brief One level of lifting along the rows (the vertical direction).
+ *
+ * The lifting steps are done in place over whole rows, so the inner loops
+ * run along contiguous columns. Then the low pass rows are written to the
+ * top half of out and the high pass ones to the bottom half.
+ *
+ * @param x is the input (rows x cols with stride ld), modified.
+ * @param rows is the num. of rows (even).
+ * @param cdf if true use CDF 5/3 else Haar.
+ */
+static void
+lift_rows(float *x, int rows, int cols, size_t ld, bool cdf, float *out)
+{
+    const int half = rows / 2;
+    if (!cdf)
+    {
+        for (int i = 0; i < half; ++i)
+        {
+            float *e = x + 2 * i * ld;
+            float *o = e + ld;
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int j = 0; j < cols; ++j)
+            {
+                o[j] -= e[j];
+                e[j] += 0.5f * o[j];
+            }
+        }
+    }
+    else
+    {
+        // Predict with symmetric extension at the bottom border.
+        for (int i = 0; i < half; ++i)
+        {
+            const float *e0 = x + 2 * i * ld;
+            const float *e1 = 2 * i + 2 < rows ? e0 + 2 * ld : e0;
+            float *o = x + (2 * i + 1) * ld;
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int j = 0; j < cols; ++j)
+                o[j] -= 0.5f * (e0[j] + e1[j]);
+        }
+        // Update with symmetric extension at the top border.
+        for (int i = 0; i < half; ++i)
+        {
+            float *e = x + 2 * i * ld;
+            const float *d1 = e + ld;
+            const float *d0 = i > 0 ? e - ld : d1;
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+            for (int j = 0; j < cols; ++j)
+                e[j] += 0.25f * (d0[j] + d1[j]);
+        }
+    }
+    for (int i = 0; i < half; ++i)
+    {
+        std::memcpy(out + i * ld, x + 2 * i * ld, cols * sizeof(float));
+        std::memcpy(out + (half + i) * ld, x + (2 * i + 1) * ld, cols * sizeof(float));
+    }
+}
+
+/**
+ * @brief Energy, mean absolute value and standard deviation of a subband.
+ * @param mean_out if not nullptr, the mean is also returned.
+ */
+static void
+subband_stats(const float *x, int rows, int cols, size_t ld, float *f,
+              float *mean_out = nullptr)
+{
+    double sum = 0.0, sum_sq = 0.0, sum_abs = 0.0;
+    for (int i = 0; i < rows; ++i)
+    {
+        const float *r = x + i * ld;
+        float s = 0.0f, s2 = 0.0f, sa = 0.0f;
+#ifdef USE_OPENMP
+#pragma omp simd reduction(+ : s, s2, sa)
+#endif
+        for (int j = 0; j < cols; ++j)
+        {
+            s += r[j];
+            s2 += r[j] * r[j];
+            sa += std::abs(r[j]);
+        }
+        sum += s;
+        sum_sq += s2;
+        sum_abs += sa;
+    }
+    const double n = double(rows) * cols;
+    const double mean = sum / n;
+    f[0] = float(sum_sq / n);
+    f[1] = float(sum_abs / n);
+    f[2] = float(std::sqrt(std::max(sum_sq / n - mean * mean, 0.0)));
+    if (mean_out)
+        *mean_out = float(mean);
+}
+
+cv::Mat
+WaveletFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    const int L = int(params_[0]);
+    const bool cdf = params_[1] != 0.0f;
+    CV_Assert(L > 0);
+    CV_Assert(img.rows % (1 << L) == 0 && img.cols % (1 << L) == 0);
+
+    // Both buffers use a square stride so the transposed region fits.
+    const size_t S = size_t(std::max(img.rows, img.cols));
+    float *buf = scratch(2 * S * S);
+    float *tmp = buf + S * S;
+    cv::Mat src(img.rows, img.cols, CV_32FC1, buf, S * sizeof(float));
+    img.convertTo(src, CV_32F, img.depth() == CV_8U ? 1.0 / 255.0 : 1.0);
+
+    cv::Mat features(1, 9 * L + 2, CV_32FC1);
+    float *f = features.ptr<float>();
+    int h = img.rows;
+    int w = img.cols;
+    for (int l = 0; l < L; ++l, f += 9)
+    {
+        // Vertical pass, then the horizontal one as a vertical pass over
+        // the transposed region.
+        lift_rows(buf, h, w, S, cdf, tmp);
+        cv::Mat t_hw(h, w, CV_32FC1, tmp, S * sizeof(float));
+        cv::Mat b_wh(w, h, CV_32FC1, buf, S * sizeof(float));
+        cv::transpose(t_hw, b_wh);
+        lift_rows(buf, w, h, S, cdf, tmp);
+        cv::Mat t_wh(w, h, CV_32FC1, tmp, S * sizeof(float));
+        cv::Mat b_hw(h, w, CV_32FC1, buf, S * sizeof(float));
+        cv::transpose(t_wh, b_hw);
+
+        h /= 2;
+        w /= 2;
+        subband_stats(buf + w, h, w, S, f);           // Low rows, high columns.
+        subband_stats(buf + h * S, h, w, S, f + 3);   // High rows, low columns.
+        subband_stats(buf + h * S + w, h, w, S, f + 6); // Diagonal.
+    }
+    float approx[3];
+    subband_stats(buf, h, w, S, approx, f);
+    f[1] = approx[2];
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
@@ -0,0 +1,27 @@
+/**
+ *  @file wavelet_features.hpp
+ */
+#pragma once
+
+#include "features.hpp"
+
+/**
+ * @brief Wavelet subband energy features extractor.
+ *
+ * Computes an L level 2D wavelet transform (Haar or CDF 5/3) with lifting
+ * steps on a per thread scratch buffer and returns statistics of every
+ * subband.
+ */
+class WaveletFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    WaveletFeatures();
+    ~WaveletFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+};
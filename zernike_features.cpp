@@ -0,0 +1,165 @@
+/**
+ *  @file zernike_features.cpp
+ */
+#include <cmath>
+#include <vector>
+#include "zernike_features.hpp"
+
+static std::string name_{"Zernike Moments Feature Extractor"};
+static std::string help_{
+    "  This extractor returns the magnitudes of the Zernike moments Z_nm\n"
+    "  (0<=m<=n, n-m even) up to order N of the disc inscribed in the\n"
+    "  [0,1] normalized image. They are rotation invariant. The moments of a\n"
+    "  batch of images are computed as one matrix product against a basis\n"
+    "  precomputed for the input grid.\n"
+    "  Parameters: N\n"
+    "    N: max. order (0..40). Default 12 (49 moments).\n"};
+
+const std::string &
+ZernikeFeatures::get_extractor_name() const
+{
+    return name_;
+}
+
+const std::string &
+ZernikeFeatures::get_extractor_help() const
+{
+    return help_;
+}
+
+ZernikeFeatures::ZernikeFeatures()
+{
+    type_ = FSIV_ZERNIKE;
+    params_ = {12.0f};
+    basis_ = build_basis(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE));
+}
+
+ZernikeFeatures::~ZernikeFeatures() {}
+
+cv::Mat
+ZernikeFeatures::build_basis(const cv::Size &size) const
+{
+    const int N = int(params_[0]);
+    CV_Assert(N >= 0 && N <= 40);
+
+    std::vector<double> factorial(N + 1, 1.0);
+    for (int i = 1; i <= N; ++i)
+        factorial[i] = factorial[i - 1] * i;
+
+    std::vector<int> orders, reps;
+    for (int n = 0; n <= N; ++n)
+        for (int m = n % 2; m <= n; m += 2)
+        {
+            orders.push_back(n);
+            reps.push_back(m);
+        }
+    const int n_moments = int(orders.size());
+
+    // Pixel centers mapped to [-1,1]x[-1,1]; each pixel covers dA of it.
+    const double dA = (2.0 / size.width) * (2.0 / size.height);
+    cv::Mat basis = cv::Mat::zeros(size.area(), 2 * n_moments, CV_32FC1);
+    for (int y = 0; y < size.height; ++y)
+        for (int x = 0; x < size.width; ++x)
+        {
+            const double xc = (2.0 * x + 1.0 - size.width) / size.width;
+            const double yc = (2.0 * y + 1.0 - size.height) / size.height;
+            const double rho = std::sqrt(xc * xc + yc * yc);
+            if (rho > 1.0)
+                continue;
+            const double theta = std::atan2(yc, xc);
+            float *b = basis.ptr<float>(y * size.width + x);
+            for (int k = 0; k < n_moments; ++k)
+            {
+                const int n = orders[k];
+                const int m = reps[k];
+                double R = 0.0;
+                for (int s = 0; s <= (n - m) / 2; ++s)
+                    R += ((s % 2) ? -1.0 : 1.0) * factorial[n - s] /
+                         (factorial[s] * factorial[(n + m) / 2 - s] * factorial[(n - m) / 2 - s]) *
+                         std::pow(rho, n - 2 * s);
+                // Z_nm = (n+1)/pi sum f(x,y) R_nm(rho) exp(-i m theta) dA
+                const double c = (n + 1) / CV_PI * dA * R;
+                b[2 * k] = float(c * std::cos(m * theta));
+                b[2 * k + 1] = float(-c * std::sin(m * theta));
+            }
+        }
+    return basis;
+}
+
+cv::Mat
+ZernikeFeatures::extract_features(const cv::Mat &img)
+{
+    CV_Assert(!img.empty());
+    CV_Assert(img.channels() == 1);
+    cv::Mat features = extract_features_batch(std::vector<cv::Mat>{img});
+
+    CV_Assert(features.rows == 1);
+    CV_Assert(features.type() == CV_32FC1);
+    CV_Assert(features.cols > 0);
+    return features;
+}
+
+cv::Mat
+ZernikeFeatures::extract_features_batch(const std::vector<cv::Mat> &imgs)
+{
+    CV_Assert(imgs.size() > 0);
+    const cv::Size size = imgs[0].size();
+    for (auto &img : imgs)
+        if (img.size() != size)
+            return FeaturesExtractor::extract_features_batch(imgs);
+    const cv::Mat *basis = &basis_;
+    if (size != cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE))
+    {
+        thread_local cv::Mat other_basis;
+        thread_local cv::Size other_size;
+        thread_local std::vector<float> other_params;
+        if (size != other_size || params_ != other_params)
+        {
+            other_basis = build_basis(size);
+            other_size = size;
+            other_params = params_;
+        }
+        basis = &other_basis;
+    }
+
+    // Image block, one [0,1] normalized image per row, in per thread
+    // scratch so several threads can share the extractor.
+    thread_local cv::Mat block, moments;
+    block.create(int(imgs.size()), size.area(), CV_32FC1);
+    cv::Mat normalized;
+    for (size_t i = 0; i < imgs.size(); ++i)
+    {
+        CV_Assert(imgs[i].channels() == 1);
+        cv::normalize(imgs[i], normalized, 0.0, 1.0, cv::NORM_MINMAX, CV_32F);
+        normalized.reshape(1, 1).copyTo(block.row(int(i)));
+    }
+
+    cv::gemm(block, *basis, 1.0, cv::noArray(), 0.0, moments);
+
+    cv::Mat features(moments.rows, moments.cols / 2, CV_32FC1);
+    for (int i = 0; i < moments.rows; ++i)
+    {
+        const float *z = moments.ptr<float>(i);
+        float *f = features.ptr<float>(i);
+        for (int k = 0; k < features.cols; ++k)
+            f[k] = std::sqrt(z[2 * k] * z[2 * k] + z[2 * k + 1] * z[2 * k + 1]);
+    }
+
+    CV_Assert(features.rows == int(imgs.size()));
+    CV_Assert(features.type() == CV_32FC1);
+    return features;
+}
+
+bool ZernikeFeatures::load_model(std::string const &fname)
+{
+    if (!FeaturesExtractor::load_model(fname))
+        return false;
+    basis_ = build_basis(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE));
+    return true;
+}
+
+void ZernikeFeatures::set_params(const std::vector<float> &params)
+{
+    FeaturesExtractor::set_params(params);
+    basis_ = build_basis(cv::Size(FSIV_SAMPLE_SIZE, FSIV_SAMPLE_SIZE));
+}
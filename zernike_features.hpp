@@ -0,0 +1,44 @@
+/**
+ *  @file zernike_features.hpp
+ */
+#pragma once
+
+#include "features.hpp"
+
+/**
+ * @brief Zernike moments extractor.
+ *
+ * The magnitudes of the Zernike moments up to order N of the disc
+ * inscribed in the image are rotation invariant. The complex basis for the
+ * sample grid is computed when the parameters are set or the model is
+ * loaded (other sizes use a basis built per thread), as a matrix with one row per pixel and the
+ * real and imaginary part of each moment as columns, so the moments of a
+ * batch of images are one matrix product of the image block (one image
+ * per row) against the basis.
+ */
+class ZernikeFeatures : public FeaturesExtractor
+{
+public:
+    /**
+     * @brief Create and set the default parameters.
+     */
+    ZernikeFeatures();
+    ~ZernikeFeatures();
+
+    virtual const std::string &get_extractor_name() const override;
+    virtual const std::string &get_extractor_help() const override;
+    virtual cv::Mat extract_features(const cv::Mat &img) override;
+    virtual cv::Mat extract_features_batch(const std::vector<cv::Mat> &imgs) override;
+    virtual bool load_model(std::string const &fname) override;
+    virtual void set_params(const std::vector<float> &params) override;
+
+protected:
+    /**
+     * @brief Compute the basis matrix for a grid size.
+     * @param size is the image size.
+     * @return the basis, one row per pixel.
+     */
+    cv::Mat build_basis(const cv::Size &size) const;
+
+    cv::Mat basis_;
+};